@@ -60,6 +60,7 @@ testScripts=(
     'addressindex.py'
     'timestampindex.py'
     'spentindex.py'
+    'rpcbatch.py'
     'decodescript.py'
     'blockchain.py'
     'disablewallet.py'
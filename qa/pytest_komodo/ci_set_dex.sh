@@ -20,4 +20,9 @@ export BOOTSTRAP_URL="https://sirseven.me/share/bootstrap.tar.gz"
 python3 chainstart.py
 
 # starting the tests
-python3 -m pytest -s -vv modules/test_dexp2p.py modules/test_dexp2p_e2e.py
\ No newline at end of file
+python3 -m pytest -s -vv modules/test_dexp2p.py modules/test_dexp2p_e2e.py
+
+# file publish/subscribe benchmark, opt in with DEX_BENCH_MB=<size of the published file>
+if [ -n "$DEX_BENCH_MB" ]; then
+  python3 -m pytest -s -vv modules/test_dexp2p_bench.py
+fi
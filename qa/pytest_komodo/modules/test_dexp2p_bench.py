@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 SuperNET developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+import pytest
+import hashlib
+import sys
+import os
+import time
+
+sys.path.append('../')
+from basic.pytest_util import randomstring, get_size
+
+
+@pytest.mark.usefixtures("proxy_connection")
+class TestDexP2Pbench:
+
+    def test_file_publish_subscribe_bench(self, test_params):
+        # publish a DEX_BENCH_MB sized file on node1 and time until node2 has reassembled it
+        rpc1 = test_params.get('node1').get('rpc')
+        rpc2 = test_params.get('node2').get('rpc')
+        size_mb = int(os.environ.get('DEX_BENCH_MB', '300'))
+        timeout = int(os.environ.get('DEX_BENCH_TIMEOUT', '3600'))
+        if os.name == 'posix':
+            dex_path = os.environ['HOME'] + '/dexp2p/'
+        else:
+            dex_path = os.environ['APPDATA'] + '\\dexp2p\\'
+        if not os.path.isdir(dex_path):
+            os.mkdir(dex_path)
+        filename = 'bench_' + randomstring(5)
+        hasher = hashlib.sha256()
+        with open(dex_path + filename, 'wb') as f:
+            for x in range(size_mb):
+                chunk = os.urandom(1024 * 1024)
+                hasher.update(chunk)
+                f.write(chunk)
+        size = get_size(dex_path + filename)
+        fhash = hasher.hexdigest()
+        pubkey = rpc1.DEX_stats().get('publishable_pubkey')
+
+        start = time.time()
+        res = rpc1.DEX_publish(filename, '0')
+        published = time.time()
+        assert res.get('result') == 'success'
+        assert res.get('filesize') == size
+        assert res.get('filehash') == fhash
+
+        # fragments keep arriving on node2 while it subscribes, every call requests what is still missing
+        attempts = 0
+        while True:
+            res = rpc2.DEX_subscribe(filename, '0', '0', pubkey)
+            attempts += 1
+            if res.get('result') == 'success':
+                break
+            assert time.time() - published < timeout
+            time.sleep(5)
+        subscribed = time.time()
+        assert res.get('filesize') == size
+        assert res.get('filehash') == fhash
+        print("\n%d MB: publish %.1fs (%.2f MB/s), subscribe %.1fs in %d calls (%.2f MB/s), total %.1fs\n" %
+              (size_mb, published - start, size_mb / (published - start), subscribed - published, attempts,
+               size_mb / (subscribed - published), subscribed - start))
+        os.remove(dex_path + filename)
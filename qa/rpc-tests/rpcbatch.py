@@ -0,0 +1,79 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 The SuperNET developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test -rpcbatchthreads and -rpcmaxbatchsize, and compare the latency of
+# a batch request run serially and on the batch pool.
+#
+
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+
+class RPCBatchTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 2)
+
+    def setup_network(self):
+        self.nodes = []
+        # Node 0 runs batch elements one after another, node 1 on the pool;
+        # the batch size cap only applies with the pool
+        self.nodes.append(start_node(0, self.options.tmpdir, ["-debug", "-rpcmaxbatchsize=500"]))
+        self.nodes.append(start_node(1, self.options.tmpdir, ["-debug", "-rpcbatchthreads=4", "-rpcmaxbatchsize=500"]))
+        connect_nodes(self.nodes[0], 1)
+
+        self.is_network_split = False
+        self.sync_all()
+
+    def make_batch(self, blockhashes):
+        batch = []
+        for i, blockhash in enumerate(blockhashes):
+            batch.append({"method": "getblock", "params": [blockhash, 2], "id": 2*i})
+            batch.append({"method": "getblockheader", "params": [blockhash], "id": 2*i+1})
+        # an element that fails must not affect its neighbours
+        batch.append({"method": "getblock", "params": ["x"], "id": len(batch)})
+        return batch
+
+    def time_batch(self, node, batch, rounds):
+        start = time.time()
+        for _ in range(rounds):
+            replies = node._batch(batch)
+        return (time.time() - start) * 1000.0 / rounds, replies
+
+    def run_test(self):
+        print "Mining 200 blocks..."
+        blockhashes = self.nodes[0].generate(200)
+        self.sync_all()
+
+        batch = self.make_batch(blockhashes)
+        serial_ms, serial = self.time_batch(self.nodes[0], batch, 5)
+        parallel_ms, parallel = self.time_batch(self.nodes[1], batch, 5)
+
+        print "Checking replies keep request order..."
+        assert_equal(len(parallel), len(batch))
+        for i, reply in enumerate(parallel):
+            assert_equal(reply["id"], i)
+        assert_equal(parallel[-1]["error"]["code"], -8)
+        assert(parallel[-1]["result"] is None)
+        assert_equal(parallel, serial)
+
+        print "Batch of %d requests: serial %.1f ms, parallel %.1f ms" % (len(batch), serial_ms, parallel_ms)
+
+        print "Checking -rpcmaxbatchsize..."
+        big = [{"method": "getblockcount", "params": [], "id": i} for i in range(501)]
+        reply = self.nodes[1]._batch(big)
+        assert_equal(reply["error"]["code"], -32600)
+        assert_equal(len(self.nodes[1]._batch(big[:500])), 500)
+        assert_equal(len(self.nodes[0]._batch(big)), 501)
+
+        print "Passed\n"
+
+
+if __name__ == '__main__':
+    RPCBatchTest().main()
@@ -74,7 +74,18 @@ function zcashd_start {
             mkdir -p "$DATADIR/regtest"
             touch "$DATADIR/zcash.conf"
     esac
-    ./src/zcashd -regtest -datadir="$DATADIR" -rpcuser=user -rpcpassword=password -rpcport=5983 -showmetrics=0 &
+    # The socket benchmarks measure the node's own socket handler, so it
+    # has to run the loop under test with room for 1000 benchmark peers
+    ZCASHD_ARGS=""
+    case "$1" in
+        socketselect)
+            ZCASHD_ARGS="-socketevents=select -maxconnections=1100"
+            ;;
+        socketepoll)
+            ZCASHD_ARGS="-socketevents=epoll -maxconnections=1100"
+            ;;
+    esac
+    ./src/zcashd -regtest -datadir="$DATADIR" -rpcuser=user -rpcpassword=password -rpcport=5983 -showmetrics=0 $ZCASHD_ARGS &
     ZCASHD_PID=$!
     zcash_rpc_wait_for_start
 }
@@ -200,6 +211,9 @@ case "$1" in
             trydecryptnotes)
                 zcash_rpc zcbenchmark trydecryptnotes 1000 "${@:3}"
                 ;;
+            trydecryptsaplingnotes)
+                zcash_rpc zcbenchmark trydecryptsaplingnotes 10 "${@:3}"
+                ;;
             incnotewitnesses)
                 zcash_rpc zcbenchmark incnotewitnesses 100 "${@:3}"
                 ;;
@@ -216,6 +230,36 @@ case "$1" in
             listunspent)
                 zcash_rpc zcbenchmark listunspent 10
                 ;;
+            socketselect)
+                zcash_rpc zcbenchmark socketselect 10 "${@:3}"
+                ;;
+            socketepoll)
+                zcash_rpc zcbenchmark socketepoll 10 "${@:3}"
+                ;;
+            stakeeligibility)
+                zcash_rpc zcbenchmark stakeeligibility 10 "${@:3}"
+                ;;
+            ccverify)
+                zcash_rpc zcbenchmark ccverify 10 "${@:3}"
+                ;;
+            ccverifycached)
+                zcash_rpc zcbenchmark ccverifycached 10 "${@:3}"
+                ;;
+            ccsign)
+                zcash_rpc zcbenchmark ccsign 10 "${@:3}"
+                ;;
+            ccsignlocked)
+                zcash_rpc zcbenchmark ccsignlocked 10 "${@:3}"
+                ;;
+            sigcachelookups)
+                zcash_rpc zcbenchmark sigcachelookups 10 "${@:3}"
+                ;;
+            verifysaplingspends)
+                zcash_rpc zcbenchmark verifysaplingspends 10 "${@:3}"
+                ;;
+            verifysaplingspendsparallel)
+                zcash_rpc zcbenchmark verifysaplingspendsparallel 10 "${@:3}"
+                ;;
             *)
                 zcashd_stop
                 echo "Bad arguments to time."
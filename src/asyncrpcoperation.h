@@ -60,7 +60,7 @@ public:
     virtual void main();
 
     // Override this method if you can interrupt execution of main() in your subclass.
-    void cancel();
+    virtual void cancel();
     
     // Getters and setters
 
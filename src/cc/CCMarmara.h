@@ -19,6 +19,7 @@
 
 #include <limits>
 #include "CCinclude.h"
+#include "CCindex.h"
 
 #define MARMARA_GROUPSIZE 60
 //#define MARMARA_MINLOCK (1440 * 3 * 30)
@@ -100,6 +101,134 @@ struct SMarmaraOptParams {
 };
 
 
+/// kinds of outputs kept in the marmara ccindex rows
+enum MARMARA_INDEX_KIND : uint8_t {
+    MARMARA_INDEX_ACTIVATED = 'A',  //!< activated coins on the 1of2 address of the pubkey
+    MARMARA_INDEX_LOCKED = 'K',     //!< coins of the pubkey locked in a credit loop
+    MARMARA_INDEX_MARKER = 'M'      //!< activation marker of a tx that activated coins of the pubkey
+};
+
+/// ccindex key of a marmara output, the pubkey and kind come first so an address is one range scan
+struct CMarmaraIndexKey
+{
+    CPubKey pk;
+    uint8_t kind;
+    uint256 txid;
+    int32_t nvout;
+
+    CMarmaraIndexKey() : kind(0), nvout(0) {}
+    CMarmaraIndexKey(const CPubKey &_pk,uint8_t _kind,uint256 _txid,int32_t _nvout) : pk(_pk), kind(_kind), txid(_txid), nvout(_nvout) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        s.write((const char *)pk.begin(), CPubKey::COMPRESSED_PUBLIC_KEY_SIZE);
+        ser_writedata8(s, kind);
+        txid.Serialize(s);
+        ser_writedata32be(s, nvout);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        uint8_t vpk[CPubKey::COMPRESSED_PUBLIC_KEY_SIZE];
+        s.read((char *)vpk, sizeof(vpk));
+        pk.Set(vpk, vpk + sizeof(vpk));
+        kind = ser_readdata8(s);
+        txid.Unserialize(s);
+        nvout = ser_readdata32be(s);
+    }
+};
+
+/// an indexed output, stored whole so that enumerating coins needs no transaction fetch
+struct CMarmaraIndexCoin
+{
+    uint8_t kind;
+    CPubKey pk;
+    uint256 createtxid;     //!< loop of a locked-in-loop output
+    CAmount nValue;
+    int32_t height;
+    uint32_t nTime;         //!< block time, used as the utxo time for staking
+    CScript scriptPubKey;
+
+    CMarmaraIndexCoin() : kind(0), nValue(0), height(0), nTime(0) {}
+    CMarmaraIndexCoin(uint8_t _kind,const CPubKey &_pk,uint256 _createtxid,const CTxOut &vout,int32_t _height,uint32_t _nTime) : kind(_kind), pk(_pk), createtxid(_createtxid), nValue(vout.nValue), height(_height), nTime(_nTime), scriptPubKey(vout.scriptPubKey) {}
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(kind);
+        READWRITE(pk);
+        READWRITE(createtxid);
+        READWRITE(nValue);
+        READWRITE(height);
+        READWRITE(nTime);
+        READWRITE(*(CScriptBase*)(&scriptPubKey));
+    }
+};
+
+/// confirmed totals of a pubkey, kept next to the coin rows
+struct CMarmaraIndexBalance
+{
+    CAmount nActivated;
+    CAmount nLocked;
+    int64_t nMarkers;       //!< unspent activation markers, the pubkey counts as activated while non zero
+
+    CMarmaraIndexBalance() : nActivated(0), nLocked(0), nMarkers(0) {}
+    void Add(const CMarmaraIndexCoin &coin, int64_t sign);
+    bool IsNull() const { return nActivated == 0 && nLocked == 0 && nMarkers == 0; }
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nActivated);
+        READWRITE(nLocked);
+        READWRITE(nMarkers);
+    }
+};
+
+/// a tx of a credit loop that took the baton, with what it left locked in the loop
+struct CMarmaraLoopTx
+{
+    uint256 txid;
+    int32_t height;
+    CPubKey holder;                     //!< pk of the last vout opret
+    std::vector<CPubKey> endorsers;     //!< pks of its locked-in-loop outputs
+    CAmount nLocked;                    //!< total of its locked-in-loop outputs
+    CAmount nBatonValue;                //!< value of its baton vout, 0 if it is not spendable
+
+    CMarmaraLoopTx() : height(0), nLocked(0), nBatonValue(0) {}
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(height);
+        READWRITE(holder);
+        READWRITE(endorsers);
+        READWRITE(nLocked);
+        READWRITE(nBatonValue);
+    }
+};
+
+/// confirmed state of a credit loop: the create tx opret and the chain of baton spends starting at the create tx
+struct CMarmaraLoopState
+{
+    CScript createOpret;
+    std::vector<CMarmaraLoopTx> chain;
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(*(CScriptBase*)(&createOpret));
+        READWRITE(chain);
+    }
+};
+
+void MarmaraIndexBlock(const CBlock &block, int32_t height, CDBBatch &batch, bool fErase);
+bool GetMarmaraIndexCoins(const CPubKey &pk, uint8_t kind, std::vector<std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> > &coins);
+bool GetMarmaraIndexBalance(const CPubKey &pk, CMarmaraIndexBalance &balance);
+bool GetMarmaraActivatedPubkeys(std::vector<CPubKey> &pks);
+bool GetMarmaraLoopCreatetxid(uint256 txid, uint256 &createtxid);
+bool GetMarmaraLoopState(uint256 createtxid, CMarmaraLoopState &loop);
+
 extern uint8_t ASSETCHAINS_MARMARA;
 //uint64_t komodo_block_prg(uint32_t nHeight);
 
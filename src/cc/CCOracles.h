@@ -18,6 +18,60 @@
 #define CC_ORACLES_H
 
 #include "CCinclude.h"
+#include "CCindex.h"
+
+/// ccindex key of a data sample, heights and positions are big-endian so a publisher's samples sort by block order
+struct COraclesSampleKey
+{
+    uint256 oracletxid;
+    CPubKey publisher;
+    int32_t height;
+    uint32_t txpos;
+
+    COraclesSampleKey() : height(0), txpos(0) {}
+    COraclesSampleKey(uint256 _oracletxid,CPubKey _publisher,int32_t _height,uint32_t _txpos) : oracletxid(_oracletxid), publisher(_publisher), height(_height), txpos(_txpos) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        s.write((const char *)publisher.begin(), CPubKey::COMPRESSED_PUBLIC_KEY_SIZE);
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, txpos);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        uint8_t pk[CPubKey::COMPRESSED_PUBLIC_KEY_SIZE];
+        oracletxid.Unserialize(s);
+        s.read((char *)pk, sizeof(pk));
+        publisher.Set(pk, pk + sizeof(pk));
+        height = ser_readdata32be(s);
+        txpos = ser_readdata32be(s);
+    }
+};
+
+/// decoded data sample, stored so that reading samples needs no transaction fetch
+struct COraclesSample
+{
+    uint256 txid,batontxid;
+    int32_t height;
+    std::vector<uint8_t> data;
+
+    COraclesSample() : height(0) {}
+    COraclesSample(uint256 _txid,uint256 _batontxid,int32_t _height,const std::vector<uint8_t> &_data) : txid(_txid), batontxid(_batontxid), height(_height), data(_data) {}
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(batontxid);
+        READWRITE(height);
+        READWRITE(data);
+    }
+};
+
+void OraclesIndexBlock(const CBlock &block,int32_t height,CDBBatch &batch,bool fErase);
+bool GetOraclesSamples(uint256 oracletxid,CPubKey publisher,int32_t num,std::vector<COraclesSample> &samples);
+bool GetOraclesBatonPublisher(const char *batonaddr,CPubKey &publisher);
 
 bool OraclesValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 UniValue OracleCreate(const CPubKey& pk, int64_t txfee,std::string name,std::string description,std::string format);
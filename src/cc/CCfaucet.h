@@ -19,14 +19,44 @@
 
 #include "CCinclude.h"
 
+#include <atomic>
+
 #define EVAL_FAUCET 0xe4
 #define FAUCETSIZE (COIN / 10)
+#define FAUCET_MAXGRIND 1000000
 
 bool FaucetValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &tx, uint32_t nIn);
 
+/// signed faucetget tx whose opreturn nonce is ground until its txid starts and ends with a zero byte
+struct FaucetGrindTemplate
+{
+    CMutableTransaction mtx;            //!< signed tx, the nonce opreturn is the last vout
+    std::vector<int64_t> vinvalues;     //!< values of the spent faucet outputs, one per vin
+    uint32_t consensusBranchId;
+    uint32_t start;                     //!< first nonce tried
+    CPubKey faucetpk;
+    uint8_t faucetpriv[32];
+
+    FaucetGrindTemplate() : consensusBranchId(0), start(0) { memset(faucetpriv,0,sizeof(faucetpriv)); }
+    ~FaucetGrindTemplate() { memset(faucetpriv,0,sizeof(faucetpriv)); }
+};
+
+/// shared between the grinding threads and whoever waits for them (rpc call or async operation)
+struct FaucetGrindProgress
+{
+    std::atomic<uint64_t> tried;
+    std::atomic<bool> cancelled;
+
+    FaucetGrindProgress() : tried(0), cancelled(false) {}
+};
+
 // CCcustom
 UniValue FaucetFund(const CPubKey& mypk,uint64_t txfee,int64_t funds);
 UniValue FaucetGet(const CPubKey& mypk,uint64_t txfee);
+UniValue FaucetGetTemplate(const CPubKey& mypk,uint64_t txfee,FaucetGrindTemplate &grind);
+UniValue FaucetGrind(const FaucetGrindTemplate &grind,int32_t numthreads,FaucetGrindProgress &progress);
 UniValue FaucetInfo();
 
+bool FaucetSignCond(CC *cond,const CKey &key,const CPubKey &pk,const uint256 &sighash);
+
 #endif
@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "CCindex.h"
+#include "CCOracles.h"
+#include "CCMarmara.h"
+#include "main.h"
+#include "util.h"
+
+CCIndexDB *pccindex;
+static bool fCCIndexComplete;
+
+CCIndexDB::CCIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "ccindex", nCacheSize, fMemory, fWipe, false, 64) { }
+
+bool CCIndexDB::WriteFlag(const std::string &name, bool fValue)
+{
+    return Write(std::make_pair(CCINDEX_FLAG, name), fValue ? '1' : '0', true);
+}
+
+bool CCIndexDB::ReadFlag(const std::string &name, bool &fValue)
+{
+    char ch;
+    if ( !Read(std::make_pair(CCINDEX_FLAG, name), ch) )
+        return false;
+    fValue = ch == '1';
+    return true;
+}
+
+bool CCIndexDB::ReadBestBlock(uint256 &hash, int32_t &height)
+{
+    std::pair<uint256,int32_t> best;
+    if ( !Read(CCINDEX_BESTBLOCK, best) )
+        return false;
+    hash = best.first;
+    height = best.second;
+    return true;
+}
+
+bool CCIndexComplete()
+{
+    return(pccindex != 0 && fCCIndexComplete);
+}
+
+void CCIndexInit(bool fReindex, const CBlockIndex *tip)
+{
+    bool fComplete = false; uint256 besthash; int32_t bestheight;
+    if ( pccindex == 0 )
+        return;
+    if ( fReindex || tip == 0 || tip->GetHeight() <= 0 )
+        pccindex->WriteFlag("complete",true);
+    // indexes written before the best block was recorded followed the chain up to the tip
+    if ( tip != 0 && pccindex->ReadBestBlock(besthash,bestheight) == 0 )
+        pccindex->Write(CCINDEX_BESTBLOCK, std::make_pair(tip->GetBlockHash(),(int32_t)tip->GetHeight()), true);
+    if ( pccindex->ReadFlag("complete",fComplete) == 0 || fComplete == 0 )
+        LogPrintf("ccindex was not built from genesis, CC queries use the address index until -reindex\n");
+    fCCIndexComplete = fComplete;
+}
+
+// the index does not follow the block being connected or disconnected, its rows can no longer be trusted
+static void ccindex_mismatch(const char *action, int32_t height, int32_t bestheight)
+{
+    LogPrintf("ccindex is at height %d while %s block %d, CC queries use the address index until -reindex\n", bestheight, action, height);
+    pccindex->WriteFlag("complete",false);
+    fCCIndexComplete = false;
+}
+
+// true if the block at height is the index's best block or one of its ancestors, so it is already indexed
+static bool ccindex_has_block(const uint256 &besthash, const uint256 &hash, int32_t height)
+{
+    if ( besthash == hash )
+        return true;
+    BlockMap::const_iterator it = mapBlockIndex.find(besthash);
+    if ( it == mapBlockIndex.end() || it->second == 0 || it->second->GetHeight() < height )
+        return false;
+    const CBlockIndex *pindex = it->second->GetAncestor(height);
+    return pindex != 0 && pindex->GetBlockHash() == hash;
+}
+
+void ConnectCCIndexes(const CBlock &block, int32_t height)
+{
+    uint256 hash,besthash; int32_t bestheight;
+    if ( pccindex == 0 )
+        return;
+    hash = block.GetHash();
+    if ( pccindex->ReadBestBlock(besthash,bestheight) != 0 && besthash != block.hashPrevBlock )
+    {
+        if ( ccindex_has_block(besthash,hash,height) )
+            return;
+        ccindex_mismatch("connecting",height,bestheight);
+    }
+    CDBBatch batch(*pccindex);
+    OraclesIndexBlock(block,height,batch,false);
+    MarmaraIndexBlock(block,height,batch,false);
+    batch.Write(CCINDEX_BESTBLOCK, std::make_pair(hash,height));
+    pccindex->WriteBatch(batch);
+}
+
+void DisconnectCCIndexes(const CBlock &block, int32_t height)
+{
+    uint256 besthash; int32_t bestheight;
+    if ( pccindex == 0 )
+        return;
+    if ( pccindex->ReadBestBlock(besthash,bestheight) != 0 && besthash != block.GetHash() )
+    {
+        if ( bestheight < height )
+            return;
+        ccindex_mismatch("disconnecting",height,bestheight);
+    }
+    CDBBatch batch(*pccindex);
+    OraclesIndexBlock(block,height,batch,true);
+    MarmaraIndexBlock(block,height,batch,true);
+    batch.Write(CCINDEX_BESTBLOCK, std::make_pair(block.hashPrevBlock,height - 1));
+    pccindex->WriteBatch(batch);
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef CC_INDEX_H
+#define CC_INDEX_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+
+class CBlockIndex;
+
+/*
+ CCindex is a leveldb (datadir/ccindex) for indexes of decoded CC state, so that rpc calls and validation
+ can range-query it instead of walking the address index and fetching every transaction.
+ Like the notarisations db it is updated from ConnectBlock and DisconnectTip, each module adds its rows
+ to the same batch under its own key prefix.
+ The batch also records the block it was built for, so a block the index already went through (replayed after
+ an unclean shutdown) is not applied twice, and an index that missed blocks stops being used.
+ */
+
+static const char CCINDEX_FLAG = 'F';
+static const char CCINDEX_BESTBLOCK = 'H';          //!< (hash,height) of the last block the index was updated for
+static const char CCINDEX_ORACLES_SAMPLE = 'O';     //!< (oracletxid,publisher,height,txpos) -> decoded data sample
+static const char CCINDEX_ORACLES_BATON = 'o';      //!< baton address -> publisher pubkey
+static const char CCINDEX_MARMARA_COIN = 'M';       //!< (pubkey,kind,txid,vout) -> unspent activated, locked-in-loop or marker output
+static const char CCINDEX_MARMARA_OUTPOINT = 'm';   //!< outpoint -> the coin rows it carries, to find them when it is spent
+static const char CCINDEX_MARMARA_BALANCE = 'N';    //!< pubkey -> activated and locked-in-loop totals
+static const char CCINDEX_MARMARA_UNDO = 'n';       //!< (height,outpoint) -> coin rows spent in that block, restored on disconnect
+static const char CCINDEX_MARMARA_LOOP = 'L';       //!< createtxid -> credit loop state
+static const char CCINDEX_MARMARA_LOOPTX = 'l';     //!< txid of a create, request, issue or transfer tx -> createtxid
+static const char CCINDEX_MARMARA_BATON = 'b';      //!< txid holding the baton of loops -> their createtxids
+
+class CCIndexDB : public CDBWrapper
+{
+public:
+    CCIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool WriteFlag(const std::string &name, bool fValue);
+    bool ReadFlag(const std::string &name, bool &fValue);
+    bool ReadBestBlock(uint256 &hash, int32_t &height);
+};
+
+extern CCIndexDB *pccindex;
+
+/// true if the index was built from genesis (fresh datadir or -reindex), otherwise callers must use the legacy scans
+bool CCIndexComplete();
+/// marks the index complete if it is going to see every block from genesis
+void CCIndexInit(bool fReindex, const CBlockIndex *tip);
+
+void ConnectCCIndexes(const CBlock &block, int32_t height);
+void DisconnectCCIndexes(const CBlock &block, int32_t height);
+
+#endif
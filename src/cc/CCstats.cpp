@@ -0,0 +1,244 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+#include "CCstats.h"
+
+#include "cc/eval.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "tinyformat.h"
+#include "utiltime.h"
+
+CCStats ccStats;
+
+// innermost validation being timed on this thread
+static thread_local CCValidationTimer *pccValidationTimer = NULL;
+// innermost capture installed on this thread
+static thread_local CCValidationCapture *pccValidationCapture = NULL;
+
+CCValidationStats::CCValidationStats() : nCalls(0), nInvalid(0), nTotalMicros(0), nMaxMicros(0), nGetTransaction(0), nUnspents(0), nTxids(0)
+{
+    for (int i = 0; i < CCSTATS_NUM_BUCKETS; i++)
+        nBuckets[i] = 0;
+}
+
+void CCValidationStats::Record(int64_t nMicros, bool fValid, const CCValidationStats &lookups)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    int bucket = 0;
+    while (bucket < CCSTATS_NUM_BUCKETS-1 && nMicros > CCSTATS_BUCKET_BOUNDS[bucket])
+        bucket++;
+    nCalls++;
+    if (!fValid)
+        nInvalid++;
+    nTotalMicros += nMicros;
+    nMaxMicros = std::max(nMaxMicros, (uint64_t)nMicros);
+    nBuckets[bucket]++;
+    nGetTransaction += lookups.nGetTransaction;
+    nUnspents += lookups.nUnspents;
+    nTxids += lookups.nTxids;
+}
+
+void CCValidationStats::Add(const CCValidationStats &other)
+{
+    nCalls += other.nCalls;
+    nInvalid += other.nInvalid;
+    nTotalMicros += other.nTotalMicros;
+    nMaxMicros = std::max(nMaxMicros, other.nMaxMicros);
+    for (int i = 0; i < CCSTATS_NUM_BUCKETS; i++)
+        nBuckets[i] += other.nBuckets[i];
+    nGetTransaction += other.nGetTransaction;
+    nUnspents += other.nUnspents;
+    nTxids += other.nTxids;
+}
+
+UniValue CCValidationStats::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ), histogram(UniValue::VOBJ);
+    obj.push_back(Pair("calls", nCalls));
+    obj.push_back(Pair("invalid", nInvalid));
+    obj.push_back(Pair("total_ms", nTotalMicros / 1000.0));
+    obj.push_back(Pair("avg_us", nCalls != 0 ? (double)nTotalMicros / nCalls : 0.0));
+    obj.push_back(Pair("max_us", nMaxMicros));
+    for (int i = 0; i < CCSTATS_NUM_BUCKETS; i++)
+    {
+        std::string label = i < CCSTATS_NUM_BUCKETS-1 ? strprintf("le_%dus", CCSTATS_BUCKET_BOUNDS[i]) : "inf";
+        histogram.push_back(Pair(label, nBuckets[i]));
+    }
+    obj.push_back(Pair("histogram", histogram));
+    obj.push_back(Pair("gettransaction", nGetTransaction));
+    obj.push_back(Pair("unspents", nUnspents));
+    obj.push_back(Pair("txids", nTxids));
+    return obj;
+}
+
+void CCStats::Record(uint8_t evalcode, uint8_t funcid, int64_t nMicros, bool fValid, const CCValidationStats &lookups)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapStats[((uint16_t)evalcode << 8) | funcid].Record(nMicros, fValid, lookups);
+}
+
+void CCStats::Reset()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapStats.clear();
+}
+
+static std::string FuncIdStr(uint8_t funcid)
+{
+    if (funcid > ' ' && funcid < 0x7f)
+        return std::string(1, (char)funcid);
+    return strprintf("0x%02x", funcid);
+}
+
+UniValue CCStats::ToJSON() const
+{
+    std::map<uint16_t, CCValidationStats> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        snapshot = mapStats;
+    }
+    UniValue result(UniValue::VARR);
+    std::map<uint16_t, CCValidationStats>::const_iterator it = snapshot.begin();
+    while (it != snapshot.end())
+    {
+        uint8_t evalcode = it->first >> 8;
+        CCValidationStats total;
+        UniValue funcids(UniValue::VOBJ);
+        for (; it != snapshot.end() && (it->first >> 8) == evalcode; ++it)
+        {
+            total.Add(it->second);
+            funcids.push_back(Pair(FuncIdStr(it->first & 0xff), it->second.ToJSON()));
+        }
+        UniValue obj = total.ToJSON();
+        obj.push_back(Pair("evalcode", strprintf("0x%02x", evalcode)));
+        obj.push_back(Pair("name", EvalToStr(evalcode)));
+        obj.push_back(Pair("funcids", funcids));
+        result.push_back(obj);
+    }
+    return result;
+}
+
+std::string CCStats::ToPrometheus() const
+{
+    std::map<uint16_t, CCValidationStats> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        snapshot = mapStats;
+    }
+    std::string calls, invalid, buckets, sum, count, gettx, unspents, txids;
+    for (const auto &entry : snapshot)
+    {
+        const CCValidationStats &stats = entry.second;
+        std::string labels = strprintf("evalcode=\"0x%02x\",name=\"%s\",funcid=\"%s\"",
+                                       entry.first >> 8, EvalToStr(entry.first >> 8), FuncIdStr(entry.first & 0xff));
+        calls += strprintf("komodo_cc_validations_total{%s} %u\n", labels, stats.nCalls);
+        invalid += strprintf("komodo_cc_validations_invalid_total{%s} %u\n", labels, stats.nInvalid);
+        uint64_t cumulative = 0;
+        for (int i = 0; i < CCSTATS_NUM_BUCKETS; i++)
+        {
+            cumulative += stats.nBuckets[i];
+            std::string le = i < CCSTATS_NUM_BUCKETS-1 ? strprintf("%g", CCSTATS_BUCKET_BOUNDS[i] / 1e6) : "+Inf";
+            buckets += strprintf("komodo_cc_validation_seconds_bucket{%s,le=\"%s\"} %u\n", labels, le, cumulative);
+        }
+        sum += strprintf("komodo_cc_validation_seconds_sum{%s} %g\n", labels, stats.nTotalMicros / 1e6);
+        count += strprintf("komodo_cc_validation_seconds_count{%s} %u\n", labels, stats.nCalls);
+        gettx += strprintf("komodo_cc_gettransaction_total{%s} %u\n", labels, stats.nGetTransaction);
+        unspents += strprintf("komodo_cc_unspents_total{%s} %u\n", labels, stats.nUnspents);
+        txids += strprintf("komodo_cc_txids_total{%s} %u\n", labels, stats.nTxids);
+    }
+    return "# HELP komodo_cc_validations_total CC validations by evalcode and funcid\n"
+           "# TYPE komodo_cc_validations_total counter\n" + calls +
+           "# HELP komodo_cc_validations_invalid_total CC validations that failed\n"
+           "# TYPE komodo_cc_validations_invalid_total counter\n" + invalid +
+           "# HELP komodo_cc_validation_seconds Time spent in CC validation\n"
+           "# TYPE komodo_cc_validation_seconds histogram\n" + buckets + sum + count +
+           "# HELP komodo_cc_gettransaction_total myGetTransaction calls made by CC validation\n"
+           "# TYPE komodo_cc_gettransaction_total counter\n" + gettx +
+           "# HELP komodo_cc_unspents_total SetCCunspents calls made by CC validation\n"
+           "# TYPE komodo_cc_unspents_total counter\n" + unspents +
+           "# HELP komodo_cc_txids_total SetCCtxids calls made by CC validation\n"
+           "# TYPE komodo_cc_txids_total counter\n" + txids;
+}
+
+CCValidationTimer::CCValidationTimer(uint8_t evalcodeIn, const CTransaction &tx) : evalcode(evalcodeIn), funcid(0), fStopped(false)
+{
+    // most modules encode the funcid right after the evalcode in the last vout's opreturn
+    if (tx.vout.size() > 0)
+    {
+        const CScript &script = tx.vout.back().scriptPubKey;
+        CScript::const_iterator pc = script.begin();
+        opcodetype opcode;
+        std::vector<uint8_t> vopret;
+        if (script.size() > 0 && script[0] == OP_RETURN && script.GetOp(++pc, opcode, vopret) && vopret.size() >= 2)
+            funcid = vopret[1];
+    }
+    pprev = pccValidationTimer;
+    pccValidationTimer = this;
+    nStart = GetTimeMicros();
+}
+
+CCValidationTimer::~CCValidationTimer()
+{
+    // leaving by exception counts as a failed validation
+    if (!fStopped)
+        Stop(false);
+}
+
+void CCValidationTimer::Stop(bool fValid)
+{
+    if (fStopped)
+        return;
+    fStopped = true;
+    int64_t nMicros = GetTimeMicros() - nStart;
+    ccStats.Record(evalcode, funcid, nMicros, fValid, lookups);
+    CCValidationCapture::Record(evalcode, funcid, nMicros, fValid, lookups);
+    pccValidationTimer = pprev;
+}
+
+void CCValidationTimer::CountGetTransaction()
+{
+    if (pccValidationTimer != NULL)
+        pccValidationTimer->lookups.nGetTransaction++;
+}
+
+void CCValidationTimer::CountUnspents()
+{
+    if (pccValidationTimer != NULL)
+        pccValidationTimer->lookups.nUnspents++;
+}
+
+void CCValidationTimer::CountTxids()
+{
+    if (pccValidationTimer != NULL)
+        pccValidationTimer->lookups.nTxids++;
+}
+
+CCValidationCapture::CCValidationCapture()
+{
+    pprev = pccValidationCapture;
+    pccValidationCapture = this;
+}
+
+CCValidationCapture::~CCValidationCapture()
+{
+    pccValidationCapture = pprev;
+}
+
+void CCValidationCapture::Record(uint8_t evalcode, uint8_t funcid, int64_t nMicros, bool fValid, const CCValidationStats &lookups)
+{
+    if (pccValidationCapture != NULL)
+        pccValidationCapture->mapStats[((uint16_t)evalcode << 8) | funcid].Record(nMicros, fValid, lookups);
+}
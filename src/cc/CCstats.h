@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+#ifndef CC_STATS_H
+#define CC_STATS_H
+
+#include <univalue.h>
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+class CTransaction;
+
+/*
+ CCstats keeps counters and latency histograms of CC validation per evalcode and funcid, so a slow
+ block can be traced back to the module that made it slow. RunCCEval times each Eval::Dispatch and the
+ chain lookups (myGetTransaction, SetCCunspents, SetCCtxids) made while it runs are charged to it.
+ The funcid is taken from the opreturn of the validated tx (second byte of its data), 0 if there is none.
+ */
+
+//! upper bounds of the latency buckets in microseconds, the last bucket is unbounded
+static const int64_t CCSTATS_BUCKET_BOUNDS[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+static const int CCSTATS_NUM_BUCKETS = 7;
+
+struct CCValidationStats
+{
+    uint64_t nCalls;
+    uint64_t nInvalid;
+    uint64_t nTotalMicros;
+    uint64_t nMaxMicros;
+    uint64_t nBuckets[CCSTATS_NUM_BUCKETS];
+    uint64_t nGetTransaction;   //!< myGetTransaction calls
+    uint64_t nUnspents;         //!< SetCCunspents calls
+    uint64_t nTxids;            //!< SetCCtxids calls
+
+    CCValidationStats();
+    void Record(int64_t nMicros, bool fValid, const CCValidationStats &lookups);
+    void Add(const CCValidationStats &other);
+    UniValue ToJSON() const;
+};
+
+class CCStats
+{
+private:
+    mutable std::mutex cs;
+    std::map<uint16_t, CCValidationStats> mapStats;    //!< (evalcode << 8) | funcid
+
+public:
+    // validation is serialized by KOMODO_CC_mutex, so the lock is uncontended except for rpc readers
+    void Record(uint8_t evalcode, uint8_t funcid, int64_t nMicros, bool fValid, const CCValidationStats &lookups);
+    void Reset();
+    UniValue ToJSON() const;
+    //! Prometheus text exposition format
+    std::string ToPrometheus() const;
+};
+
+extern CCStats ccStats;
+
+/** Times one CC validation into ccStats and collects the lookups made by this thread meanwhile */
+class CCValidationTimer
+{
+private:
+    uint8_t evalcode;
+    uint8_t funcid;
+    int64_t nStart;
+    bool fStopped;
+    CCValidationStats lookups;
+    CCValidationTimer *pprev;
+
+public:
+    CCValidationTimer(uint8_t evalcodeIn, const CTransaction &tx);
+    ~CCValidationTimer();
+
+    void Stop(bool fValid);
+
+    //! called from the lookup functions, no-ops outside of a validation
+    static void CountGetTransaction();
+    static void CountUnspents();
+    static void CountTxids();
+};
+
+/**
+ * While in scope, the CC validations run by this thread are also recorded here, keyed like CCStats.
+ * Used by ccreplay to attribute the cost of each input to the modules it invoked.
+ */
+class CCValidationCapture
+{
+private:
+    CCValidationCapture *pprev;
+
+public:
+    std::map<uint16_t, CCValidationStats> mapStats;
+
+    CCValidationCapture();
+    ~CCValidationCapture();
+
+    static void Record(uint8_t evalcode, uint8_t funcid, int64_t nMicros, bool fValid, const CCValidationStats &lookups);
+};
+
+#endif // CC_STATS_H
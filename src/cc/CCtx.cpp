@@ -15,6 +15,7 @@
 
 #include "CCinclude.h"
 #include "CCtokens.h"
+#include "CCstats.h"
 #include "key_io.h"
 
 std::vector<CPubKey> NULL_pubkeys;
@@ -428,6 +429,7 @@ void NSPV_CCtxids(std::vector<uint256> &txids,char *coinaddr,bool ccflag, uint8_
 void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,char *coinaddr,bool ccflag)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
+    CCValidationTimer::CountUnspents();
     if ( KOMODO_NSPV_SUPERLITE )
     {
         NSPV_CCunspents(unspentOutputs,coinaddr,ccflag);
@@ -452,6 +454,7 @@ void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValu
 void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool ccflag)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
+    CCValidationTimer::CountTxids();
     if ( KOMODO_NSPV_SUPERLITE )
     {
         NSPV_CCtxids(addressIndex,coinaddr,ccflag);
@@ -476,6 +479,7 @@ void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex
 void SetCCtxids(std::vector<uint256> &txids,char *coinaddr,bool ccflag, uint8_t evalcode, int64_t amount, uint256 filtertxid, uint8_t func)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
+    CCValidationTimer::CountTxids();
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     if ( KOMODO_NSPV_SUPERLITE )
     {
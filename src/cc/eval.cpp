@@ -22,6 +22,7 @@
 #include "cc/eval.h"
 #include "cc/utils.h"
 #include "cc/CCinclude.h"
+#include "cc/CCstats.h"
 #include "main.h"
 #include "chain.h"
 #include "core_io.h"
@@ -38,7 +39,9 @@ bool RunCCEval(const CC *cond, const CTransaction &tx, unsigned int nIn)
 {
     EvalRef eval;
     pthread_mutex_lock(&KOMODO_CC_mutex);
+    CCValidationTimer timer(cond->codeLength > 0 ? cond->code[0] : 0, tx);
     bool out = eval->Dispatch(cond, tx, nIn);
+    timer.Stop(out);
     pthread_mutex_unlock(&KOMODO_CC_mutex);
     if ( eval->state.IsValid() != out)
         fprintf(stderr,"out %d vs %d isValid\n",(int32_t)out,(int32_t)eval->state.IsValid());
@@ -16,6 +16,9 @@
 #include "CCfaucet.h"
 #include "../txmempool.h"
 
+#include <mutex>
+#include <thread>
+
 /*
  This file implements a simple CC faucet as an example of how to make a new CC contract. It wont have any fancy sybil protection but will serve the purpose of a fully automated faucet.
  
@@ -177,15 +180,185 @@ int64_t AddFaucetInputs(struct CCcontract_info *cp,CMutableTransaction &mtx,CPub
     return(totalinputs);
 }
 
+static CScript FaucetGetOpret(uint32_t j)
+{
+    return(CScript() << OP_RETURN << E_MARSHAL(ss << (uint8_t)EVAL_FAUCET << (uint8_t)'G' << j));
+}
+
+static bool FaucetValidTxid(const uint256 &txid)
+{
+    const uint8_t *hash = txid.begin();
+    return((hash[0] & 0xff) == 0 && (hash[31] & 0xff) == 0);
+}
+
+// builds and signs the faucetget tx once, so the grinding threads only need to redo the nonce dependent parts
+UniValue FaucetGetTemplate(const CPubKey& pk, uint64_t txfee, FaucetGrindTemplate &grind)
+{
+    CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
+    CPubKey faucetpk; int64_t inputs,CCchange=0,nValue=FAUCETSIZE; struct CCcontract_info *cp,C; CTransaction vintx; uint256 hashBlock; char destaddr[64]; int32_t i;
+    cp = CCinit(&C,EVAL_FAUCET);
+    if ( txfee == 0 )
+        txfee = 10000;
+    faucetpk = GetUnspendable(cp,grind.faucetpriv);
+    CPubKey mypk = pk.IsValid()?pk:pubkey2pk(Mypubkey());
+    if ( (inputs= AddFaucetInputs(cp,mtx,faucetpk,nValue+txfee,60)) <= 0 )
+        CCERR_RESULT("faucet",CCLOG_ERROR, stream << "can't find faucet inputs");
+    if ( inputs > nValue )
+        CCchange = (inputs - nValue - txfee);
+    if ( CCchange != 0 )
+        mtx.vout.push_back(MakeCC1vout(EVAL_FAUCET,CCchange,faucetpk));
+    mtx.vout.push_back(CTxOut(nValue,CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG));
+    grind.start = rand() & 0xfffffff;
+    UniValue result = FinalizeCCTxExt(false,-1LL,cp,mtx,mypk,txfee,FaucetGetOpret(grind.start));
+    if ( result[JSON_HEXTX].getValStr().size() <= 1 )
+        CCERR_RESULT("faucet",CCLOG_ERROR, stream << "couldn't sign faucetget tx");
+    grind.vinvalues.clear();
+    for (i=0; i<mtx.vin.size(); i++)
+    {
+        if ( myGetTransaction(mtx.vin[i].prevout.hash,vintx,hashBlock) == 0 || mtx.vin[i].prevout.n >= vintx.vout.size() )
+            CCERR_RESULT("faucet",CCLOG_ERROR, stream << "couldn't get vin." << i << " tx");
+        // every vin is re-signed with the faucet key, anything else would need the full FinalizeCCTx path
+        if ( Getscriptaddress(destaddr,vintx.vout[mtx.vin[i].prevout.n].scriptPubKey) == 0 || strcmp(destaddr,cp->unspendableCCaddr) != 0 )
+            CCERR_RESULT("faucet",CCLOG_ERROR, stream << "vin." << i << " is not a faucet output");
+        grind.vinvalues.push_back(vintx.vout[mtx.vin[i].prevout.n].nValue);
+    }
+    grind.mtx = mtx;
+    grind.faucetpk = faucetpk;
+    grind.consensusBranchId = CurrentEpochBranchId(chainActive.Height() + 1, Params().GetConsensus());
+    return(result);
+}
+
+struct FaucetGrindShared
+{
+    std::mutex mutex;
+    std::atomic<bool> found;
+    CMutableTransaction tx;
+    uint32_t iterations;
+
+    FaucetGrindShared() : found(false), iterations(0) {}
+};
+
+// Signs every secp256k1 leaf of cond with key. CKey signs on the node's shared
+// read-only context, so unlike cc_signTreeSecp256k1Msg32 it takes no global
+// lock and does no per-signature context randomization. RFC6979 nonces and
+// low S make the compact signature identical to the cryptoconditions one.
+bool FaucetSignCond(CC *cond,const CKey &key,const CPubKey &pk,const uint256 &sighash)
+{
+    std::vector<unsigned char> vchSig; int32_t i;
+    if ( cc_typeId(cond) == CC_Threshold )
+    {
+        for (i=0; i<cond->size; i++)
+            if ( FaucetSignCond(cond->subconditions[i],key,pk,sighash) == false )
+                return(false);
+        return(true);
+    }
+    if ( cc_typeId(cond) != CC_Secp256k1 || memcmp(cond->publicKey,pk.begin(),CPubKey::COMPRESSED_PUBLIC_KEY_SIZE) != 0 )
+        return(true);
+    if ( key.SignCompact(sighash,vchSig) == false || vchSig.size() != 65 )
+        return(false);
+    if ( cond->signature == 0 )
+        cond->signature = (uint8_t *)calloc(1,64);
+    memcpy(cond->signature,&vchSig[1],64);
+    return(true);
+}
+
+static void FaucetGrindWorker(const FaucetGrindTemplate *grind,uint32_t offset,uint32_t stride,FaucetGrindProgress *progress,FaucetGrindShared *shared)
+{
+    CMutableTransaction mtx = grind->mtx; CC *cond; uint32_t j; int32_t i,numvins = mtx.vin.size(); bool signedok;
+    std::vector<uint256> sighashes(numvins);
+    cond = MakeCCcond1(EVAL_FAUCET,grind->faucetpk);
+    CScript scriptCode = CCPubKey(cond);
+    CKey key;
+    key.Set(grind->faucetpriv,grind->faucetpriv+32,true);
+    // prevouts and sequences never change, and all outputs but the nonce opreturn are fixed
+    PrecomputedTransactionData txdata(mtx);
+    const CBLAKE2bWriter outputsprefix = GetOutputsHashPrefix(mtx, mtx.vout.size() - 1);
+    for (j=offset; j<FAUCET_MAXGRIND && !shared->found.load() && !progress->cancelled.load(); j+=stride)
+    {
+        mtx.vout.back().scriptPubKey = FaucetGetOpret(grind->start + j);
+        CBLAKE2bWriter ss(outputsprefix);
+        ss << mtx.vout.back();
+        txdata.hashOutputs = ss.GetHash();
+        // the sighash doesn't cover scriptSigs, so hash all vins against one snapshot before signing
+        {
+            const CTransaction txTo(mtx);
+            for (i=0; i<numvins; i++)
+                sighashes[i] = SignatureHash(scriptCode,txTo,i,SIGHASH_ALL,grind->vinvalues[i],grind->consensusBranchId,&txdata);
+        }
+        for (signedok=true,i=0; i<numvins; i++)
+        {
+            if ( FaucetSignCond(cond,key,grind->faucetpk,sighashes[i]) == false )
+            {
+                signedok = false;
+                break;
+            }
+            mtx.vin[i].scriptSig = CCSig(cond);
+        }
+        progress->tried.fetch_add(1,std::memory_order_relaxed);
+        if ( signedok && FaucetValidTxid(mtx.GetHash()) )
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            if ( !shared->found.load() )
+            {
+                shared->tx = mtx;
+                shared->iterations = j;
+                shared->found.store(true);
+            }
+        }
+    }
+    cc_free(cond);
+}
+
+// spreads the nonce search over numthreads, the serialized tx is hashed in binary and never hex encoded until it is found
+UniValue FaucetGrind(const FaucetGrindTemplate &grind, int32_t numthreads, FaucetGrindProgress &progress)
+{
+    FaucetGrindShared shared; std::vector<std::thread> workers; int32_t i;
+    if ( grind.mtx.vout.empty() || grind.vinvalues.size() != grind.mtx.vin.size() )
+        CCERR_RESULT("faucet",CCLOG_ERROR, stream << "invalid faucetget template");
+    if ( FaucetValidTxid(grind.mtx.GetHash()) )
+    {
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair(JSON_HEXTX,EncodeHexTx(grind.mtx)));
+        return(result);
+    }
+    if ( numthreads < 1 )
+        numthreads = 1;
+    fprintf(stderr,"start at %u with %d threads\n",(uint32_t)time(NULL),numthreads);
+    for (i=0; i<numthreads; i++)
+        workers.push_back(std::thread(FaucetGrindWorker,&grind,(uint32_t)i,(uint32_t)numthreads,&progress,&shared));
+    for (auto &t : workers)
+        t.join();
+    if ( shared.found.load() )
+    {
+        fprintf(stderr,"found valid txid after %u iterations %u\n",shared.iterations,(uint32_t)time(NULL));
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair(JSON_HEXTX,EncodeHexTx(shared.tx)));
+        return(result);
+    }
+    if ( progress.cancelled.load() )
+        CCERR_RESULT("faucet",CCLOG_INFO, stream << "faucetget cancelled after " << progress.tried.load() << " iterations");
+    CCERR_RESULT("faucet",CCLOG_ERROR, stream << "couldn't generate valid txid " << (uint32_t)time(NULL));
+}
+
 UniValue FaucetGet(const CPubKey& pk, uint64_t txfee)
 {
     CMutableTransaction tmpmtx,mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
-    CPubKey faucetpk; int64_t inputs,CCchange=0,nValue=FAUCETSIZE; struct CCcontract_info *cp,C; std::string rawhex; uint32_t j; int32_t i,len; uint8_t buf[32768]; bits256 hash;
+    CPubKey faucetpk; int64_t inputs,CCchange=0,nValue=FAUCETSIZE; struct CCcontract_info *cp,C; uint32_t j; int32_t i,len; uint8_t buf[32768]; bits256 hash;
+    if ( !pk.IsValid() )
+    {
+        // signed locally: grind the nonce on all cores
+        FaucetGrindTemplate grind; FaucetGrindProgress progress;
+        UniValue result = FaucetGetTemplate(pk,txfee,grind);
+        if ( result[JSON_HEXTX].getValStr().size() <= 1 )
+            return(result);
+        return(FaucetGrind(grind,GetNumCores(),progress));
+    }
+    // remote nspv call: the client signs, so the unsigned tx is what we can grind on
     cp = CCinit(&C,EVAL_FAUCET);
     if ( txfee == 0 )
         txfee = 10000;
     faucetpk = GetUnspendable(cp,0);
-    CPubKey mypk = pk.IsValid()?pk:pubkey2pk(Mypubkey());
+    CPubKey mypk = pk;
     if ( (inputs= AddFaucetInputs(cp,mtx,faucetpk,nValue+txfee,60)) > 0 )
     {
         if ( inputs > nValue )
@@ -195,10 +368,10 @@ UniValue FaucetGet(const CPubKey& pk, uint64_t txfee)
         mtx.vout.push_back(CTxOut(nValue,CScript() << ParseHex(HexStr(mypk)) << OP_CHECKSIG));
         fprintf(stderr,"start at %u\n",(uint32_t)time(NULL));
         j = rand() & 0xfffffff;
-        for (i=0; i<1000000; i++,j++)
+        for (i=0; i<FAUCET_MAXGRIND; i++,j++)
         {
             tmpmtx = mtx;
-            UniValue result = FinalizeCCTxExt(pk.IsValid (),-1LL,cp,tmpmtx,mypk,txfee,CScript() << OP_RETURN << E_MARSHAL(ss << (uint8_t)EVAL_FAUCET << (uint8_t)'G' << j));
+            UniValue result = FinalizeCCTxExt(true,-1LL,cp,tmpmtx,mypk,txfee,FaucetGetOpret(j));
             if ( (len= (int32_t)result[JSON_HEXTX].getValStr().size()) > 0 && len < 65536 )
             {
                 len >>= 1;
@@ -209,7 +382,6 @@ UniValue FaucetGet(const CPubKey& pk, uint64_t txfee)
                     fprintf(stderr,"found valid txid after %d iterations %u\n",i,(uint32_t)time(NULL));
                     return result;
                 }
-                //fprintf(stderr,"%02x%02x ",hash.bytes[0],hash.bytes[31]);
             }
         }
         CCERR_RESULT("faucet",CCLOG_ERROR, stream << "couldn't generate valid txid " << (uint32_t)time(NULL));
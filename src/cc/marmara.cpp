@@ -17,6 +17,8 @@
 #include "CCMarmara.h"
 #include "key_io.h"
 
+extern bool fSpentIndex;
+
  /*
   Marmara CC is for the MARMARA project
 
@@ -928,6 +930,8 @@ static int32_t get_create_txid(uint256 &createtxid, uint256 txid)
     uint256 hashBlock; 
   
     createtxid = zeroid;
+    if (GetMarmaraLoopCreatetxid(txid, createtxid))
+        return(0);
     if (myGetTransaction(txid, tx, hashBlock) != 0 && !hashBlock.IsNull() && tx.vout.size() > 1)  // might be called from validation code, so non-locking version
     {
         uint8_t funcid;
@@ -967,6 +971,37 @@ int32_t MarmaraGetbatontxid(std::vector<uint256> &creditloop, uint256 &batontxid
     if (get_create_txid(createtxid, txid) == 0) // retrieve the initial creation txid
     {
         uint256 spenttxid;
+        CMarmaraLoopState loop;
+
+        // the loop index has the confirmed baton chain, only an unconfirmed spend of the create tx baton
+        // changes the result of the spent index walk below (it ends in the mempool, that is a bad loop)
+        if (fSpentIndex && GetMarmaraLoopState(createtxid, loop))
+        {
+            CSpentIndexKey spentkey(createtxid, MARMARA_BATON_VOUT);
+            CSpentIndexValue spentvalue;
+            n = loop.chain.size() - 1;
+            if (n == 0)
+            {
+                if (mempool.getSpentIndex(spentkey, spentvalue))
+                {
+                    LOGSTREAMFN("marmara", CCLOG_ERROR, stream << "n != 0 return bad loop querytxid=" << querytxid.GetHex() << " n=" << n << std::endl);
+                    return -1;
+                }
+                return 0;   // empty loop
+            }
+            if (loop.chain.back().nBatonValue <= 0)
+            {
+                LOGSTREAMFN("marmara", CCLOG_ERROR, stream << "n != 0 return bad loop querytxid=" << querytxid.GetHex() << " n=" << n << std::endl);
+                return -1;
+            }
+            for (int32_t i = 0; i < n; i++)
+                creditloop.push_back(loop.chain[i].txid);
+            batontxid = loop.chain.back().txid;
+            if (loop.chain.back().nBatonValue != 10000)
+                LOGSTREAMFN("marmara", CCLOG_ERROR, stream  << "n=" << n << " found and will use false baton=" << batontxid.GetHex() << " vout=" << MARMARA_BATON_VOUT << " value=" << loop.chain.back().nBatonValue << std::endl);
+            return n;
+        }
+
         txid = createtxid;
         //fprintf(stderr,"%s txid.%s -> createtxid %s\n", logFuncName, txid.GetHex().c_str(),createtxid.GetHex().c_str());
 
@@ -1019,7 +1054,10 @@ static int32_t get_loop_creation_data(uint256 createtxid, struct SMarmaraCreditL
 {
     CTransaction tx;
     uint256 hashBlock;
+    CMarmaraLoopState loop;
 
+    if (GetMarmaraLoopState(createtxid, loop))  // only create txs are indexed
+        return MarmaraDecodeLoopOpret(loop.createOpret, loopData) == MARMARA_CREATELOOP ? 0 : -1;
     if (myGetTransaction(createtxid, tx, hashBlock) != 0 && !hashBlock.IsNull() && tx.vout.size() > 1)  // might be called from validation code, so non-locking version
     {
         uint8_t funcid;
@@ -1992,6 +2030,413 @@ int32_t MarmaraValidateStakeTx(const char *destaddr, const CScript &vintxOpret,
     return MARMARA_NOT_STAKE_TX;
 }
 
+// activated and locked-in-loop index, maintained from ConnectBlock/DisconnectTip through ConnectCCIndexes
+// rows are decided from the output alone, with the same checks the address index scans below apply to each utxo
+
+void CMarmaraIndexBalance::Add(const CMarmaraIndexCoin &coin, int64_t sign)
+{
+    if (coin.kind == MARMARA_INDEX_ACTIVATED)
+        nActivated += sign * coin.nValue;
+    else if (coin.kind == MARMARA_INDEX_LOCKED)
+        nLocked += sign * coin.nValue;
+    else if (coin.kind == MARMARA_INDEX_MARKER)
+        nMarkers += sign;
+}
+
+static void marmara_index_vout(struct CCcontract_info *cp, const CPubKey &Marmarapk, const CScript &markerspk, const CTransaction &tx, int32_t nvout, int32_t height, uint32_t nTime, std::vector<CMarmaraIndexCoin> &coins)
+{
+    const CTxOut &vout = tx.vout[nvout];
+    CPubKey pk;
+
+    if (!vout.scriptPubKey.IsPayToCryptoCondition())
+        return;
+    if (vout.nValue == MARMARA_ACTIVATED_MARKER_AMOUNT && vout.scriptPubKey == markerspk)
+    {
+        // a marker stands for every pubkey its tx activated coins for
+        std::set<CPubKey> pks;
+        for (int32_t i = 0; i < tx.vout.size(); i++)
+        {
+            CScript opret;
+            CMarmaraActivatedOpretChecker activatedChecker;
+            if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition() && get_either_opret(&activatedChecker, tx, i, opret, pk))
+                pks.insert(pk);
+        }
+        for (const auto &markerpk : pks)
+            coins.push_back(CMarmaraIndexCoin(MARMARA_INDEX_MARKER, markerpk, zeroid, vout, height, nTime));
+        return;
+    }
+    if (IsMarmaraActivatedVout(tx, nvout, pk))
+    {
+        coins.push_back(CMarmaraIndexCoin(MARMARA_INDEX_ACTIVATED, pk, zeroid, vout, height, nTime));
+        return;
+    }
+    if (!tx.IsCoinBase())
+    {
+        CScript opret;
+        CMarmaraLockInLoopOpretChecker lockinloopChecker(CHECK_ONLY_CCOPRET);
+        if (get_either_opret(&lockinloopChecker, tx, nvout, opret, pk))
+        {
+            struct SMarmaraCreditLoopOpret loopData;
+            char loopaddr[KOMODO_ADDRESS_BUFSIZE], utxoaddr[KOMODO_ADDRESS_BUFSIZE];
+
+            MarmaraDecodeLoopOpret(opret, loopData);
+            GetCCaddress1of2(cp, loopaddr, Marmarapk, CCtxidaddr_tweak(NULL, loopData.createtxid));
+            if (Getscriptaddress(utxoaddr, vout.scriptPubKey) && strcmp(loopaddr, utxoaddr) == 0)
+                coins.push_back(CMarmaraIndexCoin(MARMARA_INDEX_LOCKED, pk, loopData.createtxid, vout, height, nTime));
+        }
+    }
+}
+
+static void marmara_index_add(CDBBatch &batch, const COutPoint &outpoint, const std::vector<CMarmaraIndexCoin> &coins, std::map<CPubKey, CMarmaraIndexBalance> &balances)
+{
+    batch.Write(std::make_pair(CCINDEX_MARMARA_OUTPOINT, outpoint), coins);
+    for (const auto &coin : coins)
+    {
+        batch.Write(std::make_pair(CCINDEX_MARMARA_COIN, CMarmaraIndexKey(coin.pk, coin.kind, outpoint.hash, outpoint.n)), coin);
+        balances[coin.pk].Add(coin, 1);
+    }
+}
+
+static void marmara_index_remove(CDBBatch &batch, const COutPoint &outpoint, const std::vector<CMarmaraIndexCoin> &coins, std::map<CPubKey, CMarmaraIndexBalance> &balances)
+{
+    batch.Erase(std::make_pair(CCINDEX_MARMARA_OUTPOINT, outpoint));
+    for (const auto &coin : coins)
+    {
+        batch.Erase(std::make_pair(CCINDEX_MARMARA_COIN, CMarmaraIndexKey(coin.pk, coin.kind, outpoint.hash, outpoint.n)));
+        balances[coin.pk].Add(coin, -1);
+    }
+}
+
+// loop rows of the block being indexed, read through from the db and written to the batch at the end
+class CMarmaraLoopIndexView
+{
+private:
+    std::map<uint256, std::pair<bool, CMarmaraLoopState> > loops;  // createtxid -> (exists, state)
+    std::map<uint256, std::vector<uint256> > batons;                // baton txid -> createtxids, empty if removed
+
+public:
+    bool GetLoop(uint256 createtxid, CMarmaraLoopState &loop)
+    {
+        auto it = loops.find(createtxid);
+        if (it == loops.end())
+        {
+            std::pair<bool, CMarmaraLoopState> entry;
+            entry.first = pccindex->Read(std::make_pair(CCINDEX_MARMARA_LOOP, createtxid), entry.second);
+            it = loops.insert(std::make_pair(createtxid, entry)).first;
+        }
+        if (!it->second.first)
+            return false;
+        loop = it->second.second;
+        return true;
+    }
+    void SetLoop(uint256 createtxid, const CMarmaraLoopState &loop) { loops[createtxid] = std::make_pair(true, loop); }
+    void EraseLoop(uint256 createtxid) { loops[createtxid] = std::make_pair(false, CMarmaraLoopState()); }
+
+    std::vector<uint256> &GetBatons(uint256 txid)
+    {
+        auto it = batons.find(txid);
+        if (it == batons.end())
+        {
+            std::vector<uint256> createtxids;
+            pccindex->Read(std::make_pair(CCINDEX_MARMARA_BATON, txid), createtxids);
+            it = batons.insert(std::make_pair(txid, createtxids)).first;
+        }
+        return it->second;
+    }
+    void AddBaton(uint256 txid, uint256 createtxid) { GetBatons(txid).push_back(createtxid); }
+    void EraseBatons(uint256 txid) { batons[txid].clear(); }
+
+    void Flush(CDBBatch &batch)
+    {
+        for (const auto &loop : loops)
+        {
+            if (loop.second.first)
+                batch.Write(std::make_pair(CCINDEX_MARMARA_LOOP, loop.first), loop.second.second);
+            else
+                batch.Erase(std::make_pair(CCINDEX_MARMARA_LOOP, loop.first));
+        }
+        for (const auto &baton : batons)
+        {
+            if (!baton.second.empty())
+                batch.Write(std::make_pair(CCINDEX_MARMARA_BATON, baton.first), baton.second);
+            else
+                batch.Erase(std::make_pair(CCINDEX_MARMARA_BATON, baton.first));
+        }
+    }
+};
+
+static CMarmaraLoopTx marmara_loop_tx(const CTransaction &tx, int32_t height, const struct SMarmaraCreditLoopOpret &loopData)
+{
+    CMarmaraLoopTx looptx;
+
+    looptx.txid = tx.GetHash();
+    looptx.height = height;
+    looptx.holder = loopData.pk;
+    for (int32_t i = 0; i < (int32_t)tx.vout.size() - 1; i++)
+    {
+        CScript opret;
+        struct SMarmaraCreditLoopOpret voutLoopData;
+        if (tx.vout[i].scriptPubKey.IsPayToCryptoCondition() && GetCCOpReturnData(tx.vout[i].scriptPubKey, opret) && MarmaraDecodeLoopOpret(opret, voutLoopData) == MARMARA_LOCKED)
+        {
+            looptx.endorsers.push_back(voutLoopData.pk);
+            looptx.nLocked += tx.vout[i].nValue;
+        }
+    }
+    // an unspendable baton is not in the coins view, MarmaraGetbatontxid treats it as a bad loop
+    if (tx.vout.size() > MARMARA_BATON_VOUT && !tx.vout[MARMARA_BATON_VOUT].scriptPubKey.IsUnspendable())
+        looptx.nBatonValue = tx.vout[MARMARA_BATON_VOUT].nValue;
+    return looptx;
+}
+
+// follows the baton vouts like the spent index walk in MarmaraGetbatontxid, one block at a time
+static void marmara_index_loops(const CBlock &block, int32_t height, CDBBatch &batch, bool fErase)
+{
+    CMarmaraLoopIndexView view;
+
+    for (int32_t itx = 0; itx < block.vtx.size(); itx++)
+    {
+        const CTransaction &tx = block.vtx[fErase ? block.vtx.size() - 1 - itx : itx];
+        uint256 txid = tx.GetHash();
+        CMarmaraLoopState loop;
+        struct SMarmaraCreditLoopOpret loopData;
+        uint8_t funcid = 0;
+
+        if (tx.vout.size() > 1)
+            funcid = MarmaraDecodeLoopOpret(tx.vout.back().scriptPubKey, loopData);
+
+        if (!fErase)
+        {
+            if (!tx.IsCoinBase())
+            {
+                for (const auto &vin : tx.vin)
+                {
+                    if (vin.prevout.n != MARMARA_BATON_VOUT)
+                        continue;
+                    std::vector<uint256> createtxids = view.GetBatons(vin.prevout.hash);
+                    for (const auto &createtxid : createtxids)
+                    {
+                        if (view.GetLoop(createtxid, loop) && loop.chain.back().txid == vin.prevout.hash)
+                        {
+                            loop.chain.push_back(marmara_loop_tx(tx, height, loopData));
+                            view.SetLoop(createtxid, loop);
+                            view.AddBaton(txid, createtxid);
+                        }
+                    }
+                    if (!createtxids.empty())
+                        view.EraseBatons(vin.prevout.hash);
+                }
+            }
+            if (funcid == MARMARA_CREATELOOP)
+            {
+                CMarmaraLoopState newloop;
+                newloop.createOpret = tx.vout.back().scriptPubKey;
+                newloop.chain.push_back(marmara_loop_tx(tx, height, loopData));
+                view.SetLoop(txid, newloop);
+                view.AddBaton(txid, txid);
+                batch.Write(std::make_pair(CCINDEX_MARMARA_LOOPTX, txid), txid);
+            }
+            else if (funcid == MARMARA_ISSUE || funcid == MARMARA_TRANSFER || funcid == MARMARA_REQUEST)
+                batch.Write(std::make_pair(CCINDEX_MARMARA_LOOPTX, txid), loopData.createtxid);
+        }
+        else
+        {
+            if (funcid == MARMARA_CREATELOOP)
+                view.EraseLoop(txid);
+            if (funcid != 0)
+                batch.Erase(std::make_pair(CCINDEX_MARMARA_LOOPTX, txid));
+            std::vector<uint256> createtxids = view.GetBatons(txid);
+            for (const auto &createtxid : createtxids)
+            {
+                if (view.GetLoop(createtxid, loop) && loop.chain.size() > 1 && loop.chain.back().txid == txid)
+                {
+                    loop.chain.pop_back();
+                    view.SetLoop(createtxid, loop);
+                    view.AddBaton(loop.chain.back().txid, createtxid);
+                }
+            }
+            if (!createtxids.empty())
+                view.EraseBatons(txid);
+        }
+    }
+    view.Flush(batch);
+}
+
+void MarmaraIndexBlock(const CBlock &block, int32_t height, CDBBatch &batch, bool fErase)
+{
+    if (ASSETCHAINS_MARMARA == 0)
+        return;
+
+    struct CCcontract_info *cp, C;
+    cp = CCinit(&C, EVAL_MARMARA);
+    CPubKey Marmarapk = GetUnspendable(cp, NULL);
+    CScript markerspk = MakeCC1vout(EVAL_MARMARA, MARMARA_ACTIVATED_MARKER_AMOUNT, Marmarapk).scriptPubKey;
+    std::map<COutPoint, std::vector<CMarmaraIndexCoin> > created;   // outputs of this block, not in the db yet
+    std::map<CPubKey, CMarmaraIndexBalance> deltas;
+
+    if (!fErase)
+    {
+        for (const auto &tx : block.vtx)
+        {
+            if (!tx.IsCoinBase())
+            {
+                for (const auto &vin : tx.vin)
+                {
+                    std::vector<CMarmaraIndexCoin> coins;
+                    auto itCreated = created.find(vin.prevout);
+                    if (itCreated != created.end())
+                    {
+                        coins.swap(itCreated->second);
+                        created.erase(itCreated);
+                    }
+                    else if (!pccindex->Read(std::make_pair(CCINDEX_MARMARA_OUTPOINT, vin.prevout), coins))
+                        continue;
+                    marmara_index_remove(batch, vin.prevout, coins, deltas);
+                    batch.Write(std::make_pair(CCINDEX_MARMARA_UNDO, std::make_pair(height, vin.prevout)), coins);
+                }
+            }
+            for (int32_t i = 0; i < tx.vout.size(); i++)
+            {
+                std::vector<CMarmaraIndexCoin> coins;
+                marmara_index_vout(cp, Marmarapk, markerspk, tx, i, height, block.nTime, coins);
+                if (!coins.empty())
+                {
+                    marmara_index_add(batch, COutPoint(tx.GetHash(), i), coins, deltas);
+                    created[COutPoint(tx.GetHash(), i)] = coins;
+                }
+            }
+        }
+    }
+    else
+    {
+        // undo in reverse so an output created and spent in this block is restored before it is removed
+        for (auto itTx = block.vtx.rbegin(); itTx != block.vtx.rend(); itTx++)
+        {
+            const CTransaction &tx = *itTx;
+            for (int32_t i = 0; i < tx.vout.size(); i++)
+            {
+                std::vector<CMarmaraIndexCoin> coins;
+                marmara_index_vout(cp, Marmarapk, markerspk, tx, i, height, block.nTime, coins);
+                if (!coins.empty())
+                    marmara_index_remove(batch, COutPoint(tx.GetHash(), i), coins, deltas);
+            }
+            if (!tx.IsCoinBase())
+            {
+                for (const auto &vin : tx.vin)
+                {
+                    std::vector<CMarmaraIndexCoin> coins;
+                    if (pccindex->Read(std::make_pair(CCINDEX_MARMARA_UNDO, std::make_pair(height, vin.prevout)), coins))
+                    {
+                        marmara_index_add(batch, vin.prevout, coins, deltas);
+                        batch.Erase(std::make_pair(CCINDEX_MARMARA_UNDO, std::make_pair(height, vin.prevout)));
+                    }
+                }
+            }
+        }
+    }
+
+    marmara_index_loops(block, height, batch, fErase);
+
+    for (const auto &delta : deltas)
+    {
+        CMarmaraIndexBalance balance;
+        pccindex->Read(std::make_pair(CCINDEX_MARMARA_BALANCE, delta.first), balance);
+        balance.nActivated += delta.second.nActivated;
+        balance.nLocked += delta.second.nLocked;
+        balance.nMarkers += delta.second.nMarkers;
+        if (balance.IsNull())
+            batch.Erase(std::make_pair(CCINDEX_MARMARA_BALANCE, delta.first));
+        else
+            batch.Write(std::make_pair(CCINDEX_MARMARA_BALANCE, delta.first), balance);
+    }
+}
+
+// confirmed coins of kind for pk, or of every pubkey if pk is not valid. false if the index can't answer
+bool GetMarmaraIndexCoins(const CPubKey &pk, uint8_t kind, std::vector<std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> > &coins)
+{
+    if (!CCIndexComplete())
+        return false;
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    if (pk.IsValid())
+        pcursor->Seek(std::make_pair(CCINDEX_MARMARA_COIN, CMarmaraIndexKey(pk, kind, uint256(), 0)));
+    else
+        pcursor->Seek(CCINDEX_MARMARA_COIN);
+    while (pcursor->Valid())
+    {
+        std::pair<char, CMarmaraIndexKey> key;
+        CMarmaraIndexCoin coin;
+        if (!pcursor->GetKey(key) || key.first != CCINDEX_MARMARA_COIN)
+            break;
+        if (pk.IsValid() && (key.second.pk != pk || key.second.kind != kind))
+            break;
+        if (key.second.kind == kind && pcursor->GetValue(coin))
+            coins.push_back(std::make_pair(key.second, coin));
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool GetMarmaraIndexBalance(const CPubKey &pk, CMarmaraIndexBalance &balance)
+{
+    if (!CCIndexComplete())
+        return false;
+    balance = CMarmaraIndexBalance();
+    pccindex->Read(std::make_pair(CCINDEX_MARMARA_BALANCE, pk), balance);
+    return true;
+}
+
+// pubkeys with an unspent activation marker, what EnumAllActivatedAddresses collects from the marker address
+bool GetMarmaraActivatedPubkeys(std::vector<CPubKey> &pks)
+{
+    if (!CCIndexComplete())
+        return false;
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    pcursor->Seek(CCINDEX_MARMARA_BALANCE);
+    while (pcursor->Valid())
+    {
+        std::pair<char, CPubKey> key;
+        CMarmaraIndexBalance balance;
+        if (!pcursor->GetKey(key) || key.first != CCINDEX_MARMARA_BALANCE)
+            break;
+        if (pcursor->GetValue(balance) && balance.nMarkers > 0)
+            pks.push_back(key.second);
+        pcursor->Next();
+    }
+    return true;
+}
+
+// createtxid named by a confirmed create, request, issue or transfer tx, what get_create_txid decodes from its opret
+bool GetMarmaraLoopCreatetxid(uint256 txid, uint256 &createtxid)
+{
+    if (!CCIndexComplete())
+        return false;
+    return pccindex->Read(std::make_pair(CCINDEX_MARMARA_LOOPTX, txid), createtxid);
+}
+
+bool GetMarmaraLoopState(uint256 createtxid, CMarmaraLoopState &loop)
+{
+    if (!CCIndexComplete())
+        return false;
+    return pccindex->Read(std::make_pair(CCINDEX_MARMARA_LOOP, createtxid), loop);
+}
+
+// sum of the activated coins of pk not spent in the mempool, what AddMarmaraCCInputs returns for amount 0
+static bool marmara_indexed_activated_amount(const CPubKey &pk, CAmount &amount)
+{
+    std::vector<std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> > coins;
+    CMarmaraIndexBalance balance;
+
+    if (!GetMarmaraIndexBalance(pk, balance))
+        return false;
+    amount = 0;
+    if (balance.nActivated == 0)
+        return true;
+    GetMarmaraIndexCoins(pk, MARMARA_INDEX_ACTIVATED, coins);
+    for (const auto &coin : coins)
+        if (!myIsutxo_spentinmempool(ignoretxid, ignorevin, coin.first.txid, coin.first.nvout))
+            amount += coin.second.nValue;
+    return true;
+}
+
 #define MAKE_ACTIVATED_WALLET_DATA(key, pk, addr, segid, amount) std::make_tuple(key, pk, addr, segid, amount)
 
 #define ACTIVATED_WALLET_DATA_KEY(d) std::get<0>(d)
@@ -2025,7 +2470,9 @@ static void EnumWalletActivatedAddresses(CWallet *pwalletMain, vACTIVATED_WALLET
             std::vector<CPubKey> pubkeys;
             char activated1of2addr[KOMODO_ADDRESS_BUFSIZE];
             GetCCaddress1of2(cp, activated1of2addr, marmarapk, pk);
-            CAmount amount = AddMarmaraCCInputs(IsMarmaraActivatedVout, mtx, pubkeys, activated1of2addr, 0, CC_MAXVINS);
+            CAmount amount;
+            if (!marmara_indexed_activated_amount(pk, amount))
+                amount = AddMarmaraCCInputs(IsMarmaraActivatedVout, mtx, pubkeys, activated1of2addr, 0, CC_MAXVINS);
             if (amount > 0)
             {
                 uint32_t segid = komodo_segid32(activated1of2addr) & 0x3f;
@@ -2107,6 +2554,7 @@ template <class T>
 static void EnumActivatedCoins(T func, bool onlyLocal)
 {
     std::vector<std::string> activatedAddresses;
+    std::vector<CPubKey> activatedPks;
 #ifdef ENABLE_WALLET
     if (onlyLocal)
     {
@@ -2117,7 +2565,10 @@ static void EnumActivatedCoins(T func, bool onlyLocal)
             vACTIVATED_WALLET_DATA activated;
             EnumWalletActivatedAddresses(pwalletMain, activated);
             for (const auto &a : activated)
+            {
                 activatedAddresses.push_back(ACTIVATED_WALLET_DATA_ADDR(a));
+                activatedPks.push_back(ACTIVATED_WALLET_DATA_PK(a));
+            }
         }
         else
         {
@@ -2128,6 +2579,33 @@ static void EnumActivatedCoins(T func, bool onlyLocal)
     }
 #endif
 
+    if (CCIndexComplete() && (onlyLocal || GetMarmaraActivatedPubkeys(activatedPks)))
+    {
+        struct CCcontract_info *cp, C;
+        cp = CCinit(&C, EVAL_MARMARA);
+        CPubKey Marmarapk = GetUnspendable(cp, NULL);
+
+        for (const auto &pk : activatedPks)
+        {
+            char activatedaddr[KOMODO_ADDRESS_BUFSIZE];
+            CMarmaraIndexBalance balance;
+            std::vector<std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> > coins;
+
+            // no single coin can reach the minimum value then
+            if (!GetMarmaraIndexBalance(pk, balance) || balance.nActivated < COIN)
+                continue;
+            GetCCaddress1of2(cp, activatedaddr, Marmarapk, pk);
+            GetMarmaraIndexCoins(pk, MARMARA_INDEX_ACTIVATED, coins);
+            for (const auto &coin : coins)
+            {
+                if (coin.second.nValue < COIN)   // skip small values
+                    continue;
+                if (myIsutxo_spentinmempool(ignoretxid, ignorevin, coin.first.txid, coin.first.nvout) == 0)
+                    func(activatedaddr, coin.first.txid, coin.first.nvout, CTxOut(coin.second.nValue, coin.second.scriptPubKey), coin.second.nTime);
+            }
+        }
+        return;
+    }
     if (!onlyLocal)
         EnumAllActivatedAddresses(activatedAddresses);
 
@@ -2169,7 +2647,7 @@ static void EnumActivatedCoins(T func, bool onlyLocal)
                     if (get_either_opret(&activatedChecker, tx, nvout, opret, opretpk))
                     {
                         // call callback function:
-                        func(addr.c_str(), tx, nvout, pindex);
+                        func(addr.c_str(), txid, nvout, tx.vout[nvout], pindex->nTime);
                         LOGSTREAMFN("marmara", CCLOG_DEBUG3, stream << "found my activated 1of2 addr txid=" << txid.GetHex() << " vout=" << nvout << std::endl);
                     }
                     else
@@ -2191,12 +2669,28 @@ static void EnumLockedInLoop(T func, const CPubKey &pk)
 {
     char markeraddr[KOMODO_ADDRESS_BUFSIZE];
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > markerOutputs;
+    std::vector<std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> > coins;
 
     struct CCcontract_info *cp, C;
     cp = CCinit(&C, EVAL_MARMARA);
     // CPubKey mypk = pubkey2pk(Mypubkey());
     CPubKey Marmarapk = GetUnspendable(cp, NULL);
 
+    if (GetMarmaraIndexCoins(pk, MARMARA_INDEX_LOCKED, coins))
+    {
+        // callers expect the coins of a loop to come in a row
+        std::stable_sort(coins.begin(), coins.end(), [](const std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> &a, const std::pair<CMarmaraIndexKey, CMarmaraIndexCoin> &b) { return a.second.createtxid < b.second.createtxid; });
+        for (const auto &coin : coins)
+        {
+            char loopaddr[KOMODO_ADDRESS_BUFSIZE];
+            if (myIsutxo_spentinmempool(ignoretxid, ignorevin, coin.first.txid, coin.first.nvout))
+                continue;
+            GetCCaddress1of2(cp, loopaddr, Marmarapk, CCtxidaddr_tweak(NULL, coin.second.createtxid));
+            func(loopaddr, coin.first.txid, coin.first.nvout, CTxOut(coin.second.nValue, coin.second.scriptPubKey), coin.second.nTime);
+        }
+        return;
+    }
+
     GetCCaddress(cp, markeraddr, Marmarapk);
     SetCCunspents(markerOutputs, markeraddr, true);
 
@@ -2267,7 +2761,7 @@ static void EnumLockedInLoop(T func, const CPubKey &pk)
                                             if (!pk.IsValid() || pk == pk_in_opret)   // check pk in opret
                                             {
                                                 // call callback func:
-                                                func(loopaddr, looptx, nvout, pindex);
+                                                func(loopaddr, txid, nvout, looptx.vout[nvout], pindex->nTime);
                                                 LOGSTREAMFN("marmara", CCLOG_DEBUG3, stream << "found my lock-in-loop 1of2 addr txid=" << txid.GetHex() << " vout=" << nvout << std::endl);
                                             }
                                             else
@@ -2302,20 +2796,20 @@ struct komodo_staking *MarmaraGetStakingUtxos(struct komodo_staking *array, int3
     // add all activated utxos:
     //std::cerr  << " entered" << std::endl;
     EnumActivatedCoins(
-        [&](const char *activatedaddr, const CTransaction & tx, int32_t nvout, CBlockIndex *pindex) 
+        [&](const char *activatedaddr, const uint256 &txid, int32_t nvout, const CTxOut &vout, uint32_t nTime)
         {
-            array = komodo_addutxo(array, numkp, maxkp, (uint32_t)pindex->nTime, (uint64_t)tx.vout[nvout].nValue, tx.GetHash(), nvout, (char*)activatedaddr, hashbuf, tx.vout[nvout].scriptPubKey);
-            LOGSTREAM("marmara", CCLOG_DEBUG2, stream << logFName << " " << "added utxo for staking activated 1of2 addr txid=" << tx.GetHash().GetHex() << " vout=" << nvout << std::endl);
+            array = komodo_addutxo(array, numkp, maxkp, nTime, (uint64_t)vout.nValue, txid, nvout, (char*)activatedaddr, hashbuf, vout.scriptPubKey);
+            LOGSTREAM("marmara", CCLOG_DEBUG2, stream << logFName << " " << "added utxo for staking activated 1of2 addr txid=" << txid.GetHex() << " vout=" << nvout << std::endl);
         }, 
         !onlyLocalUtxos
     );
 
     // add all lock-in-loops utxos:
     EnumLockedInLoop(
-        [&](const char *loopaddr, const CTransaction & tx, int32_t nvout, CBlockIndex *pindex)
+        [&](const char *loopaddr, const uint256 &txid, int32_t nvout, const CTxOut &vout, uint32_t nTime)
         {
-            array = komodo_addutxo(array, numkp, maxkp, (uint32_t)pindex->nTime, (uint64_t)tx.vout[nvout].nValue, tx.GetHash(), nvout, (char*)loopaddr, hashbuf, tx.vout[nvout].scriptPubKey);
-            LOGSTREAM("marmara", CCLOG_DEBUG2, stream << logFName << " " << "added utxo for staking locked-in-loop 1of2addr txid=" << tx.GetHash().GetHex() << " vout=" << nvout << std::endl);
+            array = komodo_addutxo(array, numkp, maxkp, nTime, (uint64_t)vout.nValue, txid, nvout, (char*)loopaddr, hashbuf, vout.scriptPubKey);
+            LOGSTREAM("marmara", CCLOG_DEBUG2, stream << logFName << " " << "added utxo for staking locked-in-loop 1of2addr txid=" << txid.GetHex() << " vout=" << nvout << std::endl);
         },
         emptypk
     );
@@ -3716,7 +4210,10 @@ UniValue MarmaraInfo(const CPubKey &refpk, int32_t firstheight, int32_t lastheig
 
     GetCCaddress1of2(cp, activated1of2addr, Marmarapk, vrefpk);
     result.push_back(Pair("myCCActivatedAddress", activated1of2addr));
-    result.push_back(Pair("myActivatedAmount", ValueFromAmount(AddMarmaraCCInputs(IsMarmaraActivatedVout, mtx, pubkeys, activated1of2addr, 0, MARMARA_VINS)))); 
+    CAmount activatedAmount;
+    if (!marmara_indexed_activated_amount(refpk, activatedAmount))
+        activatedAmount = AddMarmaraCCInputs(IsMarmaraActivatedVout, mtx, pubkeys, activated1of2addr, 0, MARMARA_VINS);
+    result.push_back(Pair("myActivatedAmount", ValueFromAmount(activatedAmount)));
     result.push_back(Pair("myTotalAmountOnActivatedAddress", ValueFromAmount(CCaddress_balance(activated1of2addr, 1))));
 
     GetCCaddress(cp, myccaddr, vrefpk);
@@ -3729,7 +4226,7 @@ UniValue MarmaraInfo(const CPubKey &refpk, int32_t firstheight, int32_t lastheig
     char prevloopaddr[KOMODO_ADDRESS_BUFSIZE] = "";
     UniValue resultloops(UniValue::VARR);
     EnumLockedInLoop(
-        [&](char *loopaddr, const CTransaction & tx, int32_t nvout, CBlockIndex *pindex) // call enumerator with callback
+        [&](const char *loopaddr, const uint256 &txid, int32_t nvout, const CTxOut &vout, uint32_t nTime) // call enumerator with callback
         {
             if (strcmp(prevloopaddr, loopaddr) != 0)   // loop address changed
             {
@@ -3744,8 +4241,8 @@ UniValue MarmaraInfo(const CPubKey &refpk, int32_t firstheight, int32_t lastheig
                 }
                 strcpy(prevloopaddr, loopaddr);
             }
-            loopAmount += tx.vout[nvout].nValue;
-            totalLoopAmount += tx.vout[nvout].nValue;
+            loopAmount += vout.nValue;
+            totalLoopAmount += vout.nValue;
         },
         refpk
     );
@@ -15,6 +15,7 @@
 
 #include "CCOracles.h"
 #include <secp256k1.h>
+#include <boost/scoped_ptr.hpp>
 
 /*
  An oracles CC has the purpose of converting offchain data into onchain data
@@ -311,6 +312,21 @@ uint256 OracleBatonUtxo(uint64_t value,struct CCcontract_info *cp,uint256 refora
     return(batontxid);
 }
 
+// latest baton from the sample index when it is newer than the registration, else the baton utxo scan
+static uint256 OracleLatestBaton(struct CCcontract_info *cp,uint256 oracletxid,char *batonaddr,CPubKey publisher,int32_t regheight,std::vector <uint8_t> &data)
+{
+    std::vector<COraclesSample> samples; uint256 batontxid;
+    if ( GetOraclesSamples(oracletxid,publisher,1,samples) != 0 && samples.size() == 1 && samples[0].height >= regheight )
+    {
+        batontxid = samples[0].txid;
+        data = samples[0].data;
+        while ( myIsutxo_spentinmempool(ignoretxid,ignorevin,batontxid,1) != 0 )
+            batontxid = myIs_baton_spentinmempool(batontxid,1);
+        return(batontxid);
+    }
+    return(OracleBatonUtxo(CC_MARKER_VALUE,cp,oracletxid,batonaddr,publisher,data));
+}
+
 uint256 OraclesBatontxid(uint256 reforacletxid,CPubKey refpk)
 {
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
@@ -330,7 +346,7 @@ uint256 OraclesBatontxid(uint256 reforacletxid,CPubKey refpk)
             if ( regtx.vout.size() > 0 && DecodeOraclesOpRet(regtx.vout[regtx.vout.size()-1].scriptPubKey,oracletxid,pk,datafee) == 'R' && oracletxid == reforacletxid && pk == refpk )
             {
                 Getscriptaddress(batonaddr,regtx.vout[1].scriptPubKey);
-                batontxid = OracleBatonUtxo(CC_MARKER_VALUE,cp,oracletxid,batonaddr,pk,data);
+                batontxid = OracleLatestBaton(cp,oracletxid,batonaddr,pk,height,data);
                 break;
             }
         }
@@ -759,6 +775,69 @@ bool OraclesValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &t
 }
 // end of consensus code
 
+// sample index, maintained from ConnectBlock/DisconnectTip through ConnectCCIndexes
+
+void OraclesIndexBlock(const CBlock &block,int32_t height,CDBBatch &batch,bool fErase)
+{
+    struct CCcontract_info *cp,C; uint256 oracletxid,batontxid; CPubKey pk; std::vector<uint8_t> data; int32_t i,j,numvouts,numvins; char batonaddr[64];
+    cp = CCinit(&C,EVAL_ORACLES);
+    for (i=0; i<block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        if ( (numvouts= tx.vout.size()) < 2 || tx.vout[1].nValue != CC_MARKER_VALUE || tx.vout[1].scriptPubKey.IsPayToCryptoCondition() == 0 )
+            continue;
+        if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,batontxid,pk,data) != 'D' || pk.size() != CPubKey::COMPRESSED_PUBLIC_KEY_SIZE )
+            continue;
+        // only a tx spending an oracles CC input went through OraclesValidate, anything else just looks like a sample
+        for (numvins=tx.vin.size(),j=0; j<numvins; j++)
+            if ( (*cp->ismyvin)(tx.vin[j].scriptSig) != 0 )
+                break;
+        if ( j == numvins )
+            continue;
+        COraclesSampleKey key(oracletxid,pk,height,i);
+        if ( fErase != 0 )
+            batch.Erase(std::make_pair(CCINDEX_ORACLES_SAMPLE,key));
+        else
+        {
+            batch.Write(std::make_pair(CCINDEX_ORACLES_SAMPLE,key),COraclesSample(tx.GetHash(),batontxid,height,data));
+            // the baton address of a publisher never changes, so this row is left in place on disconnect
+            if ( Getscriptaddress(batonaddr,tx.vout[1].scriptPubKey) != 0 )
+                batch.Write(std::make_pair(CCINDEX_ORACLES_BATON,std::string(batonaddr)),pk);
+        }
+    }
+}
+
+// latest num (0 for all) confirmed samples of publisher, newest first. false if the index can't answer
+bool GetOraclesSamples(uint256 oracletxid,CPubKey publisher,int32_t num,std::vector<COraclesSample> &samples)
+{
+    if ( CCIndexComplete() == 0 || publisher.size() != CPubKey::COMPRESSED_PUBLIC_KEY_SIZE )
+        return(false);
+    boost::scoped_ptr<CDBIterator> pcursor(pccindex->NewIterator());
+    pcursor->Seek(std::make_pair(CCINDEX_ORACLES_SAMPLE,COraclesSampleKey(oracletxid,publisher,0x7fffffff,0xffffffff)));
+    if ( pcursor->Valid() )
+        pcursor->Prev();
+    else pcursor->SeekToLast();
+    while ( pcursor->Valid() )
+    {
+        std::pair<char,COraclesSampleKey> key; COraclesSample sample;
+        if ( pcursor->GetKey(key) == 0 || key.first != CCINDEX_ORACLES_SAMPLE || key.second.oracletxid != oracletxid || key.second.publisher != publisher )
+            break;
+        if ( pcursor->GetValue(sample) != 0 )
+            samples.push_back(sample);
+        if ( num > 0 && samples.size() >= num )
+            break;
+        pcursor->Prev();
+    }
+    return(true);
+}
+
+bool GetOraclesBatonPublisher(const char *batonaddr,CPubKey &publisher)
+{
+    if ( CCIndexComplete() == 0 )
+        return(false);
+    return(pccindex->Read(std::make_pair(CCINDEX_ORACLES_BATON,std::string(batonaddr)),publisher));
+}
+
 // helper functions for rpc calls in rpcwallet.cpp
 
 int64_t AddOracleInputs(struct CCcontract_info *cp,CMutableTransaction &mtx,uint256 oracletxid,CPubKey pk,int64_t total,int32_t maxinputs)
@@ -1092,10 +1171,11 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
             {
                 const CTransaction &txmempool = *it;
                 const uint256 &hash = txmempool.GetHash();
-                if ((numvouts=txmempool.vout.size())>0 && ValidateCCtx(txmempool,cp) && txmempool.vout[1].nValue==CC_MARKER_VALUE && DecodeOraclesData(txmempool.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
+                // cheap opret and baton checks first, only matching samples get validated
+                if ((numvouts=txmempool.vout.size())>1 && txmempool.vout[1].nValue==CC_MARKER_VALUE && DecodeOraclesData(txmempool.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
                 {
                     Getscriptaddress(addr,txmempool.vout[1].scriptPubKey);
-                    if (strcmp(addr,batonaddr)!=0) continue;
+                    if (strcmp(addr,batonaddr)!=0 || !ValidateCCtx(txmempool,cp)) continue;
                     if ( (formatstr= (char *)format.c_str()) == 0 )
                         formatstr = (char *)"";
                     UniValue a(UniValue::VOBJ);
@@ -1109,6 +1189,21 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
                     }
                 }
             }
+            std::vector<COraclesSample> samples;
+            if ( GetOraclesBatonPublisher(batonaddr,pk) != 0 && GetOraclesSamples(reforacletxid,pk,num != 0 ? num-n : 0,samples) != 0 )
+            {
+                if ( (formatstr= (char *)format.c_str()) == 0 )
+                    formatstr = (char *)"";
+                for (std::vector<COraclesSample>::const_iterator it=samples.begin(); it!=samples.end(); it++)
+                {
+                    UniValue a(UniValue::VOBJ);
+                    a.push_back(Pair("txid",it->txid.GetHex()));
+                    a.push_back(Pair("data",OracleFormat((uint8_t *)it->data.data(),(int32_t)it->data.size(),formatstr,(int32_t)format.size())));
+                    b.push_back(a);
+                }
+                result.push_back(Pair("samples",b));
+                return(result);
+            }
             SetCCtxids(txids,batonaddr,true,EVAL_ORACLES,CC_MARKER_VALUE,reforacletxid,'D');
             if (txids.size()>0)
             {
@@ -1189,7 +1284,7 @@ UniValue OracleInfo(uint256 origtxid)
                     UniValue obj(UniValue::VOBJ);
                     obj.push_back(Pair("publisher",pubkey33_str(str,(uint8_t *)pk.begin())));
                     Getscriptaddress(batonaddr,tx.vout[1].scriptPubKey);
-                    batontxid = OracleBatonUtxo(CC_MARKER_VALUE,cp,oracletxid,batonaddr,pk,data);
+                    batontxid = OracleLatestBaton(cp,oracletxid,batonaddr,pk,it->second.second,data);
                     obj.push_back(Pair("baton",batonaddr));
                     obj.push_back(Pair("batontxid",uint256_str(str,batontxid)));
                     funding = LifetimeOraclesFunds(cp,oracletxid,pk);
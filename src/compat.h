@@ -93,6 +93,14 @@ typedef u_int SOCKET;
 #define MSG_NOSIGNAL 0
 #endif
 
+// epoll(7) lets the socket handler watch more than FD_SETSIZE peers; it is
+// Linux-only, everywhere else we stay on select()
+#if defined(HAVE_SYS_EPOLL_H) && !defined(_WIN32)
+#define USE_EPOLL
+#include <poll.h>
+#include <sys/epoll.h>
+#endif
+
 #ifndef _WIN32
 // PRIO_MAX is not defined on Solaris
 #ifndef PRIO_MAX
@@ -10,13 +10,29 @@
 #include <stdexcept>
 
 #if defined(__x86_64__) || defined(__amd64__)
-#if defined(EXPERIMENTAL_ASM)
 #include <cpuid.h>
+#if defined(EXPERIMENTAL_ASM)
 namespace sha256_sse4
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 }
 #endif
+namespace sha256d64_sse2
+{
+void Transform_4way(unsigned char* out, const unsigned char* in);
+}
+#if defined(ENABLE_AVX2)
+namespace sha256d64_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+#endif
+#if defined(ENABLE_SHANI)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+#endif
 #endif
 
 // Internal implementation code.
@@ -144,8 +160,42 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
 } // namespace sha256
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
+typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
 
-bool SelfTest(TransformType tr) {
+/** Double SHA-256 of one 64-byte input through a single-block Transform. */
+template<TransformType tr>
+void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
+{
+    uint32_t s[8];
+    static const unsigned char padding1[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    unsigned char buffer2[64] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    sha256::Initialize(s);
+    tr(s, in, 1);
+    tr(s, padding1, 1);
+    for (int i = 0; i < 8; i++)
+        WriteBE32(buffer2 + 4 * i, s[i]);
+    sha256::Initialize(s);
+    tr(s, buffer2, 1);
+    for (int i = 0; i < 8; i++)
+        WriteBE32(out + 4 * i, s[i]);
+}
+
+TransformType Transform = sha256::Transform;
+TransformD64Type TransformD64 = TransformD64Wrapper<sha256::Transform>;
+TransformD64Type TransformD64_4way = nullptr;
+TransformD64Type TransformD64_8way = nullptr;
+
+bool SelfTest(const sha256_implementation::Kernels& k) {
     static const unsigned char in1[65] = {0, 0x80};
     static const unsigned char in2[129] = {
         0,
@@ -157,38 +207,123 @@ bool SelfTest(TransformType tr) {
     static const uint32_t init[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
     static const uint32_t out1[8] = {0xe3b0c442ul, 0x98fc1c14ul, 0x9afbf4c8ul, 0x996fb924ul, 0x27ae41e4ul, 0x649b934cul, 0xa495991bul, 0x7852b855ul};
     static const uint32_t out2[8] = {0xce4153b0ul, 0x147c2a86ul, 0x3ed4298eul, 0xe0676bc8ul, 0x79fc77a1ul, 0x2abe1f49ul, 0xb2b055dful, 0x1069523eul};
+    // Double SHA-256 of 64 bytes of 0x20 (spaces)
+    static const unsigned char outd64[32] = {
+        0x9a, 0xb9, 0xbc, 0x92, 0xd0, 0x37, 0x49, 0xb3, 0xc8, 0x80, 0xf3, 0xd0, 0x18, 0x38, 0x50, 0x71,
+        0xfe, 0x4c, 0xa3, 0x94, 0x88, 0x18, 0xd4, 0x73, 0x26, 0x50, 0x0d, 0xf7, 0x18, 0xd7, 0x8f, 0x68
+    };
     uint32_t buf[8];
     memcpy(buf, init, sizeof(buf));
     // Process nothing, and check we remain in the initial state.
-    tr(buf, nullptr, 0);
+    k.Transform(buf, nullptr, 0);
     if (memcmp(buf, init, sizeof(buf))) return false;
     // Process the padded empty string (unaligned)
-    tr(buf, in1 + 1, 1);
+    k.Transform(buf, in1 + 1, 1);
     if (memcmp(buf, out1, sizeof(buf))) return false;
     // Process 64 spaces (unaligned)
     memcpy(buf, init, sizeof(buf));
-    tr(buf, in2 + 1, 2);
+    k.Transform(buf, in2 + 1, 2);
     if (memcmp(buf, out2, sizeof(buf))) return false;
+
+    // The double SHA-256 kernels, on eight different inputs checked against the generic code
+    unsigned char in3[8 * 64 + 1], ref[8 * 32], out[8 * 32];
+    for (size_t i = 0; i < sizeof(in3); i++)
+        in3[i] = (unsigned char)(i * 37 + 11);
+    for (int i = 0; i < 8; i++)
+        TransformD64Wrapper<sha256::Transform>(ref + 32 * i, in3 + 1 + 64 * i);
+    k.TransformD64(out, in2 + 1);
+    if (memcmp(out, outd64, 32)) return false;
+    k.TransformD64(out, in3 + 1);
+    if (memcmp(out, ref, 32)) return false;
+    if (k.TransformD64_4way) {
+        k.TransformD64_4way(out, in3 + 1);
+        if (memcmp(out, ref, 4 * 32)) return false;
+    }
+    if (k.TransformD64_8way) {
+        k.TransformD64_8way(out, in3 + 1);
+        if (memcmp(out, ref, 8 * 32)) return false;
+    }
     return true;
 }
 
-TransformType Transform = sha256::Transform;
+#if defined(__x86_64__) || defined(__amd64__)
+/** Check that the OS saves the AVX registers on context switch. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
 
 } // namespace
 
-std::string SHA256AutoDetect()
+sha256_implementation::Kernels sha256_implementation::DetectKernels(UseImplementation use_implementation)
 {
-#if defined(EXPERIMENTAL_ASM) && (defined(__x86_64__) || defined(__amd64__))
+    Kernels k;
+    k.name = "standard";
+    k.Transform = sha256::Transform;
+    k.TransformD64 = TransformD64Wrapper<sha256::Transform>;
+    k.TransformD64_4way = nullptr;
+    k.TransformD64_8way = nullptr;
+
+#if defined(__x86_64__) || defined(__amd64__)
+    bool have_sse4 = false, have_avx = false, have_avx2 = false, have_shani = false;
     uint32_t eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1) {
-        Transform = sha256_sse4::Transform;
-        assert(SelfTest(Transform));
-        return "sse4";
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        have_sse4 = (ecx >> 19) & 1;
+        // OSXSAVE and AVX
+        have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled();
+    }
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = have_avx && ((ebx >> 5) & 1);
+        have_shani = (ebx >> 29) & 1;
+    }
+    (void)have_sse4; (void)have_avx2; (void)have_shani;
+    bool use_shani = false;
+
+#if defined(ENABLE_SHANI)
+    if (have_shani && (use_implementation & sha256_implementation::USE_SHANI)) {
+        k.Transform = sha256_shani::Transform;
+        k.TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
+        use_shani = true;
+        k.name = "shani(1way)";
+    }
+#endif
+#if defined(EXPERIMENTAL_ASM)
+    if (!use_shani && have_sse4 && (use_implementation & sha256_implementation::USE_SSE4)) {
+        k.Transform = sha256_sse4::Transform;
+        k.TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+        k.name = "sse4(1way)";
+    }
+#endif
+    // A single SHA-NI stream is faster than eight AVX2 lanes, so the
+    // multi-way kernels are only used on CPUs without the SHA extensions.
+    if (!use_shani && (use_implementation & sha256_implementation::USE_SSE2)) {
+        k.TransformD64_4way = sha256d64_sse2::Transform_4way;
+        k.name += ",sse2(4way)";
+    }
+#if defined(ENABLE_AVX2)
+    if (!use_shani && have_avx2 && (use_implementation & sha256_implementation::USE_AVX2)) {
+        k.TransformD64_8way = sha256d64_avx2::Transform_8way;
+        k.name += ",avx2(8way)";
     }
 #endif
+#endif
+
+    return k;
+}
 
-    assert(SelfTest(Transform));
-    return "standard";
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation)
+{
+    sha256_implementation::Kernels k = sha256_implementation::DetectKernels(use_implementation);
+    assert(SelfTest(k));
+    Transform = k.Transform;
+    TransformD64 = k.TransformD64;
+    TransformD64_4way = k.TransformD64_4way;
+    TransformD64_8way = k.TransformD64_8way;
+    return k.name;
 }
 
 ////// SHA-256
@@ -256,3 +391,43 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+namespace {
+/** Double SHA-256 of 64-byte blobs, on the widest kernels available first. */
+void D64Blocks(TransformD64Type d64_8way, TransformD64Type d64_4way, TransformD64Type d64,
+               unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (d64_8way) {
+        while (blocks >= 8) {
+            d64_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (d64_4way) {
+        while (blocks >= 4) {
+            d64_4way(out, in);
+            out += 128;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        d64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
+} // namespace
+
+void sha256_implementation::Kernels::D64(unsigned char* out, const unsigned char* in, size_t blocks) const
+{
+    D64Blocks(TransformD64_8way, TransformD64_4way, TransformD64, out, in, blocks);
+}
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    D64Blocks(TransformD64_8way, TransformD64_4way, TransformD64, out, in, blocks);
+}
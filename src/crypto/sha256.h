@@ -29,9 +29,46 @@ public:
     CSHA256& Reset();
 };
 
-/** Autodetect the best available SHA256 implementation.
+namespace sha256_implementation {
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_SSE4 = 1 << 0,
+    USE_SSE2 = 1 << 1,
+    USE_AVX2 = 1 << 2,
+    USE_SHANI = 1 << 3,
+    USE_ALL = USE_SSE4 | USE_SSE2 | USE_AVX2 | USE_SHANI,
+};
+
+/** A set of SHA-256 kernels; the multi-way ones may be null. */
+struct Kernels {
+    std::string name;
+    void (*Transform)(uint32_t* s, const unsigned char* chunk, size_t blocks);
+    void (*TransformD64)(unsigned char* out, const unsigned char* in);
+    void (*TransformD64_4way)(unsigned char* out, const unsigned char* in);
+    void (*TransformD64_8way)(unsigned char* out, const unsigned char* in);
+
+    /** SHA256D64() with these kernels. */
+    void D64(unsigned char* output, const unsigned char* input, size_t blocks) const;
+};
+
+/** Internal hook for tests and benchmarks: the best kernels available out of
+ *  the ones allowed by use_implementation, without installing them, so they
+ *  can be run directly while the rest of the process keeps its own.
+ */
+Kernels DetectKernels(UseImplementation use_implementation);
+}
+
+/** Autodetect the best available SHA256 implementation and install it for the
+ *  whole process. Call once at startup, before any hashing threads exist.
  *  Returns the name of the implementation.
  */
-std::string SHA256AutoDetect();
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
 #endif // BITCOIN_CRYPTO_SHA256_H
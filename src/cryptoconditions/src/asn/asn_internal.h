@@ -23,10 +23,29 @@ extern "C" {
 #define	ASN1C_ENVIRONMENT_VERSION	923	/* Compile-time version */
 int get_asn1c_environment_version(void);	/* Run-time version */
 
-#define	CALLOC(nmemb, size)	calloc(nmemb, size)
-#define	MALLOC(size)		malloc(size)
-#define	REALLOC(oldptr, size)	realloc(oldptr, size)
-#define	FREEMEM(ptr)		free(ptr)
+/*
+ * Allocations are served from the calling thread's arena while one is set
+ * with asn_arena_set(), and from the heap otherwise. FREEMEM() of an arena
+ * block is a no-op, the arena owner drops the whole tree at once.
+ */
+typedef struct asn_arena_s {
+	unsigned char *buf;	/* Caller-provided storage */
+	size_t size;
+	size_t used;
+	size_t last;		/* Offset of the newest block, 0 if none */
+	int spilled;		/* Set once an allocation fell back to the heap */
+} asn_arena_t;
+
+void asn_arena_set(asn_arena_t *arena);
+void *asn_arena_calloc(size_t nmemb, size_t size);
+void *asn_arena_malloc(size_t size);
+void *asn_arena_realloc(void *ptr, size_t size);
+void asn_arena_free(void *ptr);
+
+#define	CALLOC(nmemb, size)	asn_arena_calloc(nmemb, size)
+#define	MALLOC(size)		asn_arena_malloc(size)
+#define	REALLOC(oldptr, size)	asn_arena_realloc(oldptr, size)
+#define	FREEMEM(ptr)		asn_arena_free(ptr)
 
 #define	asn_debug_indent	0
 #define ASN_DEBUG_INDENT_ADD(i) do{}while(0)
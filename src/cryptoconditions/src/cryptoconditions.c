@@ -17,6 +17,7 @@
 #include "asn/Condition.h"
 #include "asn/Fulfillment.h"
 #include "asn/OCTET_STRING.h"
+#include "asn/asn_internal.h"
 #include "../include/cryptoconditions.h"
 #include <cJSON.h>
 #include "internal.h"
@@ -191,61 +192,79 @@ CC *fulfillmentToCC(Fulfillment_t *ffill) {
 }
 
 
-CC *cc_readFulfillmentBinary(const unsigned char *ffill_bin, size_t ffill_bin_len) {
-    CC *cond = 0;
-    unsigned char *buf = calloc(1,ffill_bin_len);
-    Fulfillment_t *ffill = 0;
-    asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
-    if (rval.code != RC_OK) {
-        goto end;
-    }
-    // Do malleability check
-    asn_enc_rval_t rc = der_encode_to_buffer(&asn_DEF_Fulfillment, ffill, buf, ffill_bin_len);
-    if (rc.encoded == -1) {
-        fprintf(stderr, "FULFILLMENT NOT ENCODED\n");
-        goto end;
-    }
-    if (rc.encoded != ffill_bin_len || 0 != memcmp(ffill_bin, buf, rc.encoded)) {
-        goto end;
-    }
-    
-    cond = fulfillmentToCC(ffill);
-end:
-    free(buf);
-    if (ffill) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
-    return cond;
+/*
+ * Checks DER output against the input as it is produced, so the
+ * malleability check needs no output buffer
+ */
+struct derCompareArg {
+    const unsigned char *expected;
+    size_t length;
+    size_t offset;
+    int mismatch;
+};
+
+
+static int derCompare(const void *buffer, size_t size, void *arg_) {
+    struct derCompareArg *arg = arg_;
+    // Longer than the input, der_encode_to_buffer would overflow here too
+    if (size > arg->length - arg->offset) return -1;
+    if (!arg->mismatch && 0 != memcmp(arg->expected + arg->offset, buffer, size))
+        arg->mismatch = 1;
+    arg->offset += size;
+    return 0;
 }
 
-int cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
 
+/*
+ * Fulfillments are decoded for every CC input verified. The ASN.1 tree lives
+ * in a stack arena and is dropped in one go, only nodes that did not fit in
+ * it are freed one by one.
+ */
+static int readFulfillment(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
     int error = 0;
-    unsigned char *buf = calloc(1,ffill_bin_len);
+    unsigned char scratch[8192];
+    asn_arena_t arena = { scratch, sizeof(scratch), 0, 0, 0 };
     Fulfillment_t *ffill = 0;
+
+    asn_arena_set(&arena);
     asn_dec_rval_t rval = ber_decode(0, &asn_DEF_Fulfillment, (void **)&ffill, ffill_bin, ffill_bin_len);
     if (rval.code != RC_OK) {
         error = rval.code;
         goto end;
     }
     // Do malleability check
-    asn_enc_rval_t rc = der_encode_to_buffer(&asn_DEF_Fulfillment, ffill, buf, ffill_bin_len);
+    struct derCompareArg cmp = { ffill_bin, ffill_bin_len, 0, 0 };
+    asn_enc_rval_t rc = der_encode(&asn_DEF_Fulfillment, ffill, derCompare, &cmp);
     if (rc.encoded == -1) {
         fprintf(stderr, "FULFILLMENT NOT ENCODED\n");
         error = -1;
         goto end;
     }
-    if (rc.encoded != ffill_bin_len || 0 != memcmp(ffill_bin, buf, rc.encoded)) {
+    if (rc.encoded != ffill_bin_len || cmp.mismatch) {
         error = (rc.encoded == ffill_bin_len) ? -3 : -2;
         goto end;
     }
-    
+
     *ppcc = fulfillmentToCC(ffill);
 end:
-    free(buf);
-    if (ffill) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
+    if (ffill && arena.spilled) ASN_STRUCT_FREE(asn_DEF_Fulfillment, ffill);
+    asn_arena_set(0);
     return error;
 }
 
 
+CC *cc_readFulfillmentBinary(const unsigned char *ffill_bin, size_t ffill_bin_len) {
+    CC *cond = 0;
+    readFulfillment(ffill_bin, ffill_bin_len, &cond);
+    return cond;
+}
+
+
+int cc_readFulfillmentBinaryExt(const unsigned char *ffill_bin, size_t ffill_bin_len, CC **ppcc) {
+    return readFulfillment(ffill_bin, ffill_bin_len, ppcc);
+}
+
+
 int cc_visit(CC *cond, CCVisitor visitor) {
     int out = visitor.visit(cond, visitor);
     if (out && cond->type->visitChildren) {
@@ -23,6 +23,7 @@
 #include "../include/cryptoconditions.h"
 #include "include/sha256.h"
 #include "asn/asn_application.h"
+#include "asn/asn_internal.h"
 #include "../include/cryptoconditions.h"
 #include "internal.h"
 
@@ -299,3 +300,88 @@ int jsonGetHexOptional(const cJSON *params, char *key, char *err, unsigned char
     }
     return checkDecodeHex(item, key, err, data, size);
 }
+
+
+/*
+ * ASN.1 allocator, bump allocates from the thread's arena when one is set.
+ * Each block is 16 byte aligned and preceded by its size so it can be grown.
+ */
+static __thread asn_arena_t *asnArena;
+
+#define ARENA_ALIGN 16
+
+
+void asn_arena_set(asn_arena_t *arena) {
+    asnArena = arena;
+}
+
+
+static int inArena(const asn_arena_t *arena, const void *ptr) {
+    return arena && (const unsigned char*)ptr >= arena->buf &&
+        (const unsigned char*)ptr < arena->buf + arena->size;
+}
+
+
+static void *arenaAlloc(asn_arena_t *arena, size_t size) {
+    uintptr_t base = (uintptr_t)arena->buf;
+    size_t start = ((base + arena->used + sizeof(size_t) + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1)) - base;
+    if (start > arena->size || size > arena->size - start) {
+        arena->spilled = 1;
+        return 0;
+    }
+    memcpy(arena->buf + start - sizeof(size_t), &size, sizeof(size_t));
+    arena->last = start;
+    arena->used = start + size;
+    return arena->buf + start;
+}
+
+
+void *asn_arena_malloc(size_t size) {
+    void *ptr = asnArena ? arenaAlloc(asnArena, size) : 0;
+    return ptr ? ptr : malloc(size);
+}
+
+
+void *asn_arena_calloc(size_t nmemb, size_t size) {
+    if (!asnArena) return calloc(nmemb, size);
+    if (size && nmemb > SIZE_MAX / size) return 0;
+    void *ptr = arenaAlloc(asnArena, nmemb * size);
+    if (!ptr) return calloc(nmemb, size);
+    memset(ptr, 0, nmemb * size);
+    return ptr;
+}
+
+
+void *asn_arena_realloc(void *ptr, size_t size) {
+    asn_arena_t *arena = asnArena;
+    if (!ptr) return asn_arena_malloc(size);
+    if (!inArena(arena, ptr)) return realloc(ptr, size);
+
+    size_t old;
+    memcpy(&old, (unsigned char*)ptr - sizeof(size_t), sizeof(size_t));
+    size_t start = (unsigned char*)ptr - arena->buf;
+    if (start == arena->last && size <= arena->size - start) {
+        // Newest block grows in place
+        memcpy((unsigned char*)ptr - sizeof(size_t), &size, sizeof(size_t));
+        arena->used = start + size;
+        return ptr;
+    }
+    if (size <= old) return ptr;
+    void *out = asn_arena_malloc(size);
+    if (out) memcpy(out, ptr, old);
+    return out;
+}
+
+
+void asn_arena_free(void *ptr) {
+    asn_arena_t *arena = asnArena;
+    if (!inArena(arena, ptr)) {
+        free(ptr);
+        return;
+    }
+    // Only the newest block can be given back, e.g. DER encoder scratch space
+    if ((unsigned char*)ptr - arena->buf == arena->last) {
+        arena->used = arena->last - sizeof(size_t);
+        arena->last = 0;
+    }
+}
@@ -13,15 +13,24 @@
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <sstream>
 
-static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
+static leveldb::Options GetOptions(const CDBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    if (tuning.nWriteBufferSize > 0) {
+        // an explicit write buffer comes out of the cache budget, the rest is block cache
+        size_t nWriteBuffers = std::min(tuning.nWriteBufferSize * 2, tuning.nCacheSize / 2);
+        options.block_cache = leveldb::NewLRUCache(tuning.nCacheSize - nWriteBuffers);
+        options.write_buffer_size = tuning.nWriteBufferSize;
+    } else {
+        options.block_cache = leveldb::NewLRUCache(tuning.nCacheSize / 2);
+        options.write_buffer_size = tuning.nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    }
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
-    options.max_open_files = maxOpenFiles;
+    options.compression = tuning.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = tuning.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -30,14 +39,26 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) :
+    tuning(nCacheSize, 0, compression, maxOpenFiles), nReads(0), nReadMicros(0)
+{
+    Open(path, fMemory, fWipe);
+}
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, const CDBTuning& tuningIn, bool fMemory, bool fWipe) :
+    tuning(tuningIn), nReads(0), nReadMicros(0)
+{
+    Open(path, fMemory, fWipe);
+}
+
+void CDBWrapper::Open(const boost::filesystem::path& path, bool fMemory, bool fWipe)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, compression, maxOpenFiles);
+    options = GetOptions(tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -82,7 +103,41 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+void CDBWrapper::GetStats(CDBStats& stats) const
+{
+    stats.tuning = tuning;
+    stats.nReads = nReads;
+    stats.nReadMicros = nReadMicros;
+
+    // every key in our databases starts with a one byte type tag, so this covers all of them
+    leveldb::Range range("", "\xff\xff\xff\xff");
+    stats.nApproximateSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &stats.nApproximateSize);
+
+    stats.nFiles = 0;
+    for (int level = 0; level < 7; level++) {
+        std::string strFiles;
+        if (pdb->GetProperty("leveldb.num-files-at-level" + std::to_string(level), &strFiles))
+            stats.nFiles += atoi(strFiles.c_str());
+    }
+
+    // leveldb.stats is a table of Level, Files, Size(MB), Time(sec), Read(MB), Write(MB)
+    stats.dCompactionSeconds = 0;
+    std::string strStats;
+    if (pdb->GetProperty("leveldb.stats", &strStats)) {
+        std::istringstream ss(strStats);
+        std::string strLine;
+        while (std::getline(ss, strLine)) {
+            int level, files;
+            double size, seconds;
+            if (sscanf(strLine.c_str(), "%d %d %lf %lf", &level, &files, &size, &seconds) == 4)
+                stats.dCompactionSeconds += seconds;
+        }
+    }
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
+void CDBIterator::RecordRead(int64_t nMicros) { parent.RecordRead(nMicros); }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::SeekToLast() { piter->SeekToLast(); }
@@ -11,6 +11,8 @@
 #include "util.h"
 #include "version.h"
 
+#include <atomic>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -25,6 +27,29 @@ public:
     dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/** LevelDB tuning for a single database. */
+struct CDBTuning
+{
+    size_t nCacheSize;       //!< block cache plus write buffers, in bytes
+    size_t nWriteBufferSize; //!< memtable size in bytes, 0 to derive it from nCacheSize
+    bool fCompression;       //!< snappy-compress table blocks
+    int nMaxOpenFiles;
+
+    CDBTuning(size_t nCacheSizeIn = 0, size_t nWriteBufferSizeIn = 0, bool fCompressionIn = false, int nMaxOpenFilesIn = 64) :
+        nCacheSize(nCacheSizeIn), nWriteBufferSize(nWriteBufferSizeIn), fCompression(fCompressionIn), nMaxOpenFiles(nMaxOpenFilesIn) {}
+};
+
+/** Usage counters and LevelDB properties of a single database. */
+struct CDBStats
+{
+    uint64_t nApproximateSize;  //!< bytes in table files
+    int nFiles;                 //!< table files over all levels
+    double dCompactionSeconds;  //!< time spent in compactions since open
+    uint64_t nReads;            //!< point reads and iterator seeks since open
+    uint64_t nReadMicros;       //!< total time spent in them
+    CDBTuning tuning;
+};
+
 class CDBWrapper;
 
 /** These should be considered an implementation detail of the specific database.
@@ -78,6 +103,11 @@ public:
 
         batch.Delete(slKey);
     }
+
+    void Clear()
+    {
+        batch.Clear();
+    }
 };
 
 class CDBIterator
@@ -106,7 +136,9 @@ public:
         ssKey.reserve(GetSerializeSize(ssKey, key));
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
+        int64_t nStart = GetTimeMicros();
         piter->Seek(slKey);
+        RecordRead(GetTimeMicros() - nStart);
     }
 
     void Next();
@@ -152,6 +184,8 @@ public:
         return piter->value().size();
     }
 
+private:
+    void RecordRead(int64_t nMicros);
 };
 
 class CDBWrapper
@@ -178,6 +212,15 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! settings the database was opened with
+    CDBTuning tuning;
+
+    //! read counters reported by GetStats
+    mutable std::atomic<uint64_t> nReads;
+    mutable std::atomic<uint64_t> nReadMicros;
+
+    void Open(const boost::filesystem::path& path, bool fMemory, bool fWipe);
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -186,6 +229,7 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      */
     CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+    CDBWrapper(const boost::filesystem::path& path, const CDBTuning& tuning, bool fMemory = false, bool fWipe = false);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -197,7 +241,9 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
+        int64_t nStart = GetTimeMicros();
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        RecordRead(GetTimeMicros() - nStart);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -230,7 +276,9 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
+        int64_t nStart = GetTimeMicros();
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        RecordRead(GetTimeMicros() - nStart);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -271,6 +319,16 @@ public:
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    /** Fill stats with the current size, compaction time and read counters. */
+    void GetStats(CDBStats& stats) const;
+
+    //! Account one point read or iterator seek for GetStats.
+    void RecordRead(int64_t nMicros) const
+    {
+        nReads++;
+        nReadMicros += nMicros;
+    }
 };
 
 #endif // BITCOIN_DBWRAPPER_H
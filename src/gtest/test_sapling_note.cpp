@@ -70,3 +70,51 @@ TEST(SaplingNote, Random)
     ASSERT_NE(note1.d, note3.d);
     ASSERT_NE(note1.pk_d, note3.pk_d);
 }
+
+TEST(SaplingNote, DecryptionBatch)
+{
+    std::vector<SaplingSpendingKey> sks;
+    std::vector<SaplingIncomingViewingKey> ivks;
+    for (int i = 0; i < 40; i++) {
+        sks.push_back(SaplingSpendingKey::random());
+        ivks.push_back(sks.back().full_viewing_key().in_viewing_key());
+    }
+
+    // Notes to keys 3 and 37, then one to a key that isn't in the list
+    std::vector<SaplingPaymentAddress> recipients {
+        sks[3].default_address(),
+        sks[37].default_address(),
+        SaplingSpendingKey::random().default_address()
+    };
+    std::vector<SaplingEncCiphertext> ciphertexts;
+    std::vector<uint256> epks, cmus;
+    for (const auto& addr : recipients) {
+        SaplingNote note(addr, 1000);
+        SaplingNotePlaintext pt(note, {});
+        auto res = pt.encrypt(addr.pk_d);
+        ASSERT_TRUE(bool(res));
+        ciphertexts.push_back(res->first);
+        epks.push_back(res->second.get_epk());
+        cmus.push_back(note.cm().get());
+    }
+
+    // The same key list twice: the first occurrence wins
+    std::vector<SaplingIncomingViewingKey> doubled(ivks);
+    doubled.insert(doubled.end(), ivks.begin(), ivks.end());
+
+    for (int nThreads : {1, 4}) {
+        SaplingNoteDecryptionBatch batch;
+        for (size_t i = 0; i < ciphertexts.size(); i++) {
+            batch.add(ciphertexts[i], epks[i], cmus[i]);
+        }
+        auto matches = batch.decrypt(doubled, nThreads);
+        ASSERT_EQ(matches.size(), 3);
+        ASSERT_TRUE(bool(matches[0]));
+        EXPECT_EQ(matches[0]->ivk, 3);
+        EXPECT_EQ(matches[0]->plaintext.d, recipients[0].d);
+        ASSERT_TRUE(bool(matches[1]));
+        EXPECT_EQ(matches[1]->ivk, 37);
+        EXPECT_EQ(matches[1]->plaintext.value(), 1000);
+        EXPECT_FALSE(bool(matches[2]));
+    }
+}
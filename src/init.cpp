@@ -35,6 +35,7 @@
 #include "httprpc.h"
 #include "key.h"
 #include "notarisationdb.h"
+#include "cc/CCindex.h"
 
 #ifdef ENABLE_MINING
 #include "key_io.h"
@@ -45,6 +46,7 @@
 #include "net.h"
 #include "rpc/server.h"
 #include "rpc/register.h"
+#include "script/sigcache.h"
 #include "script/standard.h"
 #include "scheduler.h"
 #include "txdb.h"
@@ -198,7 +200,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -274,6 +275,11 @@ void Shutdown()
         delete pblocktree;
         pblocktree = NULL;
     }
+    if ( KOMODO_NSPV_SUPERLITE )
+    {
+        void NSPV_store_close();
+        NSPV_store_close();
+    }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         pwalletMain->Flush(true);
@@ -327,6 +333,17 @@ void HandleSIGHUP(int)
     fReopenDebugLog = true;
 }
 
+// LevelDB settings for one of the separate index databases, see CBlockTreeDB::OpenIndexDBs
+static CDBTuning GetIndexDBTuning(const std::string& strIndex, int64_t nDefaultCache, bool fDefaultCompression, int nMaxOpenFiles)
+{
+    int64_t nCache = GetArg("-" + strIndex + "cache", nDefaultCache >> 20) << 20;
+    nCache = std::max(nCache, (int64_t)1 << 20);
+    int64_t nWriteBuffer = GetArg("-" + strIndex + "writebuffer", 0) << 20;
+    bool fCompression = GetBoolArg("-" + strIndex + "compression", fDefaultCompression);
+    LogPrintf("* Using %.1fMiB for %s database%s\n", nCache * (1.0 / 1024 / 1024), strIndex, fCompression ? " (compressed)" : "");
+    return CDBTuning(nCache, nWriteBuffer, fCompression, nMaxOpenFiles);
+}
+
 bool static InitError(const std::string &str)
 {
     uiInterface.ThreadSafeMessageBox(str, "", CClientUIInterface::MSG_ERROR);
@@ -410,6 +427,17 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-migrateindexes", _("Move the address, spent and timestamp indexes out of the block index database into their own databases on startup"));
+    if (showDebug)
+    {
+        const std::string vIndexDBs[] = { "addressindex", "spentindex", "timestampindex" };
+        BOOST_FOREACH(const std::string& strIndex, vIndexDBs)
+        {
+            strUsage += HelpMessageOpt("-" + strIndex + "cache=<n>", strprintf("Cache size for the %s database in megabytes (default: share of -dbcache)", strIndex));
+            strUsage += HelpMessageOpt("-" + strIndex + "writebuffer=<n>", strprintf("Write buffer size for the %s database in megabytes (default: derived from its cache)", strIndex));
+            strUsage += HelpMessageOpt("-" + strIndex + "compression", strprintf("Compress the %s database (default: -dbcompression)", strIndex));
+        }
+    }
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME));
@@ -437,6 +465,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), 1));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket readiness API for peer connections, epoll (Linux only) or select (default: %s)"), DEFAULT_SOCKETEVENTS));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -511,7 +540,8 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
+        strUsage += HelpMessageOpt("-maxsigcachemb=<n>", strprintf("Limit size of the ECDSA and crypto-condition signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", "Limit size of the signature cache to <n> entries of 32 bytes instead, 0 disables it; ignored if -maxsigcachemb is set");
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying (default: %s)"),
@@ -564,6 +594,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Run the elements of a JSON-RPC batch request on up to <n> extra threads, replies keep request order (0-%d, default: %d)"), MAX_RPC_BATCH_THREADS, DEFAULT_RPC_BATCH_THREADS));
+    strUsage += HelpMessageOpt("-rpcmaxbatchsize=<n>", strprintf(_("Reject JSON-RPC batch requests with more than <n> elements when -rpcbatchthreads is set (default: %d)"), DEFAULT_RPC_MAX_BATCH_SIZE));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
@@ -1094,7 +1126,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     //fprintf(stderr,"nMaxConnections %d\n",nMaxConnections);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // epoll has no FD_SETSIZE limit, select() does
+    bool fSocketEventsEpoll = false;
+#ifdef USE_EPOLL
+    fSocketEventsEpoll = GetArg("-socketevents", DEFAULT_SOCKETEVENTS) == "epoll";
+#endif
+    if (!fSocketEventsEpoll)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     //fprintf(stderr,"nMaxConnections %d FD_SETSIZE.%d nBind.%d expr.%d \n",nMaxConnections,FD_SETSIZE,nBind,(int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
@@ -1399,6 +1437,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
+    InitSignatureCache();
+
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
@@ -1612,6 +1652,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     if ( KOMODO_NSPV_SUPERLITE )
     {
+        void NSPV_store_open();
+        NSPV_store_open();
         std::vector<boost::filesystem::path> vImportFiles;
         threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
         StartNode(threadGroup, scheduler);
@@ -1654,16 +1696,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greated than nMaxDbcache
     int64_t nBlockTreeDBCache = nTotalCache / 8;
-
-    if (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+    int64_t nIndexDBCache = 0;
+    bool fMigrateIndexes = GetBoolArg("-migrateindexes", false);
+    // the layout flag lives inside the block index, so guess from the directories which one we will open
+    bool fSplitIndexes = fReindex || fMigrateIndexes || !boost::filesystem::exists(GetDataDir() / "blocks" / "index") ||
+        boost::filesystem::exists(GetDataDir() / "blocks" / "addressindex");
+
+    bool fIndexes = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    if (fIndexes && !fSplitIndexes) {
         // enable 3/4 of the cache if addressindex and/or spentindex is enabled
         nBlockTreeDBCache = nTotalCache * 3 / 4;
     } else {
         if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", false)) {
             nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
         }
+        if (fIndexes)
+            nIndexDBCache = nTotalCache * 3 / 4; // the index databases get that share instead
     }
-    nTotalCache -= nBlockTreeDBCache;
+    nTotalCache -= nBlockTreeDBCache + nIndexDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
@@ -1672,6 +1722,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    // the address index takes most of the split, disabled indexes get the 1MiB minimum
+    CDBTuning addressIndexTuning = GetIndexDBTuning("addressindex", GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? nIndexDBCache * 5 / 8 : 0, dbCompression, dbMaxOpenFiles);
+    CDBTuning spentIndexTuning = GetIndexDBTuning("spentindex", GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? nIndexDBCache * 2 / 8 : 0, dbCompression, dbMaxOpenFiles);
+    CDBTuning timestampIndexTuning = GetIndexDBTuning("timestampindex", GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) ? nIndexDBCache / 8 : 0, dbCompression, dbMaxOpenFiles);
 
     if ( fReindex == 0 )
     {
@@ -1713,12 +1767,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
                 delete pnotarisations;
+                delete pccindex;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
+                if (!pblocktree->OpenIndexDBs(addressIndexTuning, spentIndexTuning, timestampIndexTuning, fReindex, fMigrateIndexes)) {
+                    strLoadError = _("Error migrating index databases");
+                    break;
+                }
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
                 pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
+                pccindex = new CCIndexDB(32*1024*1024, false, fReindex);
 
 
                 if (fReindex) {
@@ -1746,6 +1806,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
                 KOMODO_LOADINGBLOCKS = 0;
+                CCIndexInit(fReindex, chainActive.Tip());
                 // Check for changed -txindex state
                 if (fTxIndex != GetBoolArg("-txindex", true)) {
                     strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
@@ -34,12 +34,13 @@ uint256 NOTARIZED_HASH,NOTARIZED_DESTTXID;
 #include <stdio.h>
 #include <pthread.h>
 #include <ctype.h>
+#include <unordered_map>
 #include "uthash.h"
 #include "utlist.h"
 
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubkey,int32_t maxsize,uint256 txid,int32_t n);
 void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height);
-int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block);
+int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block,const CCoinsViewCache *view,const CBlockUndo *blockundo);
 bool check_pprevnotarizedht();
 
 #include "komodo_structs.h"
@@ -794,27 +795,86 @@ int32_t komodo_voutupdate(bool fJustCheck,int32_t *isratificationp,int32_t notar
 
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubKey,int32_t maxsize,uint256 txid,int32_t n);
 
-int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys[64][33],int32_t numnotaries,uint8_t rmd160[20])
+// notary pubkeys of the blocks being connected, hashed by the first 8 bytes of their x coordinate
+// so a vin costs one lookup instead of a compare against every notary. rebuilt when the set changes
+struct komodo_notaryset
 {
-    int32_t i;
+    uint8_t pubkeys[64][33];
+    int32_t numnotaries,linear;
+    std::unordered_map<uint64_t,int32_t> index;
+    komodo_notaryset() : numnotaries(-1), linear(0) {}
+};
+
+void komodo_notaryset_update(struct komodo_notaryset *set,uint8_t pubkeys[64][33],int32_t numnotaries)
+{
+    int32_t i; uint64_t key;
+    if ( numnotaries == set->numnotaries && memcmp(set->pubkeys,pubkeys,numnotaries*33) == 0 )
+        return;
+    memcpy(set->pubkeys,pubkeys,numnotaries*33);
+    set->numnotaries = numnotaries;
+    set->linear = 0;
+    set->index.clear();
+    for (i=0; i<numnotaries; i++)
+    {
+        memcpy(&key,&pubkeys[i][1],sizeof(key));
+        // a duplicated pubkey keeps its first index, a collision of different pubkeys falls back to the linear compare
+        std::pair<std::unordered_map<uint64_t,int32_t>::iterator,bool> ret = set->index.insert(std::make_pair(key,i));
+        if ( ret.second == 0 && memcmp(pubkeys[ret.first->second],pubkeys[i],33) != 0 )
+            set->linear = 1;
+    }
+}
+
+int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,struct komodo_notaryset *set,uint8_t rmd160[20])
+{
+    int32_t i; uint64_t key;
     if ( scriptlen == 25 && memcmp(&scriptPubKey[3],rmd160,20) == 0 )
         return(0);
     else if ( scriptlen == 35 )
     {
-        for (i=0; i<numnotaries; i++)
-            if ( memcmp(&scriptPubKey[1],pubkeys[i],33) == 0 )
-                return(i);
+        if ( set->linear != 0 )
+        {
+            for (i=0; i<set->numnotaries; i++)
+                if ( memcmp(&scriptPubKey[1],set->pubkeys[i],33) == 0 )
+                    return(i);
+            return(-1);
+        }
+        memcpy(&key,&scriptPubKey[2],sizeof(key));
+        std::unordered_map<uint64_t,int32_t>::const_iterator it = set->index.find(key);
+        if ( it != set->index.end() && memcmp(&scriptPubKey[1],set->pubkeys[it->second],33) == 0 )
+            return(it->second);
     }
     return(-1);
 }
 
+// scriptPubKey spent by vin j of tx i, from the block undo data once ConnectBlock spent the inputs or from its coins view
+// before that. only outputs neither has (like ones created earlier in the same block) need the tx lookup
+int32_t komodo_spentscript(uint8_t *scriptPubKey,int32_t maxsize,const CBlock &block,int32_t i,int32_t j,const CCoinsViewCache *view,const CBlockUndo *blockundo)
+{
+    const CScript *script = 0; const COutPoint &prevout = block.vtx[i].vin[j].prevout; int32_t len;
+    if ( blockundo != 0 && i > 0 && i-1 < blockundo->vtxundo.size() && blockundo->vtxundo[i-1].vprevout.size() == block.vtx[i].vin.size() )
+        script = &blockundo->vtxundo[i-1].vprevout[j].txout.scriptPubKey;
+    else if ( view != 0 )
+    {
+        const CCoins *coins = view->AccessCoins(prevout.hash);
+        if ( coins != 0 && prevout.n < coins->vout.size() && coins->vout[prevout.n].IsNull() == 0 )
+            script = &coins->vout[prevout.n].scriptPubKey;
+    }
+    if ( script == 0 )
+        return(gettxout_scriptPubKey(scriptPubKey,maxsize,prevout.hash,prevout.n));
+    if ( (len= (int32_t)script->size()) > maxsize )
+        len = maxsize;
+    if ( len > 0 )
+        memcpy(scriptPubKey,&(*script)[0],len);
+    return(len);
+}
+
 // int32_t (!!!)
 /*
     read blackjok3rtt comments in main.cpp 
 */
-int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
+int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block,const CCoinsViewCache *view,const CBlockUndo *blockundo)
 {
-    static int32_t hwmheight;
+    static int32_t hwmheight; static struct komodo_notaryset notaryset;
     int32_t staked_era; static int32_t lastStakedEra;
     std::vector<int32_t> notarisations;
     uint64_t signedmask,voutmask; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp;
@@ -849,6 +909,7 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
     }
     numnotaries = komodo_notaries(pubkeys,pindex->GetHeight(),pindex->GetBlockTime());
     calc_rmd160_sha256(rmd160,pubkeys[0],33);
+    komodo_notaryset_update(&notaryset,pubkeys,numnotaries > 0 ? numnotaries : 0);
     if ( pindex->GetHeight() > hwmheight )
         hwmheight = pindex->GetHeight();
     else
@@ -890,9 +951,9 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
             {
                 if ( i == 0 && j == 0 )
                     continue;
-                if ( (scriptlen= gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n)) > 0 )
+                if ( (scriptlen= komodo_spentscript(scriptPubKey,sizeof(scriptPubKey),block,i,j,view,blockundo)) > 0 )
                 {
-                    if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160)) >= 0 )
+                    if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,&notaryset,rmd160)) >= 0 )
                         signedmask |= (1LL << k);
                     else if ( 0 && numvins >= 17 )
                     {
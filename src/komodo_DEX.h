@@ -20,6 +20,7 @@
  
  _functions() assume DEX_globalmutex is locked when it is called
  functions() assume that DEX_globalmutes is not locked when it is called and must lock/unlock to call _functions()
+ the get/list/orderbook queries only lock DEX_globalmutex to find where to start, then walk the index lists unlocked, see DEX_epoch
  
  message format: <relay depth> <funcid> <timestamp> <payload>
  
@@ -107,6 +108,7 @@ int32_t komodo_DEX_request(int32_t priority,uint32_t shorthash,uint32_t timestam
 
 #define KOMODO_DEX_FILEBUFSIZE 10000
 #define KOMODO_DEX_STREAMSIZE 100
+#define KOMODO_DEX_PUBLISHJOBS 256 // changed fragments that DEX_publish broadcasts in parallel per batch
 #define KOMODO_DEX_ANONSIZE 1024
 
 #define _komodo_DEXquotehash(hash,len) (uint32_t)(((hash).ulongs[0] >> (KOMODO_DEX_TXPOWBITS + komodo_DEX_sizepriority(len))))
@@ -121,7 +123,7 @@ struct DEX_datablob
     struct DEX_datablob *nexts[KOMODO_DEX_MAXINDICES],*prevs[KOMODO_DEX_MAXINDICES];
     bits256 hash;
     uint8_t peermask[KOMOD_DEX_PEERMASKSIZE];
-    uint32_t recvtime,cancelled,lastlist,shorthash;
+    uint32_t recvtime,cancelled,retired,shorthash;
     int32_t datalen;
     int8_t priority,sizepriority;
     uint8_t numsent,offset,linkmask,requested;
@@ -154,6 +156,11 @@ static int64_t DEX_lookup32,DEX_collision32,DEX_add32,DEX_maxlag;
 static int64_t DEX_Numpending,DEX_freed,DEX_truncated;
 // end perf metrics
 
+// RPC queries walk the index lists without holding DEX_globalmutex, so a datablob unlinked by the purge is only retired at the current epoch. It is freed once every reader that started at or before that epoch is done
+static uint32_t DEX_epoch;
+static std::multiset<uint32_t> DEX_readepochs;
+static std::vector<struct DEX_datablob *> DEX_retired;
+
 static uint32_t Got_Recent_Quote;
 bits256 DEX_pubkey,GENESIS_PUBKEY,GENESIS_PRIVKEY;
 pthread_mutex_t DEX_globalmutex;
@@ -200,12 +207,6 @@ void komodo_DEX_init()
     }
 }
 
-uint32_t komodo_DEX_listid()
-{
-    static uint32_t listid;
-    return(++listid);
-}
-
 int32_t komodo_DEX_islagging()
 {
     if ( (DEX_lag > DEX_lag2 && DEX_lag2 > DEX_lag3 && DEX_lag > KOMODO_DEX_MAXLAG/KOMODO_DEX_MAXHOPS && DEX_Numpending >= KOMODO_DEX_MAXPERSEC/2) || DEX_Numpending >= KOMODO_DEX_MAXPERSEC )
@@ -353,12 +354,12 @@ void _komodo_DEX_enqueue(int32_t ind,struct DEX_index *index,struct DEX_datablob
 {
     if ( GETBIT(&ptr->linkmask,ind) != 0 )
     {
-        fprintf(stderr,"duplicate link attempted ind.%d ptr.%p listid.%d\n",ind,ptr,ptr->lastlist);
+        fprintf(stderr,"duplicate link attempted ind.%d ptr.%p %08x\n",ind,ptr,ptr->shorthash);
         return;
     }
     if ( ptr->datalen < KOMODO_DEX_ROUTESIZE )
     {
-        fprintf(stderr,"already truncated datablob cant be linked ind.%d ptr.%p listid.%d\n",ind,ptr,ptr->lastlist);
+        fprintf(stderr,"already truncated datablob cant be linked ind.%d ptr.%p %08x\n",ind,ptr,ptr->shorthash);
         return;
     }
     DL_APPENDind(index->head,ptr,ind);
@@ -404,6 +405,49 @@ uint32_t _komodo_DEX_peerclear(int32_t peerpos)
     return(n);
 }
 
+uint32_t _komodo_DEX_readbegin()
+{
+    DEX_readepochs.insert(DEX_epoch);
+    return(DEX_epoch);
+}
+
+void komodo_DEX_readend(uint32_t epoch)
+{
+    pthread_mutex_lock(&DEX_globalmutex);
+    DEX_readepochs.erase(DEX_readepochs.find(epoch));
+    pthread_mutex_unlock(&DEX_globalmutex);
+}
+
+void _komodo_DEX_retire(struct DEX_datablob *ptr)
+{
+    ptr->retired = DEX_epoch;
+    DEX_retired.push_back(ptr);
+}
+
+int32_t _komodo_DEX_reclaim()
+{
+    int32_t n = 0;
+    while ( n < DEX_retired.size() && (DEX_readepochs.size() == 0 || DEX_retired[n]->retired < *DEX_readepochs.begin()) )
+    {
+        free(DEX_retired[n]);
+        n++;
+    }
+    if ( n > 0 )
+        DEX_retired.erase(DEX_retired.begin(),DEX_retired.begin() + n);
+    DEX_freed += n;
+    DEX_epoch++;
+    return(n);
+}
+
+// walks towards the head without DEX_globalmutex: stops at the head seen when the walk started, or when ptr has since become the head itself as its prevs then wraps around to the tail
+struct DEX_datablob *komodo_DEX_readprev(struct DEX_datablob *ptr,struct DEX_datablob *head,int32_t ind)
+{
+    struct DEX_datablob *prev;
+    if ( ptr == head || (prev= __atomic_load_n(&ptr->prevs[ind],__ATOMIC_ACQUIRE)) == 0 || __atomic_load_n(&prev->nexts[ind],__ATOMIC_ACQUIRE) != ptr )
+        return(0);
+    return(prev);
+}
+
 int32_t _komodo_DEX_purgeindex(int32_t ind,struct DEX_index *index,uint32_t cutoff)
 {
     uint32_t t; int32_t n=0; struct DEX_datablob *ptr = 0;
@@ -428,8 +472,7 @@ int32_t _komodo_DEX_purgeindex(int32_t ind,struct DEX_index *index,uint32_t cuto
 #if KOMODO_DEX_PURGELIST
                 G->Purgelist[G->numpurges++] = ptr;
 #else
-                free(ptr);
-                DEX_freed++;
+                _komodo_DEX_retire(ptr);
 #endif
              } // else fprintf(stderr,"%p ind.%d linkmask.%x\n",ptr,ind,ptr->linkmask);
              ptr = index->head;
@@ -546,6 +589,7 @@ int32_t _komodo_DEX_purgeindices(uint32_t cutoff)
         } else fprintf(stderr,"unexpected null ptr at %d of %d\n",i,G->numpurges);
     }
 #endif
+    _komodo_DEX_reclaim();
     return(n);
 }
 
@@ -1632,17 +1676,6 @@ UniValue komodo_DEX_dataobj(struct DEX_datablob *ptr)
     return(item);
 }
 
-UniValue _komodo_DEXget(uint32_t shorthash)
-{
-    UniValue result; int32_t modval; struct DEX_datablob *ptr;
-    for (modval=0; modval<KOMODO_DEX_PURGETIME; modval++)
-    {
-        if ( (ptr= _komodo_DEXfind(modval,shorthash)) != 0 )
-            return(komodo_DEX_dataobj(ptr));
-    }
-    return(result);
-}
-
 UniValue komodo_DEXbroadcast(uint64_t *locatorp,uint8_t funcid,char *hexstr,int32_t priority,char *tagA,char *tagB,char *destpub33,char *volA,char *volB)
 {
     UniValue result; struct DEX_datablob *ptr=0; std::vector<uint8_t> packet; bits256 hash,pubkey; uint8_t quote[128],destpub[33],*payload=0,*payload2=0,*allocated=0; int32_t blastflag,i,m=0,ind,explen,len=0,datalen=0,destpubflag=0,slen,modval,iter; uint32_t shorthash,timestamp; uint64_t amountA=0,amountB=0;
@@ -1882,6 +1915,25 @@ int32_t _komodo_DEX_gettips(struct DEX_index *tips[KOMODO_DEX_MAXINDICES],int8_t
     return(_DEX_updatetips(tips,0,0,lenA,(uint8_t *)tagA,lenB,(uint8_t *)tagB,destpub,plen) & 0xffff);
 }
 
+// only the index lookup is done under DEX_globalmutex, the caller walks tails[] towards heads[] with komodo_DEX_readprev and must call komodo_DEX_readend(epoch) when done, even on error
+int32_t komodo_DEX_readtips(uint32_t &epoch,struct DEX_datablob *tails[KOMODO_DEX_MAXINDICES],struct DEX_datablob *heads[KOMODO_DEX_MAXINDICES],int8_t &lenA,char *tagA,int8_t &lenB,char *tagB,int8_t &plen,uint8_t *destpub,char *destpub33,uint64_t &minamountA,char *minA,uint64_t &maxamountA,char *maxA,uint64_t &minamountB,char *minB,uint64_t &maxamountB,char *maxB)
+{
+    struct DEX_index *tips[KOMODO_DEX_MAXINDICES]; int32_t ind,err;
+    pthread_mutex_lock(&DEX_globalmutex);
+    err = _komodo_DEX_gettips(tips,lenA,tagA,lenB,tagB,plen,destpub,destpub33,minamountA,minA,maxamountA,maxA,minamountB,minB,maxamountB,maxB);
+    for (ind=0; ind<KOMODO_DEX_MAXINDICES; ind++)
+    {
+        if ( err >= 0 && tips[ind] != 0 )
+        {
+            tails[ind] = tips[ind]->tail;
+            heads[ind] = tips[ind]->head;
+        } else tails[ind] = heads[ind] = 0;
+    }
+    epoch = _komodo_DEX_readbegin();
+    pthread_mutex_unlock(&DEX_globalmutex);
+    return(err);
+}
+
 int32_t komodo_DEX_ptrfilter(uint64_t &amountA,uint64_t &amountB,struct DEX_datablob *ptr,int32_t minpriority,int8_t lenA,char *tagA,int8_t lenB,char *tagB,int8_t plen,uint8_t *destpub,uint64_t minamountA,uint64_t maxamountA,uint64_t minamountB,uint64_t maxamountB)
 {
     int32_t priority,skipflag = 0;
@@ -1914,42 +1966,37 @@ int32_t komodo_DEX_ptrfilter(uint64_t &amountA,uint64_t &amountB,struct DEX_data
     return(skipflag);
 }
 
-UniValue _komodo_DEXlist(uint32_t stopat,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB,char *stophashstr)
+UniValue komodo_DEXlist(uint32_t stopat,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB,char *stophashstr)
 {
-    UniValue result(UniValue::VOBJ),a(UniValue::VARR);  struct DEX_datablob *ptr; int32_t err,ind,n=0,skipflag; bits256 stophash; struct DEX_index *tips[KOMODO_DEX_MAXINDICES],*index; uint64_t minamountA=0,maxamountA=(1LL<<63),minamountB=0,maxamountB=(1LL<<63),amountA,amountB; int8_t lenA=0,lenB=0,plen=0; uint8_t destpub[33]; uint32_t thislist;
+    UniValue result(UniValue::VOBJ),a(UniValue::VARR); std::set<struct DEX_datablob *> listed; struct DEX_datablob *ptr,*tails[KOMODO_DEX_MAXINDICES],*heads[KOMODO_DEX_MAXINDICES]; int32_t err,ind,n=0,skipflag; bits256 stophash; uint64_t minamountA=0,maxamountA=(1LL<<63),minamountB=0,maxamountB=(1LL<<63),amountA,amountB; int8_t lenA=0,lenB=0,plen=0; uint8_t destpub[33]; uint32_t epoch;
     if ( stophashstr != 0 && is_hexstr(stophashstr,0) == 64 )
         decode_hex(stophash.bytes,32,stophashstr);
     else memset(stophash.bytes,0,32);
     //fprintf(stderr,"DEX_list (%s) (%s)\n",tagA,tagB);
-    if ( (err= _komodo_DEX_gettips(tips,lenA,tagA,lenB,tagB,plen,destpub,destpub33,minamountA,minA,maxamountA,maxA,minamountB,minB,maxamountB,maxB)) < 0 )
+    if ( (err= komodo_DEX_readtips(epoch,tails,heads,lenA,tagA,lenB,tagB,plen,destpub,destpub33,minamountA,minA,maxamountA,maxA,minamountB,minB,maxamountB,maxB)) < 0 )
     {
+        komodo_DEX_readend(epoch);
         result.push_back(Pair((char *)"result",(char *)"error"));
         result.push_back(Pair((char *)"errcode",err));
         return(result);
     }
-    thislist = komodo_DEX_listid();
     n = 0;
     for (ind=0; ind<KOMODO_DEX_MAXINDICES; ind++)
     {
-        if ( (index= tips[ind]) != 0 )
+        for (ptr=tails[ind]; ptr!=0; ptr=komodo_DEX_readprev(ptr,heads[ind],ind))
         {
-            for (ptr=index->tail; ptr!=0; ptr=ptr->prevs[ind])
+            if ( (stopat != 0 && komodo_DEX_id(ptr) == stopat) || memcmp(stophash.bytes,ptr->hash.bytes,32) == 0 )
+                break;
+            skipflag = komodo_DEX_ptrfilter(amountA,amountB,ptr,minpriority,lenA,tagA,lenB,tagB,plen,destpub,minamountA,maxamountA,minamountB,maxamountB);
+            if ( skipflag == 0 && listed.insert(ptr).second != 0 )
             {
-                if ( (stopat != 0 && komodo_DEX_id(ptr) == stopat) || memcmp(stophash.bytes,ptr->hash.bytes,32) == 0 )
-                    break;
-                skipflag = komodo_DEX_ptrfilter(amountA,amountB,ptr,minpriority,lenA,tagA,lenB,tagB,plen,destpub,minamountA,maxamountA,minamountB,maxamountB);
-                if ( skipflag == 0 && ptr->lastlist != thislist )
-                {
-                    ptr->lastlist = thislist;
-                    //fprintf(stderr,"%u ",ptr->shorthash);
-                    a.push_back(komodo_DEX_dataobj(ptr));
-                    n++;
-                }
-                if ( ptr == index->head )
-                    break;
+                //fprintf(stderr,"%u ",ptr->shorthash);
+                a.push_back(komodo_DEX_dataobj(ptr));
+                n++;
             }
         }
     }
+    komodo_DEX_readend(epoch);
     //fprintf(stderr,"ids\n");
     result.push_back(Pair((char *)"result",(char *)"success"));
     result.push_back(Pair((char *)"matches",a));
@@ -2077,9 +2124,9 @@ struct DEX_orderbookentry *DEX_orderbookentry(struct DEX_datablob *ptr,int32_t r
     return(op);
 }
 
-UniValue _komodo_DEXorderbook(int32_t revflag,int32_t maxentries,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB)
+UniValue komodo_DEXorderbook(int32_t revflag,int32_t maxentries,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB)
 {
-    UniValue result(UniValue::VOBJ),a(UniValue::VARR); struct DEX_orderbookentry *op; std::vector<struct DEX_orderbookentry *>orders; struct DEX_datablob *ptr; uint32_t thislist; int32_t i,err,ind,n=0,skipflag; struct DEX_index *tips[KOMODO_DEX_MAXINDICES],*index; uint64_t minamountA=0,maxamountA=(1LL<<63),minamountB=0,maxamountB=(1LL<<63),amountA,amountB; int8_t lenA=0,lenB=0,plen=0; uint8_t destpub[33];
+    UniValue result(UniValue::VOBJ),a(UniValue::VARR); struct DEX_orderbookentry *op; std::vector<struct DEX_orderbookentry *>orders; std::set<struct DEX_datablob *> listed; struct DEX_datablob *ptr,*tails[KOMODO_DEX_MAXINDICES],*heads[KOMODO_DEX_MAXINDICES]; uint32_t epoch; int32_t i,err,ind,n=0,skipflag; uint64_t minamountA=0,maxamountA=(1LL<<63),minamountB=0,maxamountB=(1LL<<63),amountA,amountB; int8_t lenA=0,lenB=0,plen=0; uint8_t destpub[33];
     if ( maxentries <= 0 )
         maxentries = 10;
     if ( tagA[0] == 0 || tagB[0] == 0 )
@@ -2089,35 +2136,30 @@ UniValue _komodo_DEXorderbook(int32_t revflag,int32_t maxentries,int32_t minprio
         result.push_back(Pair((char *)"errcode",-13));
         return(result);
     }
-    if ( (err= _komodo_DEX_gettips(tips,lenA,tagA,lenB,tagB,plen,destpub,destpub33,minamountA,minA,maxamountA,maxA,minamountB,minB,maxamountB,maxB)) < 0 )
+    if ( (err= komodo_DEX_readtips(epoch,tails,heads,lenA,tagA,lenB,tagB,plen,destpub,destpub33,minamountA,minA,maxamountA,maxA,minamountB,minB,maxamountB,maxB)) < 0 )
     {
         //fprintf(stderr,"couldnt find any\n");
+        komodo_DEX_readend(epoch);
         return(a);
     }
-    thislist = komodo_DEX_listid();
     n = 0;
     for (ind=KOMODO_DEX_MAXINDICES-1; ind<KOMODO_DEX_MAXINDICES; ind++) // only need tagABs
     {
-        if ( (index= tips[ind]) != 0 )
+        for (ptr=tails[ind]; ptr!=0; ptr=komodo_DEX_readprev(ptr,heads[ind],ind))
         {
-            for (ptr=index->tail; ptr!=0; ptr=ptr->prevs[ind])
+            skipflag = komodo_DEX_ptrfilter(amountA,amountB,ptr,minpriority,lenA,tagA,lenB,tagB,plen,destpub,minamountA,maxamountA,minamountB,maxamountB);
+            if ( skipflag == 0 && ptr->cancelled == 0 && amountA != 0 && amountB != 0 )
             {
-                skipflag = komodo_DEX_ptrfilter(amountA,amountB,ptr,minpriority,lenA,tagA,lenB,tagB,plen,destpub,minamountA,maxamountA,minamountB,maxamountB);
-                if ( skipflag == 0 && ptr->cancelled == 0 && amountA != 0 && amountB != 0 )
+                if ( listed.insert(ptr).second != 0 && (op= DEX_orderbookentry(ptr,revflag,tagA,tagB)) != 0 ) //
                 {
-                    if ( ptr->lastlist != thislist && (op= DEX_orderbookentry(ptr,revflag,tagA,tagB)) != 0 ) //
-                    {
-                        //fprintf(stderr,"ADD n.%d lastlist.%u vs %u\n",n,ptr->lastlist,thislist);
-                        ptr->lastlist = thislist;
-                        orders.push_back(op);
-                        n++;
-                    } else fprintf(stderr,"skip ptr->lastlist.%u vs thislist.%d\n",ptr->lastlist,thislist);
-                } //else fprintf(stderr,"skipflag.%d cancelled.%u plen.%d amountA %.8f amountB %.8f\n",skipflag,ptr->cancelled,plen,dstr(amountA),dstr(amountB));
-                if ( ptr == index->head )
-                    break;
-            }
+                    //fprintf(stderr,"ADD n.%d %08x\n",n,ptr->shorthash);
+                    orders.push_back(op);
+                    n++;
+                } else fprintf(stderr,"skip already listed or invalid %08x\n",ptr->shorthash);
+            } //else fprintf(stderr,"skipflag.%d cancelled.%u plen.%d amountA %.8f amountB %.8f\n",skipflag,ptr->cancelled,plen,dstr(amountA),dstr(amountB));
         }
     }
+    komodo_DEX_readend(epoch);
     if ( n > 0 )
     {
         //fprintf(stderr,"sort %d orders for %s/%s\n",n,tagA,tagB);
@@ -2240,40 +2282,38 @@ UniValue komodo_DEXcancel(char *pubkeystr,uint32_t shorthash,char *tagA,char *ta
 
 UniValue komodo_DEXget(uint32_t shorthash)
 {
-    UniValue result;
-    pthread_mutex_lock(&DEX_globalmutex);
-    result = _komodo_DEXget(shorthash);
-    pthread_mutex_unlock(&DEX_globalmutex);
-    return(result);
-}
-
-UniValue komodo_DEXlist(uint32_t stopat,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB,char *stophashstr)
-{
-    UniValue result;
+    UniValue result; int32_t modval; uint32_t epoch; struct DEX_datablob *ptr = 0;
     pthread_mutex_lock(&DEX_globalmutex);
-    result = _komodo_DEXlist(stopat,minpriority,tagA,tagB,destpub33,minA,maxA,minB,maxB,stophashstr);
-    pthread_mutex_unlock(&DEX_globalmutex);
-    return(result);
-}
-
-UniValue komodo_DEXorderbook(int32_t revflag,int32_t maxentries,int32_t minpriority,char *tagA,char *tagB,char *destpub33,char *minA,char *maxA,char *minB,char *maxB)
-{
-    UniValue result;
-    pthread_mutex_lock(&DEX_globalmutex);
-    result = _komodo_DEXorderbook(revflag,maxentries,minpriority,tagA,tagB,destpub33,minA,maxA,minB,maxB);
+    for (modval=0; modval<KOMODO_DEX_PURGETIME; modval++)
+    {
+        if ( (ptr= _komodo_DEXfind(modval,shorthash)) != 0 )
+            break;
+    }
+    epoch = _komodo_DEX_readbegin();
     pthread_mutex_unlock(&DEX_globalmutex);
+    if ( ptr != 0 )
+        result = komodo_DEX_dataobj(ptr);
+    komodo_DEX_readend(epoch);
     return(result);
 }
 
 bits256 komodo_DEX_filehash(FILE *fp,uint64_t offset0,uint64_t rlen,char *fname)
 {
-    bits256 filehash; uint8_t *data = (uint8_t *)calloc(1,rlen);
+    CSHA256 hasher; bits256 filehash; uint8_t buf[KOMODO_DEX_FILEBUFSIZE * 4]; uint64_t len,remains = rlen;
     fseek(fp,offset0,SEEK_SET);
     memset(filehash.bytes,0,sizeof(filehash));
-    if ( fread(data,1,rlen,fp) == rlen )
-        vcalc_sha256(0,filehash.bytes,data,rlen);
-    else fprintf(stderr," reading %lld bytes from %s.%llu\n",(long long)rlen,fname,(long long)offset0);
-    free(data);
+    while ( remains > 0 ) // same digest as hashing the whole range at once, in constant memory
+    {
+        len = remains < sizeof(buf) ? remains : sizeof(buf);
+        if ( fread(buf,1,len,fp) != len )
+        {
+            fprintf(stderr," reading %lld bytes from %s.%llu\n",(long long)rlen,fname,(long long)offset0);
+            return(filehash);
+        }
+        hasher.Write(buf,len);
+        remains -= len;
+    }
+    hasher.Finalize(filehash.bytes);
     return(filehash);
 }
 
@@ -2360,12 +2400,13 @@ int32_t komodo_DEX_request(int32_t priority,uint32_t shorthash,uint32_t timestam
 
 int32_t komodo_DEX_locatorsync(int32_t &needrequest,int32_t &written,FILE *fp,uint64_t locator,long offset,bits256 senderpub,char *tagA)
 {
-    uint32_t t,h; struct DEX_datablob *fragptr; int32_t fraglen,errflag=0; uint8_t buf[KOMODO_DEX_FILEBUFSIZE];
+    uint32_t t,h,epoch; struct DEX_datablob *fragptr; int32_t fraglen,errflag=0; uint8_t buf[KOMODO_DEX_FILEBUFSIZE];
     t = locator >> 32;
     h = locator & 0xffffffff;
     {
         pthread_mutex_lock(&DEX_globalmutex);
         fragptr = _komodo_DEXfind(t % KOMODO_DEX_PURGETIME,h);
+        epoch = _komodo_DEX_readbegin();
         pthread_mutex_unlock(&DEX_globalmutex);
     }
     errflag = 0;
@@ -2397,9 +2438,46 @@ int32_t komodo_DEX_locatorsync(int32_t &needrequest,int32_t &written,FILE *fp,ui
         //fprintf(stderr,"%s: missing t.%u h.%08x\n",fname,t % KOMODO_DEX_PURGETIME,h);
         needrequest = 1;
     }
+    komodo_DEX_readend(epoch);
     return(-errflag);
 }
 
+int32_t komodo_DEX_locatorsyncs(int32_t &needrequest,int32_t &written,char *fullfname,uint64_t *locators,std::vector<int32_t> &fragments,bits256 senderpub,char *tagA)
+{
+    // decrypting the fragments dominates, so all cores sync them, each with its own handle as the fragments never overlap
+    std::atomic<int32_t> next(0),missing(0),numwritten(0),requests(0); std::vector<std::thread> workers; int32_t i,numthreads = GetNumCores();
+    if ( numthreads > (int32_t)fragments.size() )
+        numthreads = (int32_t)fragments.size();
+    for (i=0; i<numthreads; i++)
+    {
+        workers.push_back(std::thread([&]()
+        {
+            FILE *fp; int32_t j,frag,needreq=0,wrote=0;
+            fp = fopen(fullfname,(char *)"rb+");
+            while ( (j= next++) < (int32_t)fragments.size() )
+            {
+                frag = fragments[j];
+                if ( fp == 0 || komodo_DEX_locatorsync(needreq,wrote,fp,locators[frag],(long)frag*KOMODO_DEX_FILEBUFSIZE,senderpub,tagA) < 0 )
+                {
+                    missing++;
+                    locators[frag] = 0;
+                }
+            }
+            if ( fp != 0 )
+                fclose(fp);
+            numwritten += wrote;
+            if ( needreq != 0 )
+                requests++;
+        }));
+    }
+    for (i=0; i<numthreads; i++)
+        workers[i].join();
+    written += numwritten;
+    if ( requests != 0 )
+        needrequest = 1;
+    return(missing);
+}
+
 UniValue komodo_DEXsubscribe(int32_t &cmpflag,char *origfname,int32_t priority,uint32_t shorthash,char *publisher,int32_t sliceid)
 {
     static uint64_t locators[KOMODO_DEX_MAXPACKETSIZE/sizeof(uint64_t)+1],zero[4];
@@ -2528,25 +2606,23 @@ UniValue komodo_DEXsubscribe(int32_t &cmpflag,char *origfname,int32_t priority,u
                 fp = fopen(fullfname,(char *)"wb");
             if ( fp != 0 )
             {
+                std::vector<int32_t> fragments;
+                fclose(fp), fp = 0;
                 for (i=0; i<(int32_t)amountB; i++)
                 {
                     if ( (locator= locators[i]) == 0 ) // we already had it from previous rpc call
-                    {
                         locators[i] = prevlocators[i];
-                        continue;
-                    }
-                    if ( komodo_DEX_locatorsync(requestflag,written,fp,locator,i*KOMODO_DEX_FILEBUFSIZE,senderpub,(char *)tagA) < 0 )
-                    {
-                        missing++;
-                        locators[i] = 0;
-                    }
+                    else fragments.push_back(i);
                 }
-                fclose(fp), fp = 0;
+                missing = komodo_DEX_locatorsyncs(requestflag,written,fullfname,locators,fragments,senderpub,(char *)tagA);
                 if ( (fp= fopen(fullfname,"rb")) != 0 )
                 {
                     fseek(fp,0,SEEK_END);
-                    filehash = komodo_DEX_filehash(fp,0,ftell(fp),fullfname);
-                    result.push_back(Pair((char *)"filehash",bits256_str(str,filehash)));
+                    if ( missing == 0 || sliceid != 0 ) // a slice is at most KOMODO_DEX_STREAMSIZE fragments and is checked on every call, a whole file only once nothing is missing
+                    {
+                        filehash = komodo_DEX_filehash(fp,0,ftell(fp),fullfname);
+                        result.push_back(Pair((char *)"filehash",bits256_str(str,filehash)));
+                    }
                     result.push_back(Pair((char *)"checkhash",bits256_str(str,checkhash)));
                     if ( missing == 0 && ftell(fp) == amountA )
                     {
@@ -2613,10 +2689,49 @@ UniValue komodo_DEXsubscribe(int32_t &cmpflag,char *origfname,int32_t priority,u
     return(result);
 }
 
+struct DEX_publishjob { uint64_t volA,locator; int32_t rlen; uint8_t buf[KOMODO_DEX_FILEBUFSIZE]; };
+
+// joins a thread on every way out of the scope, destroying a joinable std::thread aborts the process
+struct DEX_threadjoin
+{
+    std::thread &thread;
+    DEX_threadjoin(std::thread &t) : thread(t) {}
+    ~DEX_threadjoin() { if ( thread.joinable() ) thread.join(); }
+};
+
+int32_t komodo_DEX_publishjobs(uint8_t *locators,struct DEX_publishjob *jobs,int32_t numjobs,int32_t priority,char *fname,char *pubkeystr)
+{
+    // the txpow and encryption of every fragment dominate publishing, so a batch is broadcast on all cores
+    std::atomic<int32_t> next(0); std::vector<std::thread> workers; int32_t i,numthreads = GetNumCores();
+    if ( numthreads > numjobs )
+        numthreads = numjobs;
+    for (i=0; i<numthreads; i++)
+    {
+        workers.push_back(std::thread([&]()
+        {
+            char bufstr[KOMODO_DEX_FILEBUFSIZE*2+1],volAstr[16]; int32_t j;
+            while ( (j= next++) < numjobs )
+            {
+                init_hexbytes_noT(bufstr,jobs[j].buf,jobs[j].rlen);
+                sprintf(volAstr,"%llu.%08llu",(long long)jobs[j].volA/COIN,(long long)jobs[j].volA % COIN);
+                komodo_DEXbroadcast(&jobs[j].locator,'Q',bufstr,priority,fname,(char *)"data",pubkeystr,volAstr,(char *)"");
+            }
+        }));
+    }
+    for (i=0; i<numthreads; i++)
+        workers[i].join();
+    for (i=0; i<numjobs; i++)
+    {
+        iguana_rwnum(1,&locators[jobs[i].volA*sizeof(uint64_t) + sizeof(uint64_t)],sizeof(jobs[i].locator),&jobs[i].locator);
+        //fprintf(stderr,"broadcast locator.%d: t.%u h.%08x fraglen.%d\n",(int32_t)jobs[i].volA,(uint32_t)(jobs[i].locator >> 32) % KOMODO_DEX_PURGETIME,(uint32_t)jobs[i].locator,jobs[i].rlen);
+    }
+    return(numjobs);
+}
+
 UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
 {
     static uint8_t locators[KOMODO_DEX_MAXPACKETSIZE];
-    UniValue result(UniValue::VOBJ); FILE *fp,*oldfp=0; uint64_t locator,filesize=0,volA,offset0=0,prevoffset0; long fsize; int32_t i,rlen,rescan=0,n,cmpflag,numprev,oldn=0,numlocators=0,changed=0,mult; bits256 filehash; uint8_t buf[KOMODO_DEX_FILEBUFSIZE],oldbuf[KOMODO_DEX_FILEBUFSIZE],zeros[sizeof(uint64_t)]; char bufstr[sizeof(buf)*2+1],pubkeystr[67],str[65],fname2[512],volAstr[16],volBstr[16],locatorfname[512],oldfname[512],*hexstr;
+    UniValue result(UniValue::VOBJ); FILE *fp,*oldfp=0; uint64_t locator,filesize=0,volA,offset0=0,prevoffset0; long fsize; int32_t i,rlen,rescan=0,n,cmpflag,numprev,oldn=0,numlocators=0,changed=0,mult,numjobs=0; bits256 filehash; uint8_t buf[KOMODO_DEX_FILEBUFSIZE],oldbuf[KOMODO_DEX_FILEBUFSIZE],zeros[sizeof(uint64_t)]; char pubkeystr[67],str[65],fname2[512],volAstr[16],volBstr[16],locatorfname[512],oldfname[512],path[512],*hexstr; struct DEX_publishjob *jobs; std::thread hasher;
     DEX_progress = 0;
     if ( sliceid < 0 )
     {
@@ -2649,7 +2764,9 @@ UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
         result.push_back(Pair((char *)"filename",fname));
         return(result);
     }
-    else if ( (fp= fopen(fname,(char *)"rb")) == 0 )
+    else if ( (fp= fopen(fname,(char *)"rb")) != 0 )
+        strcpy(path,fname);
+    else
     {
         char altname[512],*appdata;
 #ifdef _WIN32
@@ -2669,6 +2786,7 @@ UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
             result.push_back(Pair((char *)"altname",altname));
             return(result);
         }
+        strcpy(path,altname);
     }
     fseek(fp,0,SEEK_END);
     fsize = ftell(fp);
@@ -2717,6 +2835,18 @@ UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
     if ( sliceid != 0 && n > KOMODO_DEX_STREAMSIZE )
         n = KOMODO_DEX_STREAMSIZE;
     iguana_rwnum(1,&locators[0],sizeof(offset0),&offset0);
+    memset(filehash.bytes,0,sizeof(filehash));
+    hasher = std::thread([&]() // overlaps with the fragment broadcasts, fsize is the sum of all fragment lengths
+    {
+        FILE *hashfp;
+        if ( (hashfp= fopen(path,(char *)"rb")) != 0 )
+        {
+            filehash = komodo_DEX_filehash(hashfp,offset0,fsize,fname);
+            fclose(hashfp);
+        }
+    });
+    DEX_threadjoin hasherjoin(hasher);
+    jobs = (struct DEX_publishjob *)calloc(KOMODO_DEX_PUBLISHJOBS,sizeof(*jobs));
     for (volA=0; volA<=n; volA++)
     {
         if ( sliceid != 0 && volA >= KOMODO_DEX_STREAMSIZE )
@@ -2748,16 +2878,16 @@ UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
                 iguana_rwnum(0,&locators[volA*sizeof(uint64_t) + sizeof(uint64_t)],sizeof(locator),&locator);
                 if ( locator == 0 || oldfp == 0 || fread(oldbuf,1,rlen,oldfp) != rlen || memcmp(buf,oldbuf,rlen) != 0 )
                 {
-                    for (i=0; i<rlen; i++)
-                        sprintf(&bufstr[i<<1],"%02x",buf[i]);
-                    bufstr[i<<1] = 0;
-                    sprintf(volAstr,"%llu.%08llu",(long long)volA/COIN,(long long)volA % COIN);
-                    komodo_DEXbroadcast(&locator,'Q',bufstr,priority,fname,(char *)"data",pubkeystr,volAstr,(char *)"");
-                    //fprintf(stderr,".");
-                    DEX_progress = 10000. * volA / n;
-                    iguana_rwnum(1,&locators[volA*sizeof(uint64_t) + sizeof(uint64_t)],sizeof(locator),&locator);
-                    changed++;
-                    //fprintf(stderr,"broadcast locator.%d of %d: t.%u h.%08x %llx fraglen.%d\n",(int32_t)volA,n,(uint32_t)(locator >> 32) % KOMODO_DEX_PURGETIME,(uint32_t)locator,(long long)*(uint64_t *)&locators[volA*sizeof(uint64_t) + sizeof(uint64_t)],rlen);
+                    jobs[numjobs].volA = volA;
+                    jobs[numjobs].locator = 0; // the slot is reused across batches
+                    jobs[numjobs].rlen = rlen;
+                    memcpy(jobs[numjobs].buf,buf,rlen);
+                    if ( ++numjobs == KOMODO_DEX_PUBLISHJOBS )
+                    {
+                        changed += komodo_DEX_publishjobs(locators,jobs,numjobs,priority,fname,pubkeystr);
+                        numjobs = 0;
+                        DEX_progress = 10000. * volA / n;
+                    }
                 }
                 else
                 {
@@ -2774,13 +2904,16 @@ UniValue komodo_DEXpublish(char *fname,int32_t priority,int32_t sliceid)
                 fclose(fp), fp = 0;
                 if ( oldfp != 0 )
                     fclose(oldfp), oldfp = 0;;
+                hasher.join();
+                free(jobs);
                 return(result);
             }
         }
     }
-    if ( sliceid == 0 )
-        filehash = komodo_DEX_filehash(fp,0,fsize,fname);
-    else filehash = komodo_DEX_filehash(fp,offset0,filesize,fname);
+    if ( numjobs > 0 )
+        changed += komodo_DEX_publishjobs(locators,jobs,numjobs,priority,fname,pubkeystr);
+    free(jobs);
+    hasher.join();
     DEX_progress = -1;
     if ( changed != 0 )
     {
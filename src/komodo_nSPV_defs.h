@@ -20,6 +20,7 @@
 #define NSPV_PROTOCOL_VERSION 0x00000004
 #define NSPV_POLLITERS 200
 #define NSPV_POLLMICROS 50000
+#define NSPV_REQTIMEOUT ((int64_t)NSPV_POLLITERS * NSPV_POLLMICROS)
 #define NSPV_MAXVINS 64
 #define NSPV_AUTOLOGOUT 777
 #define NSPV_BRANCHID 0x76b809bb
@@ -55,6 +56,19 @@
 #define NSPV_REMOTERPC 0x14
 #define NSPV_REMOTERPCRESP 0x15
 
+// a superlite request in flight, answered by the next response of type resptype from peer that
+// echoes the request fields hashed into key
+struct NSPV_pending
+{
+    NodeId peer;
+    uint256 key;
+    uint8_t resptype,done;
+    std::vector<uint8_t> response;
+};
+
+void NSPV_pending_add(struct NSPV_pending *req,NodeId peer,uint8_t resptype,uint256 key);
+int32_t NSPV_pending_wait(struct NSPV_pending *req,int64_t timeoutmicros);
+int32_t NSPV_pending_deliver(NodeId peer,uint256 key,std::vector<uint8_t> &response);
 int32_t NSPV_gettransaction(int32_t skipvalidation,int32_t vout,uint256 txid,int32_t height,CTransaction &tx,uint256 &hashblock,int32_t &txheight,int32_t &currentheight,int64_t extradata,uint32_t tiptime,int64_t &rewardsum);
 UniValue NSPV_spend(char *srcaddr,char *destaddr,int64_t satoshis);
 extern uint256 SIG_TXHASH;
@@ -45,6 +45,97 @@ struct NSPV_ntzsresp NSPV_ntzsresp_cache[NSPV_MAXVINS];
 struct NSPV_ntzsproofresp NSPV_ntzsproofresp_cache[NSPV_MAXVINS * 2];
 struct NSPV_txproof NSPV_txproof_cache[NSPV_MAXVINS * 4];
 
+// on-disk store of what the superlite client has verified: txproofs and ntzsproofs whose headers
+// chained to notarizations, and the height -> (blockhash,time) of those headers. Everything in it
+// is immutable chain data, so it survives restarts and logouts and is never purged. The unspentvalue
+// of a txproof is a snapshot of the peer's utxo set and is not stored: it is always zero on load.
+CDBWrapper *NSPV_store;
+
+static const char NSPV_STORE_TXPROOF = 'p';
+static const char NSPV_STORE_NTZSPROOF = 'n';
+static const char NSPV_STORE_HEADER = 'h';
+
+void NSPV_store_open()
+{
+    if ( NSPV_store == 0 )
+        NSPV_store = new CDBWrapper(GetDataDir() / "nspv", 8 << 20, false, false);
+}
+
+void NSPV_store_close()
+{
+    delete NSPV_store;
+    NSPV_store = 0;
+}
+
+bool NSPV_store_hastxproof(uint256 txid)
+{
+    return(NSPV_store != 0 && NSPV_store->Exists(std::make_pair(NSPV_STORE_TXPROOF,txid)));
+}
+
+bool NSPV_store_gettxproof(uint256 txid,struct NSPV_txproof *ptr)
+{
+    std::vector<uint8_t> data;
+    if ( NSPV_store == 0 || !NSPV_store->Read(std::make_pair(NSPV_STORE_TXPROOF,txid),data) || data.empty() )
+        return(false);
+    memset(ptr,0,sizeof(*ptr));
+    if ( NSPV_rwtxproof(0,&data[0],ptr) != (int32_t)data.size() || ptr->txid != txid )
+    {
+        NSPV_txproof_purge(ptr);
+        return(false);
+    }
+    ptr->unspentvalue = 0;
+    return(true);
+}
+
+void NSPV_store_puttxproof(struct NSPV_txproof *ptr)
+{
+    std::vector<uint8_t> data; struct NSPV_txproof P;
+    if ( NSPV_store == 0 || ptr->txprooflen == 0 )
+        return;
+    P = *ptr; // shallow copy, only the proof and tx bytes are persisted
+    P.unspentvalue = 0;
+    data.resize(sizeof(P) + P.txlen + P.txprooflen);
+    data.resize(NSPV_rwtxproof(1,&data[0],&P));
+    NSPV_store->Write(std::make_pair(NSPV_STORE_TXPROOF,ptr->txid),data);
+}
+
+bool NSPV_store_getntzsproof(uint256 prevtxid,uint256 nexttxid,struct NSPV_ntzsproofresp *ptr)
+{
+    std::vector<uint8_t> data;
+    if ( NSPV_store == 0 || !NSPV_store->Read(std::make_pair(NSPV_STORE_NTZSPROOF,std::make_pair(prevtxid,nexttxid)),data) || data.empty() )
+        return(false);
+    memset(ptr,0,sizeof(*ptr));
+    if ( NSPV_rwntzsproofresp(0,&data[0],ptr) != (int32_t)data.size() || ptr->prevtxid != prevtxid || ptr->nexttxid != nexttxid )
+    {
+        NSPV_ntzsproofresp_purge(ptr);
+        return(false);
+    }
+    return(true);
+}
+
+// called once the headers of ptr have been validated against both notarizations
+void NSPV_store_putntzsproof(struct NSPV_ntzsproofresp *ptr)
+{
+    std::vector<uint8_t> data; int32_t i;
+    if ( NSPV_store == 0 || ptr->common.numhdrs == 0 )
+        return;
+    CDBBatch batch(*NSPV_store);
+    data.resize(sizeof(*ptr) + ptr->common.numhdrs*sizeof(*ptr->common.hdrs) + ptr->prevtxlen + ptr->nexttxlen);
+    data.resize(NSPV_rwntzsproofresp(1,&data[0],ptr));
+    batch.Write(std::make_pair(NSPV_STORE_NTZSPROOF,std::make_pair(ptr->prevtxid,ptr->nexttxid)),data);
+    for (i=0; i<ptr->common.numhdrs; i++)
+        batch.Write(std::make_pair(NSPV_STORE_HEADER,ptr->common.prevht+i),std::make_pair(NSPV_hdrhash(&ptr->common.hdrs[i]),ptr->common.hdrs[i].nTime));
+    NSPV_store->WriteBatch(batch);
+}
+
+uint32_t NSPV_store_blocktime(int32_t height)
+{
+    std::pair<uint256,uint32_t> hdr;
+    if ( NSPV_store != 0 && NSPV_store->Read(std::make_pair(NSPV_STORE_HEADER,height),hdr) )
+        return(hdr.second);
+    return(0);
+}
+
 struct NSPV_ntzsresp *NSPV_ntzsresp_find(int32_t reqheight)
 {
     int32_t i;
@@ -68,6 +159,8 @@ struct NSPV_ntzsresp *NSPV_ntzsresp_add(struct NSPV_ntzsresp *ptr)
     return(&NSPV_ntzsresp_cache[i]);
 }
 
+struct NSPV_txproof *NSPV_txproof_add(struct NSPV_txproof *ptr);
+
 struct NSPV_txproof *NSPV_txproof_find(uint256 txid)
 {
     int32_t i; struct NSPV_txproof *backup = 0;
@@ -78,6 +171,12 @@ struct NSPV_txproof *NSPV_txproof_find(uint256 txid)
                 return(&NSPV_txproof_cache[i]);
             else backup = &NSPV_txproof_cache[i];
         }
+    struct NSPV_txproof P;
+    if ( NSPV_store_gettxproof(txid,&P) )
+    {
+        backup = NSPV_txproof_add(&P);
+        NSPV_txproof_purge(&P);
+    }
     return(backup);
 }
 
@@ -107,13 +206,21 @@ struct NSPV_txproof *NSPV_txproof_add(struct NSPV_txproof *ptr)
     return(&NSPV_txproof_cache[i]);
 }
 
+struct NSPV_ntzsproofresp *NSPV_ntzsproof_add(struct NSPV_ntzsproofresp *ptr);
+
 struct NSPV_ntzsproofresp *NSPV_ntzsproof_find(uint256 prevtxid,uint256 nexttxid)
 {
     int32_t i;
     for (i=0; i<sizeof(NSPV_ntzsproofresp_cache)/sizeof(*NSPV_ntzsproofresp_cache); i++)
         if ( NSPV_ntzsproofresp_cache[i].prevtxid == prevtxid && NSPV_ntzsproofresp_cache[i].nexttxid == nexttxid )
             return(&NSPV_ntzsproofresp_cache[i]);
-    return(0);
+    struct NSPV_ntzsproofresp P,*ptr = 0;
+    if ( NSPV_store_getntzsproof(prevtxid,nexttxid,&P) )
+    {
+        ptr = NSPV_ntzsproof_add(&P);
+        NSPV_ntzsproofresp_purge(&P);
+    }
+    return(ptr);
 }
 
 struct NSPV_ntzsproofresp *NSPV_ntzsproof_add(struct NSPV_ntzsproofresp *ptr)
@@ -130,14 +237,176 @@ struct NSPV_ntzsproofresp *NSPV_ntzsproof_add(struct NSPV_ntzsproofresp *ptr)
     return(&NSPV_ntzsproofresp_cache[i]);
 }
 
+// requests waiting for their response. A fullnode answers the requests of one peer in the order
+// they arrive, and the responses that answer a specific txid, height or notarization pair echo it
+// back: a response belongs to the oldest waiting request of its type and key sent to that peer.
+
+CWaitableCriticalSection NSPV_pendingmutex;
+CConditionVariable NSPV_pendingcond;
+std::list<struct NSPV_pending *> NSPV_pendinglist;
+
+// the request fields its response echoes back, hashed. Requests whose responses echo nothing
+// usable get the null key and are matched on peer and type alone
+uint256 NSPV_request_key(uint8_t *msg,int32_t len)
+{
+    uint256 txid,nexttxid; int32_t height,vout;
+    switch ( msg[0] )
+    {
+        case NSPV_NTZS:
+            if ( len < 1+sizeof(height) )
+                break;
+            iguana_rwnum(0,&msg[1],sizeof(height),&height);
+            return(Hash(BEGIN(height),END(height)));
+        case NSPV_NTZSPROOF:
+            if ( len < 1+sizeof(txid)+sizeof(nexttxid) )
+                break;
+            iguana_rwbignum(0,&msg[1],sizeof(txid),(uint8_t *)&txid);
+            iguana_rwbignum(0,&msg[1+sizeof(txid)],sizeof(nexttxid),(uint8_t *)&nexttxid);
+            return(Hash(BEGIN(txid),END(txid),BEGIN(nexttxid),END(nexttxid)));
+        case NSPV_TXPROOF:
+            if ( len < 1+sizeof(height)+sizeof(vout)+sizeof(txid) )
+                break;
+            iguana_rwbignum(0,&msg[1+sizeof(height)+sizeof(vout)],sizeof(txid),(uint8_t *)&txid);
+            return(Hash(BEGIN(txid),END(txid)));
+        case NSPV_SPENTINFO:
+            if ( len < 1+sizeof(vout)+sizeof(txid) )
+                break;
+            iguana_rwnum(0,&msg[1],sizeof(vout),&vout);
+            iguana_rwbignum(0,&msg[1+sizeof(vout)],sizeof(txid),(uint8_t *)&txid);
+            return(Hash(BEGIN(txid),END(txid),BEGIN(vout),END(vout)));
+        case NSPV_BROADCAST:
+            if ( len < 1+sizeof(txid) )
+                break;
+            iguana_rwbignum(0,&msg[1],sizeof(txid),(uint8_t *)&txid);
+            return(Hash(BEGIN(txid),END(txid)));
+    }
+    return(zeroid);
+}
+
+uint256 NSPV_response_key(std::vector<uint8_t> &response)
+{
+    uint256 key;
+    switch ( response[0] )
+    {
+        case NSPV_NTZSRESP:
+        {
+            struct NSPV_ntzsresp N;
+            memset(&N,0,sizeof(N));
+            NSPV_rwntzsresp(0,&response[1],&N);
+            key = Hash(BEGIN(N.reqheight),END(N.reqheight));
+            NSPV_ntzsresp_purge(&N);
+            return(key);
+        }
+        case NSPV_NTZSPROOFRESP:
+        {
+            struct NSPV_ntzsproofresp P;
+            memset(&P,0,sizeof(P));
+            NSPV_rwntzsproofresp(0,&response[1],&P);
+            key = Hash(BEGIN(P.prevtxid),END(P.prevtxid),BEGIN(P.nexttxid),END(P.nexttxid));
+            NSPV_ntzsproofresp_purge(&P);
+            return(key);
+        }
+        case NSPV_TXPROOFRESP:
+        {
+            struct NSPV_txproof P;
+            memset(&P,0,sizeof(P));
+            NSPV_rwtxproof(0,&response[1],&P);
+            key = Hash(BEGIN(P.txid),END(P.txid));
+            NSPV_txproof_purge(&P);
+            return(key);
+        }
+        case NSPV_SPENTINFORESP:
+        {
+            struct NSPV_spentinfo I;
+            memset(&I,0,sizeof(I));
+            NSPV_rwspentinfo(0,&response[1],&I);
+            key = Hash(BEGIN(I.txid),END(I.txid),BEGIN(I.vout),END(I.vout));
+            NSPV_spentinfo_purge(&I);
+            return(key);
+        }
+        case NSPV_BROADCASTRESP:
+        {
+            struct NSPV_broadcastresp B;
+            memset(&B,0,sizeof(B));
+            NSPV_rwbroadcastresp(0,&response[1],&B);
+            return(Hash(BEGIN(B.txid),END(B.txid)));
+        }
+    }
+    return(zeroid);
+}
+
+void NSPV_pending_add(struct NSPV_pending *req,NodeId peer,uint8_t resptype,uint256 key)
+{
+    boost::unique_lock<boost::mutex> lock(NSPV_pendingmutex);
+    req->peer = peer;
+    req->key = key;
+    req->resptype = resptype;
+    req->done = 0;
+    req->response.clear();
+    NSPV_pendinglist.push_back(req);
+}
+
+// returns nonzero with req->response set if the peer answered within timeoutmicros
+int32_t NSPV_pending_wait(struct NSPV_pending *req,int64_t timeoutmicros)
+{
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds(timeoutmicros);
+    boost::unique_lock<boost::mutex> lock(NSPV_pendingmutex);
+    while ( req->done == 0 )
+    {
+        if ( !NSPV_pendingcond.timed_wait(lock,deadline) )
+            break;
+    }
+    NSPV_pendinglist.remove(req);
+    return(req->done);
+}
+
+std::list<struct NSPV_pending *>::iterator NSPV_pending_find(NodeId peer,uint8_t resptype,uint256 key)
+{
+    std::list<struct NSPV_pending *>::iterator it;
+    for (it=NSPV_pendinglist.begin(); it!=NSPV_pendinglist.end(); it++)
+        if ( (*it)->peer == peer && (*it)->resptype == resptype && (*it)->key == key )
+            break;
+    return(it);
+}
+
+int32_t NSPV_pending_expected(NodeId peer,uint8_t resptype,uint256 key)
+{
+    boost::unique_lock<boost::mutex> lock(NSPV_pendingmutex);
+    return(NSPV_pending_find(peer,resptype,key) != NSPV_pendinglist.end());
+}
+
+int32_t NSPV_pending_deliver(NodeId peer,uint256 key,std::vector<uint8_t> &response)
+{
+    std::list<struct NSPV_pending *>::iterator it;
+    {
+        boost::unique_lock<boost::mutex> lock(NSPV_pendingmutex);
+        if ( (it= NSPV_pending_find(peer,response[0],key)) == NSPV_pendinglist.end() )
+            return(0);
+        (*it)->response = response;
+        (*it)->done = 1;
+        NSPV_pendinglist.erase(it);
+    }
+    NSPV_pendingcond.notify_all();
+    return(1);
+}
+
 // komodo_nSPVresp is called from async message processing
 
 void komodo_nSPVresp(CNode *pfrom,std::vector<uint8_t> response) // received a response
 {
-    struct NSPV_inforesp I; int32_t len; uint32_t timestamp = (uint32_t)time(NULL);
+    struct NSPV_inforesp I; struct NSPV_ntzsresp N; struct NSPV_ntzsproofresp P; struct NSPV_txproof T; uint256 key; int32_t len; uint32_t timestamp = (uint32_t)time(NULL);
     strncpy(NSPV_lastpeer,pfrom->addr.ToString().c_str(),sizeof(NSPV_lastpeer)-1);
     if ( (len= response.size()) > 0 )
     {
+        // the info polling of komodo_nSPV does not wait for its answers, everything else is only
+        // taken from a peer that was asked for it. A late answer to a request that timed out
+        // must not overwrite the results of newer ones
+        key = NSPV_response_key(response);
+        if ( response[0] != NSPV_INFORESP && NSPV_pending_expected(pfrom->id,response[0],key) == 0 )
+        {
+            fprintf(stderr,"drop unrequested response %02x size.%d from peer.%d\n",response[0],len,(int32_t)pfrom->id);
+            return;
+        }
         switch ( response[0] )
         {
             case NSPV_INFORESP:
@@ -174,26 +443,30 @@ void komodo_nSPVresp(CNode *pfrom,std::vector<uint8_t> response) // received a r
                 NSPV_rwmempoolresp(0,&response[1],&NSPV_mempoolresult);
                 fprintf(stderr,"got mempool response %u size.%d %s CC.%d num.%d funcid.%d %s/v%d\n",timestamp,(int32_t)response.size(),NSPV_mempoolresult.coinaddr,NSPV_mempoolresult.CCflag,NSPV_mempoolresult.numtxids,NSPV_mempoolresult.funcid,NSPV_mempoolresult.txid.GetHex().c_str(),NSPV_mempoolresult.vout);
                 break;
+            // the requester decodes its own copy from the pending entry, only the caches are filled here
            case NSPV_NTZSRESP:
-                NSPV_ntzsresp_purge(&NSPV_ntzsresult);
-                NSPV_rwntzsresp(0,&response[1],&NSPV_ntzsresult);
-                if ( NSPV_ntzsresp_find(NSPV_ntzsresult.reqheight) == 0 )
-                    NSPV_ntzsresp_add(&NSPV_ntzsresult);
-                fprintf(stderr,"got ntzs response %u size.%d %s prev.%d, %s next.%d\n",timestamp,(int32_t)response.size(),NSPV_ntzsresult.prevntz.txid.GetHex().c_str(),NSPV_ntzsresult.prevntz.height,NSPV_ntzsresult.nextntz.txid.GetHex().c_str(),NSPV_ntzsresult.nextntz.height);
+                memset(&N,0,sizeof(N));
+                NSPV_rwntzsresp(0,&response[1],&N);
+                if ( NSPV_ntzsresp_find(N.reqheight) == 0 )
+                    NSPV_ntzsresp_add(&N);
+                fprintf(stderr,"got ntzs response %u size.%d %s prev.%d, %s next.%d\n",timestamp,(int32_t)response.size(),N.prevntz.txid.GetHex().c_str(),N.prevntz.height,N.nextntz.txid.GetHex().c_str(),N.nextntz.height);
+                NSPV_ntzsresp_purge(&N);
                 break;
             case NSPV_NTZSPROOFRESP:
-                NSPV_ntzsproofresp_purge(&NSPV_ntzsproofresult);
-                NSPV_rwntzsproofresp(0,&response[1],&NSPV_ntzsproofresult);
-                if ( NSPV_ntzsproof_find(NSPV_ntzsproofresult.prevtxid,NSPV_ntzsproofresult.nexttxid) == 0 )
-                    NSPV_ntzsproof_add(&NSPV_ntzsproofresult);
-                fprintf(stderr,"got ntzproof response %u size.%d prev.%d next.%d\n",timestamp,(int32_t)response.size(),NSPV_ntzsproofresult.common.prevht,NSPV_ntzsproofresult.common.nextht);
+                memset(&P,0,sizeof(P));
+                NSPV_rwntzsproofresp(0,&response[1],&P);
+                if ( NSPV_ntzsproof_find(P.prevtxid,P.nexttxid) == 0 )
+                    NSPV_ntzsproof_add(&P);
+                fprintf(stderr,"got ntzproof response %u size.%d prev.%d next.%d\n",timestamp,(int32_t)response.size(),P.common.prevht,P.common.nextht);
+                NSPV_ntzsproofresp_purge(&P);
                 break;
             case NSPV_TXPROOFRESP:
-                NSPV_txproof_purge(&NSPV_txproofresult);
-                NSPV_rwtxproof(0,&response[1],&NSPV_txproofresult);
-                if ( NSPV_txproof_find(NSPV_txproofresult.txid) == 0 )
-                    NSPV_txproof_add(&NSPV_txproofresult);
-                fprintf(stderr,"got txproof response %u size.%d %s ht.%d\n",timestamp,(int32_t)response.size(),NSPV_txproofresult.txid.GetHex().c_str(),NSPV_txproofresult.height);
+                memset(&T,0,sizeof(T));
+                NSPV_rwtxproof(0,&response[1],&T);
+                if ( NSPV_txproof_find(T.txid) == 0 )
+                    NSPV_txproof_add(&T);
+                fprintf(stderr,"got txproof response %u size.%d %s ht.%d\n",timestamp,(int32_t)response.size(),T.txid.GetHex().c_str(),T.height);
+                NSPV_txproof_purge(&T);
                 break;
             case NSPV_SPENTINFORESP:
                 NSPV_spentinfo_purge(&NSPV_spentresult);
@@ -212,14 +485,15 @@ void komodo_nSPVresp(CNode *pfrom,std::vector<uint8_t> response) // received a r
                 break;
 
             default: fprintf(stderr,"unexpected response %02x size.%d at %u\n",response[0],(int32_t)response.size(),timestamp);
-                break;
+                return;
         }
+        NSPV_pending_deliver(pfrom->id,key,response);
     }
 }
 
 // superlite message issuing
 
-CNode *NSPV_req(CNode *pnode,uint8_t *msg,int32_t len,uint64_t mask,int32_t ind)
+CNode *NSPV_req(CNode *pnode,uint8_t *msg,int32_t len,uint64_t mask,int32_t ind,struct NSPV_pending *req = 0)
 {
     int32_t n,flag = 0; CNode *pnodes[64]; uint32_t timestamp = (uint32_t)time(NULL);
     if ( KOMODO_NSPV_FULLNODE )
@@ -253,6 +527,8 @@ CNode *NSPV_req(CNode *pnode,uint8_t *msg,int32_t len,uint64_t mask,int32_t ind)
         memcpy(&request[0],msg,len);
         if ( (0) && KOMODO_NSPV_SUPERLITE )
             fprintf(stderr,"pushmessage [%d] len.%d\n",msg[0],len);
+        if ( req != 0 )
+            NSPV_pending_add(req,pnode->id,msg[0] + 1,NSPV_request_key(msg,len));
         pnode->PushMessage("getnSPV",request);
         pnode->prevtimes[ind] = timestamp;
         return(pnode);
@@ -555,18 +831,19 @@ UniValue NSPV_login(char *wifstr)
 
 UniValue NSPV_getinfo_req(int32_t reqht)
 {
-    uint8_t msg[512]; int32_t i,iter,len = 0; struct NSPV_inforesp I;
+    uint8_t msg[512]; int32_t iter,len = 0; struct NSPV_inforesp I; struct NSPV_pending req;
     NSPV_inforesp_purge(&NSPV_inforesult);
     msg[len++] = NSPV_INFO;
     len += iguana_rwnum(1,&msg[len],sizeof(reqht),&reqht);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_inforesult.height != 0 )
-                return(NSPV_getinfo_json(&NSPV_inforesult));
+            memset(&I,0,sizeof(I));
+            NSPV_rwinforesp(0,&req.response[1],&I);
+            if ( I.height != 0 )
+                return(NSPV_getinfo_json(&I));
         }
     } else sleep(1);
     memset(&I,0,sizeof(I));
@@ -576,6 +853,8 @@ UniValue NSPV_getinfo_req(int32_t reqht)
 uint32_t NSPV_blocktime(int32_t hdrheight)
 {
     uint32_t timestamp; struct NSPV_inforesp old = NSPV_inforesult;
+    if ( hdrheight > 0 && (timestamp= NSPV_store_blocktime(hdrheight)) != 0 )
+        return(timestamp);
     if ( hdrheight > 0 )
     {
         NSPV_getinfo_req(hdrheight);
@@ -593,7 +872,7 @@ uint32_t NSPV_blocktime(int32_t hdrheight)
 
 UniValue NSPV_addressutxos(char *coinaddr,int32_t CCflag,int32_t skipcount,int32_t filter)
 {
-    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t i,iter,slen,len = 0;
+    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t iter,slen,len = 0; struct NSPV_utxosresp U; struct NSPV_pending req;
     //fprintf(stderr,"utxos %s NSPV addr %s\n",coinaddr,NSPV_address.c_str());
     //if ( NSPV_utxosresult.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,NSPV_utxosresult.coinaddr) == 0 && CCflag == NSPV_utxosresult.CCflag  && skipcount == NSPV_utxosresult.skipcount && filter == NSPV_utxosresult.filter )
     //    return(NSPV_utxosresp_json(&NSPV_utxosresult));
@@ -614,13 +893,19 @@ UniValue NSPV_addressutxos(char *coinaddr,int32_t CCflag,int32_t skipcount,int32
     len += iguana_rwnum(1,&msg[len],sizeof(skipcount),&skipcount);
     len += iguana_rwnum(1,&msg[len],sizeof(filter),&filter);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_ADDRINDEX,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_ADDRINDEX,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( (NSPV_inforesult.height == 0 || NSPV_utxosresult.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr,NSPV_utxosresult.coinaddr) == 0 && CCflag == NSPV_utxosresult.CCflag )
-                return(NSPV_utxosresp_json(&NSPV_utxosresult));
+            memset(&U,0,sizeof(U));
+            NSPV_rwutxosresp(0,&req.response[1],&U);
+            if ( (NSPV_inforesult.height == 0 || U.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr,U.coinaddr) == 0 && CCflag == U.CCflag )
+            {
+                result = NSPV_utxosresp_json(&U);
+                NSPV_utxosresp_purge(&U);
+                return(result);
+            }
+            NSPV_utxosresp_purge(&U);
         }
     } else sleep(1);
     result.push_back(Pair("result","error"));
@@ -631,7 +916,7 @@ UniValue NSPV_addressutxos(char *coinaddr,int32_t CCflag,int32_t skipcount,int32
 
 UniValue NSPV_addresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,int32_t filter)
 {
-    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t i,iter,slen,len = 0;
+    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t iter,slen,len = 0; struct NSPV_txidsresp T; struct NSPV_pending req;
     if ( NSPV_txidsresult.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,NSPV_txidsresult.coinaddr) == 0 && CCflag == NSPV_txidsresult.CCflag && skipcount == NSPV_txidsresult.skipcount )
         return(NSPV_txidsresp_json(&NSPV_txidsresult));
     if ( skipcount < 0 )
@@ -652,13 +937,19 @@ UniValue NSPV_addresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,int32
     len += iguana_rwnum(1,&msg[len],sizeof(filter),&filter);
     //fprintf(stderr,"skipcount.%d\n",skipcount);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_ADDRINDEX,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_ADDRINDEX,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( (NSPV_inforesult.height == 0 || NSPV_txidsresult.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr,NSPV_txidsresult.coinaddr) == 0 && CCflag == NSPV_txidsresult.CCflag )
-                return(NSPV_txidsresp_json(&NSPV_txidsresult));
+            memset(&T,0,sizeof(T));
+            NSPV_rwtxidsresp(0,&req.response[1],&T);
+            if ( (NSPV_inforesult.height == 0 || T.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr,T.coinaddr) == 0 && CCflag == T.CCflag )
+            {
+                result = NSPV_txidsresp_json(&T);
+                NSPV_txidsresp_purge(&T);
+                return(result);
+            }
+            NSPV_txidsresp_purge(&T);
         }
     } else sleep(1);
     result.push_back(Pair("result","error"));
@@ -669,7 +960,7 @@ UniValue NSPV_addresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,int32
 
 UniValue NSPV_ccaddresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,uint256 filtertxid,uint8_t evalcode, uint8_t func)
 {
-    UniValue result(UniValue::VOBJ); uint8_t msg[512],funcid=NSPV_CC_TXIDS; char zeroes[64]; int32_t i,iter,slen,len = 0,vout;
+    UniValue result(UniValue::VOBJ); uint8_t msg[512],funcid=NSPV_CC_TXIDS; char zeroes[64]; int32_t iter,slen,len = 0,vout; struct NSPV_mempoolresp M; struct NSPV_pending req;
     NSPV_mempoolresp_purge(&NSPV_mempoolresult);
     memset(zeroes,0,sizeof(zeroes));
     if ( coinaddr == 0 )
@@ -691,13 +982,19 @@ UniValue NSPV_ccaddresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,uin
     memcpy(&msg[len],coinaddr,slen), len += slen;
     fprintf(stderr,"(%s) func.%d CC.%d %s skipcount.%d len.%d\n",coinaddr,NSPV_CC_TXIDS,CCflag,filtertxid.GetHex().c_str(),skipcount,len);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_mempoolresult.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,NSPV_mempoolresult.coinaddr) == 0 && CCflag == NSPV_mempoolresult.CCflag && filtertxid == NSPV_mempoolresult.txid && vout == NSPV_mempoolresult.vout && funcid == NSPV_mempoolresult.funcid )
-                return(NSPV_mempoolresp_json(&NSPV_mempoolresult));
+            memset(&M,0,sizeof(M));
+            NSPV_rwmempoolresp(0,&req.response[1],&M);
+            if ( M.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,M.coinaddr) == 0 && CCflag == M.CCflag && filtertxid == M.txid && vout == M.vout && funcid == M.funcid )
+            {
+                result = NSPV_mempoolresp_json(&M);
+                NSPV_mempoolresp_purge(&M);
+                return(result);
+            }
+            NSPV_mempoolresp_purge(&M);
         }
     } else sleep(1);
     result.push_back(Pair("result","error"));
@@ -708,7 +1005,7 @@ UniValue NSPV_ccaddresstxids(char *coinaddr,int32_t CCflag,int32_t skipcount,uin
 
 UniValue NSPV_mempooltxids(char *coinaddr,int32_t CCflag,uint8_t funcid,uint256 txid,int32_t vout)
 {
-    UniValue result(UniValue::VOBJ); uint8_t msg[512]; char zeroes[64]; int32_t i,iter,slen,len = 0;
+    UniValue result(UniValue::VOBJ); uint8_t msg[512]; char zeroes[64]; int32_t iter,slen,len = 0; struct NSPV_mempoolresp M; struct NSPV_pending req;
     NSPV_mempoolresp_purge(&NSPV_mempoolresult);
     memset(zeroes,0,sizeof(zeroes));
     if ( coinaddr == 0 )
@@ -729,13 +1026,19 @@ UniValue NSPV_mempooltxids(char *coinaddr,int32_t CCflag,uint8_t funcid,uint256
     memcpy(&msg[len],coinaddr,slen), len += slen;
     fprintf(stderr,"(%s) func.%d CC.%d %s/v%d len.%d\n",coinaddr,funcid,CCflag,txid.GetHex().c_str(),vout,len);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_mempoolresult.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,NSPV_mempoolresult.coinaddr) == 0 && CCflag == NSPV_mempoolresult.CCflag && txid == NSPV_mempoolresult.txid && vout == NSPV_mempoolresult.vout && funcid == NSPV_mempoolresult.funcid )
-                return(NSPV_mempoolresp_json(&NSPV_mempoolresult));
+            memset(&M,0,sizeof(M));
+            NSPV_rwmempoolresp(0,&req.response[1],&M);
+            if ( M.nodeheight >= NSPV_inforesult.height && strcmp(coinaddr,M.coinaddr) == 0 && CCflag == M.CCflag && txid == M.txid && vout == M.vout && funcid == M.funcid )
+            {
+                result = NSPV_mempoolresp_json(&M);
+                NSPV_mempoolresp_purge(&M);
+                return(result);
+            }
+            NSPV_mempoolresp_purge(&M);
         }
     } else sleep(1);
     result.push_back(Pair("result","error"));
@@ -783,116 +1086,161 @@ bool NSPV_evalcode_inmempool(uint8_t evalcode,uint8_t funcid)
     else return(false);
 }
 
-UniValue NSPV_notarizations(int32_t reqheight)
+// the _get variants fill the caller's struct from the cache or from the answer to their own
+// request and return nonzero on success. The rpc wrappers also keep the results in the globals
+
+int32_t NSPV_notarizations_get(int32_t reqheight,struct NSPV_ntzsresp *N)
 {
-    uint8_t msg[512]; int32_t i,iter,len = 0; struct NSPV_ntzsresp N,*ptr;
+    uint8_t msg[512]; int32_t iter,len = 0; struct NSPV_ntzsresp *ptr; struct NSPV_pending req;
+    memset(N,0,sizeof(*N));
     if ( (ptr= NSPV_ntzsresp_find(reqheight)) != 0 )
     {
         fprintf(stderr,"FROM CACHE NSPV_notarizations.%d\n",reqheight);
-        NSPV_ntzsresp_purge(&NSPV_ntzsresult);
-        NSPV_ntzsresp_copy(&NSPV_ntzsresult,ptr);
-        return(NSPV_ntzsresp_json(ptr));
+        NSPV_ntzsresp_copy(N,ptr);
+        return(1);
     }
     msg[len++] = NSPV_NTZS;
     len += iguana_rwnum(1,&msg[len],sizeof(reqheight),&reqheight);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_ntzsresult.reqheight == reqheight )
-                return(NSPV_ntzsresp_json(&NSPV_ntzsresult));
+            NSPV_rwntzsresp(0,&req.response[1],N);
+            if ( N->reqheight == reqheight )
+                return(1);
+            NSPV_ntzsresp_purge(N);
         }
     } else sleep(1);
-    memset(&N,0,sizeof(N));
-    return(NSPV_ntzsresp_json(&N));
+    return(0);
 }
 
-UniValue NSPV_txidhdrsproof(uint256 prevtxid,uint256 nexttxid)
+UniValue NSPV_notarizations(int32_t reqheight)
+{
+    UniValue result; struct NSPV_ntzsresp N;
+    NSPV_notarizations_get(reqheight,&N);
+    result = NSPV_ntzsresp_json(&N);
+    NSPV_ntzsresp_purge(&NSPV_ntzsresult);
+    NSPV_ntzsresult = N;
+    return(result);
+}
+
+int32_t NSPV_txidhdrsproof_get(uint256 prevtxid,uint256 nexttxid,struct NSPV_ntzsproofresp *P)
 {
-    uint8_t msg[512]; int32_t i,iter,len = 0; struct NSPV_ntzsproofresp P,*ptr;
+    uint8_t msg[512]; int32_t iter,len = 0; struct NSPV_ntzsproofresp *ptr; struct NSPV_pending req;
+    memset(P,0,sizeof(*P));
     if ( (ptr= NSPV_ntzsproof_find(prevtxid,nexttxid)) != 0 )
     {
         fprintf(stderr,"FROM CACHE NSPV_txidhdrsproof %s %s\n",ptr->prevtxid.GetHex().c_str(),ptr->nexttxid.GetHex().c_str());
-        NSPV_ntzsproofresp_purge(&NSPV_ntzsproofresult);
-        NSPV_ntzsproofresp_copy(&NSPV_ntzsproofresult,ptr);
-        return(NSPV_ntzsproof_json(ptr));
+        NSPV_ntzsproofresp_copy(P,ptr);
+        return(1);
     }
-    NSPV_ntzsproofresp_purge(&NSPV_ntzsproofresult);
     msg[len++] = NSPV_NTZSPROOF;
     len += iguana_rwbignum(1,&msg[len],sizeof(prevtxid),(uint8_t *)&prevtxid);
     len += iguana_rwbignum(1,&msg[len],sizeof(nexttxid),(uint8_t *)&nexttxid);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_ntzsproofresult.prevtxid == prevtxid && NSPV_ntzsproofresult.nexttxid == nexttxid )
-                return(NSPV_ntzsproof_json(&NSPV_ntzsproofresult));
+            NSPV_rwntzsproofresp(0,&req.response[1],P);
+            if ( P->prevtxid == prevtxid && P->nexttxid == nexttxid )
+                return(1);
+            NSPV_ntzsproofresp_purge(P);
         }
     } else sleep(1);
-    memset(&P,0,sizeof(P));
-    return(NSPV_ntzsproof_json(&P));
+    return(0);
+}
+
+UniValue NSPV_txidhdrsproof(uint256 prevtxid,uint256 nexttxid)
+{
+    UniValue result; struct NSPV_ntzsproofresp P;
+    NSPV_txidhdrsproof_get(prevtxid,nexttxid,&P);
+    result = NSPV_ntzsproof_json(&P);
+    NSPV_ntzsproofresp_purge(&NSPV_ntzsproofresult);
+    NSPV_ntzsproofresult = P;
+    return(result);
 }
 
 UniValue NSPV_hdrsproof(int32_t prevht,int32_t nextht)
 {
-    uint256 prevtxid,nexttxid;
-    NSPV_notarizations(prevht);
-    prevtxid = NSPV_ntzsresult.prevntz.txid;
-    NSPV_notarizations(nextht);
-    nexttxid = NSPV_ntzsresult.nextntz.txid;
+    uint256 prevtxid,nexttxid; struct NSPV_ntzsresp N;
+    NSPV_notarizations_get(prevht,&N);
+    prevtxid = N.prevntz.txid;
+    NSPV_notarizations_get(nextht,&N);
+    nexttxid = N.nextntz.txid;
     return(NSPV_txidhdrsproof(prevtxid,nexttxid));
 }
 
-UniValue NSPV_txproof(int32_t vout,uint256 txid,int32_t height)
+// always asks a peer, never the caches: the unspentvalue in the answer is as fresh as it gets
+int32_t NSPV_txproof_request(int32_t vout,uint256 txid,int32_t height,struct NSPV_txproof *P)
 {
-    uint8_t msg[512]; int32_t i,iter,len = 0; struct NSPV_txproof P,*ptr;
-    if ( (ptr= NSPV_txproof_find(txid)) != 0 )
-    {
-        fprintf(stderr,"FROM CACHE NSPV_txproof %s\n",txid.GetHex().c_str());
-        NSPV_txproof_purge(&NSPV_txproofresult);
-        NSPV_txproof_copy(&NSPV_txproofresult,ptr);
-        return(NSPV_txproof_json(ptr));
-    }
-    NSPV_txproof_purge(&NSPV_txproofresult);
+    uint8_t msg[512]; int32_t iter,len = 0; struct NSPV_pending req;
+    memset(P,0,sizeof(*P));
     msg[len++] = NSPV_TXPROOF;
     len += iguana_rwnum(1,&msg[len],sizeof(height),&height);
     len += iguana_rwnum(1,&msg[len],sizeof(vout),&vout);
     len += iguana_rwbignum(1,&msg[len],sizeof(txid),(uint8_t *)&txid);
     fprintf(stderr,"req txproof %s/v%d at height.%d\n",txid.GetHex().c_str(),vout,height);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_txproofresult.txid == txid )
-                return(NSPV_txproof_json(&NSPV_txproofresult));
+            NSPV_rwtxproof(0,&req.response[1],P);
+            if ( P->txid == txid )
+                return(1);
+            NSPV_txproof_purge(P);
         }
     } else sleep(1);
     fprintf(stderr,"txproof timeout\n");
-    memset(&P,0,sizeof(P));
-    return(NSPV_txproof_json(&P));
+    return(0);
+}
+
+int32_t NSPV_txproof_get(int32_t vout,uint256 txid,int32_t height,struct NSPV_txproof *P)
+{
+    struct NSPV_txproof *ptr;
+    if ( (ptr= NSPV_txproof_find(txid)) != 0 )
+    {
+        fprintf(stderr,"FROM CACHE NSPV_txproof %s\n",txid.GetHex().c_str());
+        memset(P,0,sizeof(*P));
+        NSPV_txproof_copy(P,ptr);
+        return(1);
+    }
+    return(NSPV_txproof_request(vout,txid,height,P));
+}
+
+UniValue NSPV_txproof(int32_t vout,uint256 txid,int32_t height)
+{
+    UniValue result; struct NSPV_txproof P;
+    NSPV_txproof_get(vout,txid,height,&P);
+    result = NSPV_txproof_json(&P);
+    NSPV_txproof_purge(&NSPV_txproofresult);
+    NSPV_txproofresult = P;
+    return(result);
 }
 
 UniValue NSPV_spentinfo(uint256 txid,int32_t vout)
 {
-    uint8_t msg[512]; int32_t i,iter,len = 0; struct NSPV_spentinfo I;
+    UniValue result; uint8_t msg[512]; int32_t iter,len = 0; struct NSPV_spentinfo I; struct NSPV_pending req;
     NSPV_spentinfo_purge(&NSPV_spentresult);
     msg[len++] = NSPV_SPENTINFO;
     len += iguana_rwnum(1,&msg[len],sizeof(vout),&vout);
     len += iguana_rwbignum(1,&msg[len],sizeof(txid),(uint8_t *)&txid);
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_SPENTINDEX,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_SPENTINDEX,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_spentresult.txid == txid && NSPV_spentresult.vout == vout )
-                return(NSPV_spentinfo_json(&NSPV_spentresult));
+            memset(&I,0,sizeof(I));
+            NSPV_rwspentinfo(0,&req.response[1],&I);
+            if ( I.txid == txid && I.vout == vout )
+            {
+                result = NSPV_spentinfo_json(&I);
+                NSPV_spentinfo_purge(&I);
+                return(result);
+            }
+            NSPV_spentinfo_purge(&I);
         }
     } else sleep(1);
     memset(&I,0,sizeof(I));
@@ -901,7 +1249,7 @@ UniValue NSPV_spentinfo(uint256 txid,int32_t vout)
 
 UniValue NSPV_broadcast(char *hex)
 {
-    uint8_t *msg,*data; uint256 txid; int32_t i,n,iter,len = 0; struct NSPV_broadcastresp B;
+    uint8_t *msg,*data; uint256 txid; int32_t n,iter,len = 0; struct NSPV_broadcastresp B; struct NSPV_pending req;
     NSPV_broadcast_purge(&NSPV_broadcastresult);
     n = (int32_t)strlen(hex) >> 1;
     data = (uint8_t *)malloc(n);
@@ -915,15 +1263,16 @@ UniValue NSPV_broadcast(char *hex)
     free(data);
     //fprintf(stderr,"send txid.%s\n",txid.GetHex().c_str());
     for (iter=0; iter<3; iter++)
-    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1) != 0 )
+    if ( NSPV_req(0,msg,len,NODE_NSPV,msg[0]>>1,&req) != 0 )
     {
-        for (i=0; i<NSPV_POLLITERS; i++)
+        if ( NSPV_pending_wait(&req,NSPV_REQTIMEOUT) != 0 )
         {
-            usleep(NSPV_POLLMICROS);
-            if ( NSPV_broadcastresult.txid == txid )
+            memset(&B,0,sizeof(B));
+            NSPV_rwbroadcastresp(0,&req.response[1],&B);
+            if ( B.txid == txid )
             {
                 free(msg);
-                return(NSPV_broadcast_json(&NSPV_broadcastresult,txid));
+                return(NSPV_broadcast_json(&B,txid));
             }
         }
     } else sleep(1);
@@ -939,8 +1288,8 @@ UniValue NSPV_broadcast(char *hex)
 // For second+ funcids the filtertxid will be compared to txid in opret
 UniValue NSPV_ccmoduleutxos(char *coinaddr, int64_t amount, uint8_t evalcode, std::string funcids, uint256 filtertxid)
 {
-    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t i, iter, slen, len = 0;
-    uint8_t CCflag = 1;
+    UniValue result(UniValue::VOBJ); uint8_t msg[512]; int32_t iter, slen, len = 0;
+    uint8_t CCflag = 1; struct NSPV_utxosresp U; struct NSPV_pending req;
 
     NSPV_utxosresp_purge(&NSPV_utxosresult);
     if (bitcoin_base58decode(msg, coinaddr) != 25)
@@ -964,13 +1313,19 @@ UniValue NSPV_ccmoduleutxos(char *coinaddr, int64_t amount, uint8_t evalcode, st
 
     len += iguana_rwbignum(1, &msg[len], sizeof(filtertxid), (uint8_t *)&filtertxid);
     for (iter = 0; iter<3; iter++)
-        if (NSPV_req(0, msg, len, NODE_ADDRINDEX, msg[0] >> 1) != 0)
+        if (NSPV_req(0, msg, len, NODE_ADDRINDEX, msg[0] >> 1, &req) != 0)
         {
-            for (i = 0; i<NSPV_POLLITERS; i++)
+            if (NSPV_pending_wait(&req, NSPV_REQTIMEOUT) != 0)
             {
-                usleep(NSPV_POLLMICROS);
-                if ((NSPV_inforesult.height == 0 || NSPV_utxosresult.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr, NSPV_utxosresult.coinaddr) == 0 && CCflag == NSPV_utxosresult.CCflag)
-                    return(NSPV_utxosresp_json(&NSPV_utxosresult));
+                memset(&U, 0, sizeof(U));
+                NSPV_rwutxosresp(0, &req.response[1], &U);
+                if ((NSPV_inforesult.height == 0 || U.nodeheight >= NSPV_inforesult.height) && strcmp(coinaddr, U.coinaddr) == 0 && CCflag == U.CCflag)
+                {
+                    result = NSPV_utxosresp_json(&U);
+                    NSPV_utxosresp_purge(&U);
+                    return(result);
+                }
+                NSPV_utxosresp_purge(&U);
             }
         }
         else sleep(1);
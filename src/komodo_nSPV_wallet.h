@@ -60,28 +60,43 @@ int32_t NSPV_validatehdrs(struct NSPV_ntzsproofresp *ptr)
 
 int32_t NSPV_gettransaction(int32_t skipvalidation,int32_t vout,uint256 txid,int32_t height,CTransaction &tx,uint256 &hashblock,int32_t &txheight,int32_t &currentheight,int64_t extradata,uint32_t tiptime,int64_t &rewardsum)
 {
-    struct NSPV_txproof *ptr; int32_t i,offset,retval; int64_t rewards = 0; uint32_t nLockTime; std::vector<uint8_t> proof;
-    retval = skipvalidation != 0 ? 0 : -1;
+    struct NSPV_txproof P,U; struct NSPV_ntzsresp N; struct NSPV_ntzsproofresp H; int32_t i,offset,retval,stored = 0; int64_t rewards = 0,unspentvalue = 0; uint32_t nLockTime; std::vector<uint8_t> proof;
 
     //fprintf(stderr,"NSPV_gettx %s/v%d ht.%d\n",txid.GetHex().c_str(),vout,height);
-    if ( (ptr= NSPV_txproof_find(txid)) == 0 )
+    memset(&H,0,sizeof(H));
+    if ( NSPV_txproof_find(txid) == 0 )
     {
-        NSPV_txproof(vout,txid,height);
-        ptr = &NSPV_txproofresult;
+        NSPV_txproof_request(vout,txid,height,&P);
+        unspentvalue = P.unspentvalue;
     }
-    hashblock=ptr->hashblock;
-    txheight=ptr->height;
+    else
+    {
+        NSPV_txproof_get(vout,txid,height,&P);
+        if ( skipvalidation == 0 )
+        {
+            if ( NSPV_store_hastxproof(txid) )
+                stored = 1; // its proof was checked against notarized headers before it was stored
+            // a cached proof says nothing about whether the output is still unspent, so ask again
+            if ( NSPV_txproof_request(vout,txid,height,&U) != 0 )
+                unspentvalue = U.unspentvalue;
+            NSPV_txproof_purge(&U);
+        }
+    }
+    retval = (skipvalidation != 0 || stored != 0) ? 0 : -1;
+    hashblock=P.hashblock;
+    txheight=P.height;
     currentheight=NSPV_inforesult.height;
-    if ( ptr->txid != txid )
+    if ( P.txid != txid )
     {
-        fprintf(stderr,"txproof error %s != %s\n",ptr->txid.GetHex().c_str(),txid.GetHex().c_str());
+        fprintf(stderr,"txproof error %s != %s\n",P.txid.GetHex().c_str(),txid.GetHex().c_str());
+        NSPV_txproof_purge(&P);
         return(-1);
     }
-    else if ( NSPV_txextract(tx,ptr->tx,ptr->txlen) < 0 || ptr->txlen <= 0 )
+    else if ( NSPV_txextract(tx,P.tx,P.txlen) < 0 || P.txlen <= 0 )
         retval = -2000;
     else if ( tx.GetHash() != txid )
         retval = -2001;
-    else if ( skipvalidation == 0 && ptr->unspentvalue <= 0 )
+    else if ( skipvalidation == 0 && unspentvalue <= 0 )
         retval = -2002;
     else if ( ASSETCHAINS_SYMBOL[0] == 0 && tiptime != 0 )
     {
@@ -94,44 +109,51 @@ int32_t NSPV_gettransaction(int32_t skipvalidation,int32_t vout,uint256 txid,int
     //Getscriptaddress(coinaddr,tx.vout[0].scriptPubKey);  causes crash??
     //fprintf(stderr,"%s txid.%s vs hash.%s\n",coinaddr,txid.GetHex().c_str(),tx.GetHash().GetHex().c_str());
     
-    if ( skipvalidation == 0 )
+    if ( skipvalidation == 0 && stored == 0 )
     {
-        if ( ptr->txprooflen > 0 )
+        if ( P.txprooflen > 0 )
         {
-            proof.resize(ptr->txprooflen);
-            memcpy(&proof[0],ptr->txproof,ptr->txprooflen);
+            proof.resize(P.txprooflen);
+            memcpy(&proof[0],P.txproof,P.txprooflen);
         }
-        NSPV_notarizations(height); // gets the prev and next notarizations
-        if ( NSPV_inforesult.notarization.height >= height && (NSPV_ntzsresult.prevntz.height == 0 || NSPV_ntzsresult.prevntz.height >= NSPV_ntzsresult.nextntz.height) )
+        NSPV_notarizations_get(height,&N); // gets the prev and next notarizations
+        if ( NSPV_inforesult.notarization.height >= height && (N.prevntz.height == 0 || N.prevntz.height >= N.nextntz.height) )
         {
             fprintf(stderr,"issue manual bracket\n");
-            NSPV_notarizations(height-1);
-            NSPV_notarizations(height+1);
-            NSPV_notarizations(height); // gets the prev and next notarizations
+            NSPV_notarizations_get(height-1,&N);
+            NSPV_notarizations_get(height+1,&N);
+            NSPV_notarizations_get(height,&N); // gets the prev and next notarizations
         }
-        if ( NSPV_ntzsresult.prevntz.height != 0 && NSPV_ntzsresult.prevntz.height <= NSPV_ntzsresult.nextntz.height )
+        if ( N.prevntz.height != 0 && N.prevntz.height <= N.nextntz.height )
         {
-            fprintf(stderr,">>>>> gettx ht.%d prev.%d next.%d\n",height,NSPV_ntzsresult.prevntz.height, NSPV_ntzsresult.nextntz.height);
-            offset = (height - NSPV_ntzsresult.prevntz.height);
-            if ( offset >= 0 && height <= NSPV_ntzsresult.nextntz.height )
+            fprintf(stderr,">>>>> gettx ht.%d prev.%d next.%d\n",height,N.prevntz.height, N.nextntz.height);
+            offset = (height - N.prevntz.height);
+            if ( offset >= 0 && height <= N.nextntz.height )
             {
-                //fprintf(stderr,"call NSPV_txidhdrsproof %s %s\n",NSPV_ntzsresult.prevntz.txid.GetHex().c_str(),NSPV_ntzsresult.nextntz.txid.GetHex().c_str());
-                NSPV_txidhdrsproof(NSPV_ntzsresult.prevntz.txid,NSPV_ntzsresult.nextntz.txid);
-                usleep(10000);
-                if ( (retval= NSPV_validatehdrs(&NSPV_ntzsproofresult)) == 0 )
+                //fprintf(stderr,"call NSPV_txidhdrsproof %s %s\n",N.prevntz.txid.GetHex().c_str(),N.nextntz.txid.GetHex().c_str());
+                NSPV_txidhdrsproof_get(N.prevntz.txid,N.nextntz.txid,&H);
+                if ( (retval= NSPV_validatehdrs(&H)) == 0 )
                 {
                     std::vector<uint256> txids; uint256 proofroot;
                     proofroot = BitcoinGetProofMerkleRoot(proof,txids);
-                    if ( proofroot != NSPV_ntzsproofresult.common.hdrs[offset].hashMerkleRoot || txids[0] != txid )
+                    if ( proofroot != H.common.hdrs[offset].hashMerkleRoot || txids[0] != txid )
                     {
                         fprintf(stderr,"txid.%s vs txids[0] %s\n",txid.GetHex().c_str(),txids[0].GetHex().c_str());
-                        fprintf(stderr,"prooflen.%d proofroot.%s vs %s\n",(int32_t)proof.size(),proofroot.GetHex().c_str(),NSPV_ntzsproofresult.common.hdrs[offset].hashMerkleRoot.GetHex().c_str());
+                        fprintf(stderr,"prooflen.%d proofroot.%s vs %s\n",(int32_t)proof.size(),proofroot.GetHex().c_str(),H.common.hdrs[offset].hashMerkleRoot.GetHex().c_str());
                         retval = -2003;
-                    } else retval = 0;
+                    }
+                    else
+                    {
+                        NSPV_store_putntzsproof(&H);
+                        NSPV_store_puttxproof(&P);
+                        retval = 0;
+                    }
                 }
             } else retval = -2005;
         } else retval = -2004;
     }
+    NSPV_ntzsproofresp_purge(&H);
+    NSPV_txproof_purge(&P);
     return(retval);
 }
 
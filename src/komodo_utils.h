@@ -18,6 +18,7 @@
 #include "komodo_defs.h"
 #include "key_io.h"
 #include "cc/CCinclude.h"
+#include "crypto/sha256.h"
 #include <string.h>
 
 #ifdef _WIN32
@@ -282,10 +283,8 @@ static inline int32_t sha256_vdone(struct sha256_vstate *md,uint8_t *out)
 
 void vcalc_sha256(char deprecated[(256 >> 3) * 2 + 1],uint8_t hash[256 >> 3],uint8_t *src,int32_t len)
 {
-    struct sha256_vstate md;
-    sha256_vinit(&md);
-    sha256_vprocess(&md,src,len);
-    sha256_vdone(&md,hash);
+    // same digest as the portable sha256_v* code, through the CPU-dispatched transform
+    CSHA256().Write(src,len).Finalize(hash);
 }
 
 bits256 bits256_doublesha256(char *deprecated,uint8_t *data,int32_t datalen)
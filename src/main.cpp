@@ -37,6 +37,8 @@
 #include "merkleblock.h"
 #include "metrics.h"
 #include "notarisationdb.h"
+#include "cc/CCindex.h"
+#include "cc/CCstats.h"
 #include "net.h"
 #include "pow.h"
 #include "script/interpreter.h"
@@ -642,6 +644,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 // Komodo globals
@@ -651,7 +654,7 @@ CBlockTreeDB *pblocktree = NULL;
 
 UniValue komodo_snapshot(int top)
 {
-    LOCK(cs_main);
+    // the address index is read through a LevelDB iterator, cs_main is only taken to open it
     int64_t total = -1;
     UniValue result(UniValue::VOBJ);
 
@@ -667,7 +670,7 @@ UniValue komodo_snapshot(int top)
     return(result);
 }
 
-bool komodo_snapshot2(std::map <std::string, CAmount> &addressAmounts)
+bool komodo_snapshot2(std::map <CTxDestination, CAmount> &addressAmounts)
 {
     if ( fAddressIndex && pblocktree != 0 ) 
     {
@@ -676,6 +679,80 @@ bool komodo_snapshot2(std::map <std::string, CAmount> &addressAmounts)
     else return false;
 }
 
+static CAddressBalanceDelta komodo_balancedelta(const CTxDestination &dest, CAmount nValue, bool fRestore)
+{
+    if ( const CScriptID *scriptID = boost::get<CScriptID>(&dest) )
+        return CAddressBalanceDelta(2, *scriptID, nValue, fRestore);
+    else if ( const CPubKey *pubkey = boost::get<CPubKey>(&dest) )
+        return CAddressBalanceDelta(1, pubkey->GetID(), nValue, fRestore);
+    return CAddressBalanceDelta(1, boost::get<CKeyID>(dest), nValue, fRestore);
+}
+
+// Snapshot undo steps for a block: transactions in reverse order, for each
+// its vouts taken away and then its spent prevouts given back, both reversed.
+// Prevouts come from the block undo data when given, else from the tx index.
+void komodo_snapshotdeltas(const CBlock &block, const CBlockUndo *blockundo, std::vector<CAddressBalanceDelta> &vDeltas)
+{
+    CTxDestination vDest;
+    for (int32_t i = block.vtx.size() - 1; i >= 0; i--) 
+    {
+        const CTransaction &tx = block.vtx[i];
+        for (unsigned int k = tx.vout.size(); k-- > 0;) 
+        {
+            const CTxOut &out = tx.vout[k];
+            if ( ExtractDestination(out.scriptPubKey, vDest) )
+                vDeltas.push_back(komodo_balancedelta(vDest, out.nValue, false));
+        }
+        if ( tx.IsCoinImport() || tx.IsCoinBase() )
+            continue;
+        // UpdateCoins leaves the pegs burn vin out of the undo data
+        std::vector<int32_t> undopos(tx.vin.size(),-1); int32_t numundo = 0;
+        for (unsigned int j = 0; j < tx.vin.size(); j++)
+            if ( !tx.IsPegsImport() || tx.vin[j].prevout.n != 10e8 )
+                undopos[j] = numundo++;
+        const CTxUndo *txundo = 0;
+        if ( blockundo != 0 && i > 0 && i-1 < (int32_t)blockundo->vtxundo.size() && blockundo->vtxundo[i-1].vprevout.size() == (size_t)numundo )
+            txundo = &blockundo->vtxundo[i-1];
+        for (unsigned int j = tx.vin.size(); j-- > 0;) 
+        {
+            if ( tx.IsPegsImport() && j == 0 )
+                continue;
+            CTxOut prevout;
+            if ( txundo != 0 && undopos[j] >= 0 )
+                prevout = txundo->vprevout[undopos[j]].txout;
+            else
+            {
+                uint256 blockhash; CTransaction txin;
+                if ( !myGetTransaction(tx.vin[j].prevout.hash,txin,blockhash) || tx.vin[j].prevout.n >= txin.vout.size() )
+                    continue;
+                prevout = txin.vout[tx.vin[j].prevout.n];
+            }
+            if ( ExtractDestination(prevout.scriptPubKey, vDest) )
+                vDeltas.push_back(komodo_balancedelta(vDest, prevout.nValue, true));
+        }
+    }
+}
+
+void komodo_snapshotundo(std::map <CTxDestination, CAmount> &addressAmounts, const std::vector<CAddressBalanceDelta> &vDeltas)
+{
+    for (std::vector<CAddressBalanceDelta>::const_iterator it = vDeltas.begin(); it != vDeltas.end(); ++it)
+    {
+        CTxDestination vDest;
+        if ( it->type == 2 )
+            vDest = CScriptID(it->hashBytes);
+        else vDest = CKeyID(it->hashBytes);
+        if ( it->fRestore )
+            addressAmounts[vDest] += it->nValue;
+        else
+        {
+            CAmount &nBalance = addressAmounts[vDest];
+            nBalance -= it->nValue;
+            if ( nBalance < 1 )
+                addressAmounts.erase(vDest);
+        }
+    }
+}
+
 int32_t lastSnapShotHeight = 0;
 std::vector <std::pair<CAmount, CTxDestination>> vAddressSnapshot;
 
@@ -708,55 +785,52 @@ bool komodo_dailysnapshot(int32_t height)
     // if we already did this height dont bother doing it again, this is just a reorg. The actual snapshot height cannot be reorged.
     if ( undo_height == lastSnapShotHeight )
         return true;
-    std::map <std::string, int64_t> addressAmounts;
-    if ( !komodo_snapshot2(addressAmounts) )
+    std::map <CTxDestination, CAmount> addressAmounts; std::vector<CAddressBalanceDelta> vDeltas; int32_t tableheight = -1;
+    if ( !fAddressIndex || pblocktree == 0 )
         return false;
-
-    // undo blocks in reverse order
-    for (int32_t n = height; n > undo_height; n--) 
+    if ( !pblocktree->ReadAddressBalanceHeight(tableheight) && height == chainActive.Height() )
+    {
+        // first snapshot since the table was lost or never kept, build it from the unspent index once
+        if ( !pblocktree->BuildAddressBalanceIndex(height) )
+            return false;
+        tableheight = height;
+    }
+    // the table matches the tip, so the snapshot is the table with the undo steps of the blocks above undo_height replayed
+    std::vector<std::vector<CAddressBalanceDelta> > vBlockDeltas;
+    bool fDeltas = (tableheight == height);
+    for (int32_t n = height; fDeltas && n > undo_height; n--)
+    {
+        vBlockDeltas.push_back(std::vector<CAddressBalanceDelta>());
+        fDeltas = pblocktree->ReadAddressBalanceDeltas(n, vBlockDeltas.back());
+    }
+    if ( fDeltas )
     {
-        //fprintf(stderr, "undoing block.%i\n",n);
-        CBlockIndex *pindex; CBlock block;
-        if ( (pindex= komodo_chainactive(n)) == 0 || komodo_blockload(block, pindex) != 0 ) 
+        if ( !pblocktree->AddressBalanceSnapshot(addressAmounts) )
             return false;
-        // undo transactions in reverse order
-        for (int32_t i = block.vtx.size() - 1; i >= 0; i--) 
+        for (size_t n = 0; n < vBlockDeltas.size(); n++)
+            komodo_snapshotundo(addressAmounts, vBlockDeltas[n]);
+    }
+    else
+    {
+        fprintf(stderr, "address balances at height.%i have no undo back to height.%i, scanning the address index\n", tableheight, undo_height);
+        if ( !komodo_snapshot2(addressAmounts) )
+            return false;
+        // undo blocks in reverse order
+        for (int32_t n = height; n > undo_height; n--) 
         {
-            const CTransaction &tx = block.vtx[i];
-            CTxDestination vDest; 
-            // loop vouts reverse order, remove value recieved.
-            for (unsigned int k = tx.vout.size(); k-- > 0;) 
-            {
-                const CTxOut &out = tx.vout[k];
-                if ( ExtractDestination(out.scriptPubKey, vDest) )
-                {
-                    addressAmounts[CBitcoinAddress(vDest).ToString()] -= out.nValue;
-                    if ( addressAmounts[CBitcoinAddress(vDest).ToString()] < 1 )
-                        addressAmounts.erase(CBitcoinAddress(vDest).ToString());
-                    //fprintf(stderr, "VOUT: address.%s remove_coins.%li\n",CBitcoinAddress(vDest).ToString().c_str(), out.nValue);
-                } 
-            }
-            // loop vins in reverse order, get prevout and return the sent balance.
-            for (unsigned int j = tx.vin.size(); j-- > 0;) 
-            {
-                uint256 blockhash; CTransaction txin;
-                if (tx.IsPegsImport() && j==0) continue;
-                if ( !tx.IsCoinImport() && !tx.IsCoinBase() && myGetTransaction(tx.vin[j].prevout.hash,txin,blockhash) ) 
-                {
-                    int vout = tx.vin[j].prevout.n;
-                    if ( ExtractDestination(txin.vout[vout].scriptPubKey, vDest) )
-                    {
-                        //fprintf(stderr, "VIN: address.%s add_coins.%li\n",CBitcoinAddress(vDest).ToString().c_str(), txin.vout[vout].nValue);
-                        addressAmounts[CBitcoinAddress(vDest).ToString()] += txin.vout[vout].nValue;
-                    }
-                }
-            }
+            //fprintf(stderr, "undoing block.%i\n",n);
+            CBlockIndex *pindex; CBlock block;
+            if ( (pindex= komodo_chainactive(n)) == 0 || komodo_blockload(block, pindex) != 0 ) 
+                return false;
+            vDeltas.clear();
+            komodo_snapshotdeltas(block, 0, vDeltas);
+            komodo_snapshotundo(addressAmounts, vDeltas);
         }
     }
     vAddressSnapshot.clear(); // clear existing snapshot
-    // convert address string to destination for easier conversion to what ever is required, eg, scriptPubKey. 
+    vAddressSnapshot.reserve(addressAmounts.size());
     for ( auto element : addressAmounts)
-        vAddressSnapshot.push_back(make_pair(element.second, DecodeDestination(element.first)));
+        vAddressSnapshot.push_back(make_pair(element.second, element.first));
     // sort the vector by amount, highest at top.
     std::sort(vAddressSnapshot.rbegin(), vAddressSnapshot.rend());
     //for (int j = 0; j < 50; j++) 
@@ -1185,7 +1259,8 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
         CValidationState &state,
         const int nHeight,
         const int dosLevel,
-        bool (*isInitBlockDownload)(),int32_t validateprices)
+        bool (*isInitBlockDownload)(),int32_t validateprices,
+        std::vector<CScriptCheck> *pvChecks)
 {
     bool overwinterActive = NetworkUpgradeActive(nHeight, Params().GetConsensus(), Consensus::UPGRADE_OVERWINTER);
     bool saplingActive = NetworkUpgradeActive(nHeight, Params().GetConsensus(), Consensus::UPGRADE_SAPLING);
@@ -1329,55 +1404,68 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
+        if (pvChecks != NULL) {
+            pvChecks->push_back(CScriptCheck(tx, dataToBeSigned));
+        } else {
+            std::string strRejectReason;
+            if (!CheckSaplingProofs(tx, dataToBeSigned, strRejectReason))
+                return state.DoS(100, error("ContextualCheckTransaction(): %s", strRejectReason),
+                                      REJECT_INVALID, strRejectReason);
         }
+    }
+    return true;
+}
 
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cm.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
+bool CheckSaplingProofs(const CTransaction& tx, const uint256& dataToBeSigned, std::string& strRejectReason)
+{
+    auto ctx = librustzcash_sapling_verification_ctx_init();
 
-        if (!librustzcash_sapling_final_check(
+    for (const SpendDescription &spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
             ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
+            spend.cv.begin(),
+            spend.anchor.begin(),
+            spend.nullifier.begin(),
+            spend.rk.begin(),
+            spend.zkproof.begin(),
+            spend.spendAuthSig.begin(),
             dataToBeSigned.begin()
         ))
         {
             librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+            strRejectReason = "bad-txns-sapling-spend-description-invalid";
+            return false;
         }
+    }
 
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+            ctx,
+            output.cv.begin(),
+            output.cm.begin(),
+            output.ephemeralKey.begin(),
+            output.zkproof.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            strRejectReason = "bad-txns-sapling-output-description-invalid";
+            return false;
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+        ctx,
+        tx.valueBalance,
+        tx.bindingSig.begin(),
+        dataToBeSigned.begin()
+    ))
+    {
         librustzcash_sapling_verification_ctx_free(ctx);
+        strRejectReason = "bad-txns-sapling-binding-signature-invalid";
+        return false;
     }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
     return true;
 }
 
@@ -2102,6 +2190,9 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
             LOCK(pool.cs);
             // Store transaction in memory
             pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
+            // CreateNewBlock can reuse the input checks above
+            if (chainActive.LastTip() != 0)
+                pool.SetInputsChecked(hash, CMempoolInputsCheck(chainActive.LastTip()->GetBlockHash(), consensusBranchId, InputsCheckDependsOnTip(tx, view)));
             if (!tx.IsCoinImport())
             {
                 // Add memory address index
@@ -2224,6 +2315,7 @@ bool myAddtomempool(CTransaction &tx, CValidationState *pstate, bool fSkipExpiry
 
 bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock)
 {
+    CCValidationTimer::CountGetTransaction();
     memset(&hashBlock,0,sizeof(hashBlock));
     if ( KOMODO_NSPV_SUPERLITE )
     {
@@ -2769,6 +2861,18 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 }
 
 bool CScriptCheck::operator()() {
+    if (type == CHECK_SAPLING) {
+        std::string strRejectReason;
+        if (!CheckSaplingProofs(*ptxTo, dataToBeSigned, strRejectReason))
+            return ::error("CScriptCheck(): %s %s", ptxTo->GetHash().ToString(), strRejectReason);
+        return true;
+    }
+    if (type == CHECK_JOINSPLIT) {
+        auto verifier = libzcash::ProofVerifier::Strict();
+        if (!ptxTo->vjoinsplit[nIn].Verify(*pzcashParams, verifier, ptxTo->joinSplitPubKey))
+            return ::error("CScriptCheck(): %s:%d joinsplit does not verify", ptxTo->GetHash().ToString(), nIn);
+        return true;
+    }
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     ServerTransactionSignatureChecker checker(ptxTo, nIn, amount, cacheStore, *txdata);
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, checker, consensusBranchId, &error)) {
@@ -2963,6 +3067,26 @@ bool ContextualCheckInputs(
 }
 
 
+bool InputsCheckDependsOnTip(const CTransaction& tx, const CCoinsViewCache &view)
+{
+    if (ASSETCHAINS_SYMBOL[0] == 0 || tx.IsCoinImport() || tx.IsPegsImport())
+        return true;
+    BOOST_FOREACH(const CTxOut& txout, tx.vout)
+    {
+        if (txout.scriptPubKey.IsPayToCryptoCondition())
+            return true;
+    }
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+    {
+        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+        if (coins == NULL || coins->IsCoinBase() || !coins->IsAvailable(txin.prevout.n))
+            return true;
+        if (coins->vout[txin.prevout.n].scriptPubKey.IsPayToCryptoCondition())
+            return true;
+    }
+    return false;
+}
+
 /*bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, const Consensus::Params& consensusParams, std::vector<CScriptCheck> *pvChecks)
  {
  if (!NonContextualCheckInputs(tx, state, inputs, fScriptChecks, flags, cacheStore, consensusParams, pvChecks)) {
@@ -3312,6 +3436,11 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
+        if (ASSETCHAINS_CC != 0 && KOMODO_SNAPSHOT_INTERVAL != 0) {
+            if (!pblocktree->UpdateAddressBalanceIndex(pindex->GetHeight(), addressIndex, std::vector<CAddressBalanceDelta>(), true, 0)) {
+                return AbortNode(state, "Failed to write address balance index");
+            }
+        }
     }
 
     return fClean;
@@ -3446,8 +3575,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int32_t futureblock;
     CAmount blockReward = GetBlockSubsidy(pindex->GetHeight(), chainparams.GetConsensus());
     uint64_t notarypaycheque = 0;
+    // With script check threads the JoinSplit proofs are queued alongside the
+    // scripts below instead of being verified serially by CheckBlock
+    bool fParallelProofs = fExpensiveChecks && nScriptCheckThreads;
     // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
-    if ( !CheckBlock(&futureblock,pindex->GetHeight(),pindex,block, state, fExpensiveChecks ? verifier : disabledVerifier, fCheckPOW, !fJustCheck) || futureblock != 0 )
+    if ( !CheckBlock(&futureblock,pindex->GetHeight(),pindex,block, state, fExpensiveChecks && !fParallelProofs ? verifier : disabledVerifier, fCheckPOW, !fJustCheck) || futureblock != 0 )
     {
         //fprintf(stderr,"checkblock failure in connectblock futureblock.%d\n",futureblock);
         return false;
@@ -3468,7 +3600,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     {
         // do a full block scan to get notarisation position and to enforce a valid notarization is in position 1.
         // if notarisation in the block, must be position 1 and the coinbase must pay notaries.
-        int32_t notarisationTx = komodo_connectblock(true,pindex,*(CBlock *)&block);  
+        int32_t notarisationTx = komodo_connectblock(true,pindex,*(CBlock *)&block,&view,0);
         // -1 means that the valid notarization isnt in position 1 or there are too many notarizations in this block.
         if ( notarisationTx == -1 )
             return state.DoS(100, error("ConnectBlock(): Notarization is not in TX position 1 or block contains more than 1 notarization! Invalid Block!"),
@@ -3695,6 +3827,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 return false;
             control.Add(vChecks);
         }
+        if (fParallelProofs && !tx.vjoinsplit.empty())
+        {
+            std::vector<CScriptCheck> vChecks;
+            for (unsigned int js = 0; js < tx.vjoinsplit.size(); js++)
+                vChecks.push_back(CScriptCheck(tx, js));
+            control.Add(vChecks);
+        }
 
         if (fAddressIndex) {
             for (unsigned int k = 0; k < tx.vout.size(); k++) {
@@ -3841,6 +3980,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     }
 
     ConnectNotarisations(block, pindex->GetHeight()); // MoMoM notarisation DB.
+    ConnectCCIndexes(block, pindex->GetHeight());
 
     if (fTxIndex)
         if (!pblocktree->WriteTxIndex(vPos))
@@ -3853,6 +3993,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
+
+        int tableheight;
+        if (ASSETCHAINS_CC != 0 && KOMODO_SNAPSHOT_INTERVAL != 0 && pblocktree->ReadAddressBalanceHeight(tableheight)) {
+            // keep the undo steps of the last two snapshot intervals, enough to reach any notarized undo height
+            std::vector<CAddressBalanceDelta> vDeltas;
+            komodo_snapshotdeltas(block, &blockundo, vDeltas);
+            if (!pblocktree->UpdateAddressBalanceIndex(pindex->GetHeight(), addressIndex, vDeltas, false, 2*KOMODO_SNAPSHOT_INTERVAL + 100)) {
+                return AbortNode(state, "Failed to write address balance index");
+            }
+        }
     }
 
     if (fSpentIndex)
@@ -3896,7 +4046,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
 
     //FlushStateToDisk();
-    komodo_connectblock(false,pindex,*(CBlock *)&block);  // dPoW state update.
+    komodo_connectblock(false,pindex,*(CBlock *)&block,&view,&blockundo);  // dPoW state update.
     if ( ASSETCHAINS_NOTARY_PAY[0] != 0 )
     {
       // Update the notary pay with the latest payment.
@@ -3982,6 +4132,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
+                if (!pblocktree->Sync()) {
+                    return AbortNode(state, "Failed to sync index databases");
+                }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
@@ -4115,6 +4268,7 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
         DisconnectNotarisations(block);
+        DisconnectCCIndexes(block, pindexDelete->GetHeight());
     }
     pindexDelete->segid = -2;
     pindexDelete->nNotaryPay = 0; 
@@ -5427,14 +5581,21 @@ bool ContextualCheckBlock(int32_t slowflag,const CBlock& block, CValidationState
     const Consensus::Params& consensusParams = Params().GetConsensus();
     bool sapling = NetworkUpgradeActive(nHeight, consensusParams, Consensus::UPGRADE_SAPLING);
 
+    // Sapling proofs are verified by the script check threads while the
+    // remaining contextual checks run here
+    bool fParallelProofs = nScriptCheckThreads && scriptcheckqueue.IsIdle();
+    CCheckQueueControl<CScriptCheck> control(fParallelProofs ? &scriptcheckqueue : NULL);
+
     // Check that all transactions are finalized
     for (uint32_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
 
         // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(slowflag,&block,pindexPrev,tx, state, nHeight, 100)) {
+        std::vector<CScriptCheck> vChecks;
+        if (!ContextualCheckTransaction(slowflag,&block,pindexPrev,tx, state, nHeight, 100, IsInitialBlockDownload, 1, fParallelProofs ? &vChecks : NULL)) {
             return false; // Failure reason has been set in validation state object
         }
+        control.Add(vChecks);
 
         int nLockTimeFlags = 0;
         int64_t nLockTimeCutoff = (nLockTimeFlags & LOCKTIME_MEDIAN_TIME_PAST)
@@ -5457,6 +5618,8 @@ bool ContextualCheckBlock(int32_t slowflag,const CBlock& block, CValidationState
             return state.DoS(100, error("%s: block height mismatch in coinbase", __func__), REJECT_INVALID, "bad-cb-height");
         }
     }
+    if (!control.Wait())
+        return state.DoS(100, error("%s: Sapling proof verification failed", __func__), REJECT_INVALID, "bad-txns-sapling-proof-invalid");
     return true;
 }
 
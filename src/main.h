@@ -57,6 +57,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CCoinsViewDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
@@ -149,6 +150,9 @@ typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
+extern int64_t nLastTemplateBuildTime;
+extern uint64_t nLastTemplateChecked;
+extern uint64_t nLastTemplateReused;
 extern const std::string strMessageMagic;
 extern CWaitableCriticalSection csBestBlock;
 extern CConditionVariable cvBlockChange;
@@ -632,6 +636,54 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** One step of the daily snapshot undo for a block: a vout taken away from
+ *  its destination, or a spent prevout given back. Stored per block, in the
+ *  order komodo_dailysnapshot replays them. */
+struct CAddressBalanceDelta {
+    unsigned int type;
+    uint160 hashBytes;
+    CAmount nValue;
+    bool fRestore;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 30;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata64(s, nValue);
+        char f = fRestore;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        nValue = ser_readdata64(s);
+        char f = ser_readdata8(s);
+        fRestore = f;
+    }
+
+    CAddressBalanceDelta(unsigned int addressType, uint160 addressHash, CAmount amount, bool isRestore) {
+        type = addressType;
+        hashBytes = addressHash;
+        nValue = amount;
+        fRestore = isRestore;
+    }
+
+    CAddressBalanceDelta() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        nValue = 0;
+        fRestore = false;
+    }
+};
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -705,9 +757,21 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
                            const Consensus::Params& consensusParams, uint32_t consensusBranchId,
                            std::vector<CScriptCheck> *pvChecks = NULL);
 
-/** Check a transaction contextually against a set of consensus rules */
+/**
+ * Whether the result of ContextualCheckInputs for tx depends on the chain tip
+ * and not only on the outputs it spends: CC scripts, coinbase spends and KMD
+ * interest. view must still hold the spent coins.
+ */
+bool InputsCheckDependsOnTip(const CTransaction& tx, const CCoinsViewCache &view);
+
+/** Check a transaction contextually against a set of consensus rules.
+ * If pvChecks is not NULL, the Sapling proof checks are appended to it instead of being run inline. */
 bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockIndex * const pindexPrev,const CTransaction& tx, CValidationState &state, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)() = IsInitialBlockDownload,int32_t validateprices=1);
+                                bool (*isInitBlockDownload)() = IsInitialBlockDownload,int32_t validateprices=1,
+                                std::vector<CScriptCheck> *pvChecks = NULL);
+
+/** Verify the Sapling spends, outputs and binding signature of tx; on failure strRejectReason is set */
+bool CheckSaplingProofs(const CTransaction& tx, const uint256& dataToBeSigned, std::string& strRejectReason);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -761,7 +825,12 @@ bool CheckFinalTx(const CTransaction &tx, int flags = -1);
  */
 class CScriptCheck
 {
+public:
+    //! Besides scripts, the queue also carries the shielded proof checks of a block
+    enum CheckType { CHECK_SCRIPT, CHECK_SAPLING, CHECK_JOINSPLIT };
+
 private:
+    CheckType type;
     CScript scriptPubKey;
     CAmount amount;
     const CTransaction *ptxTo;
@@ -771,16 +840,25 @@ private:
     uint32_t consensusBranchId;
     ScriptError error;
     PrecomputedTransactionData *txdata;
+    uint256 dataToBeSigned;
 
 public:
-    CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
+    CScriptCheck(): type(CHECK_SCRIPT), amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(0) {}
     CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, uint32_t consensusBranchIdIn, PrecomputedTransactionData* txdataIn) :
-        scriptPubKey(CCoinsViewCache::GetSpendFor(&txFromIn, txToIn.vin[nInIn])), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
+        type(CHECK_SCRIPT), scriptPubKey(CCoinsViewCache::GetSpendFor(&txFromIn, txToIn.vin[nInIn])), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), consensusBranchId(consensusBranchIdIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
+    /** All Sapling spend and output proofs of txToIn plus its binding signature */
+    CScriptCheck(const CTransaction& txToIn, const uint256& dataToBeSignedIn) :
+        type(CHECK_SAPLING), amount(0), ptxTo(&txToIn), nIn(0), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(0), dataToBeSigned(dataToBeSignedIn) { }
+    /** The proof of joinsplit nJoinSplit of txToIn */
+    CScriptCheck(const CTransaction& txToIn, unsigned int nJoinSplit) :
+        type(CHECK_JOINSPLIT), amount(0), ptxTo(&txToIn), nIn(nJoinSplit), nFlags(0), cacheStore(false), consensusBranchId(0), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(0) { }
 
     bool operator()();
 
     void swap(CScriptCheck &check) {
+        std::swap(type, check.type);
+        std::swap(dataToBeSigned, check.dataToBeSigned);
         scriptPubKey.swap(check.scriptPubKey);
         std::swap(ptxTo, check.ptxTo);
         std::swap(amount, check.amount);
@@ -932,6 +1010,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** The chainstate database underneath pcoinsTip (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
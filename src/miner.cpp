@@ -94,6 +94,33 @@ public:
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
+int64_t nLastTemplateBuildTime = 0;
+uint64_t nLastTemplateChecked = 0;
+uint64_t nLastTemplateReused = 0;
+
+/**
+ * What CreateNewBlock learns about a mempool transaction from its inputs.
+ * It only depends on the tip (coin ages, which parents are still in the
+ * mempool) and the notary set, so it is kept for later templates on the
+ * same tip instead of looking up every input of every tx again.
+ */
+struct CTemplateCandidate
+{
+    bool fMissingInputs;
+    double dPriority;                 //! sum(valuein * age), before ComputePriority
+    CAmount nTotalIn;
+    set<uint256> setDependsOn;        //! inputs still in the mempool
+    std::vector<int8_t> vNotaries;    //! notaries that signed inputs, on notary pay chains
+    uint64_t nGeneration;             //! last scan that saw the tx in the mempool
+
+    CTemplateCandidate() : fMissingInputs(false), dPriority(0), nTotalIn(0), nGeneration(0) {}
+};
+
+// Guarded by cs_main, which CreateNewBlock holds while scanning the mempool
+static std::map<uint256, CTemplateCandidate> mapTemplateCandidates;
+static uint256 hashTemplateCandidatesTip;
+static uint8_t templateCandidatesNotaries[64][33];
+static uint64_t nTemplateCandidatesGeneration = 0;
 
 // We want to sort transactions by priority and fee rate, so:
 typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
@@ -204,6 +231,7 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
         }
     } else pk = _pk;
 
+    int64_t nTemplateStart = GetTimeMicros();
     uint64_t deposits,voutsum=0; int32_t isrealtime,kmdheight; uint32_t blocktime; const CChainParams& chainparams = Params();
     bool fNotarisationBlock = false; std::vector<int8_t> NotarisationNotaries;
     
@@ -305,6 +333,15 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
         vector<TxPriority> vecPriority;
         vecPriority.reserve(mempool.mapTx.size() + 1);
 
+        // A new tip or notary set changes coin ages and mempool dependencies
+        if (hashTemplateCandidatesTip != pindexPrev->GetBlockHash() || memcmp(templateCandidatesNotaries, notarypubkeys, sizeof(notarypubkeys)) != 0)
+        {
+            mapTemplateCandidates.clear();
+            hashTemplateCandidatesTip = pindexPrev->GetBlockHash();
+            memcpy(templateCandidatesNotaries, notarypubkeys, sizeof(notarypubkeys));
+        }
+        uint64_t nGeneration = ++nTemplateCandidatesGeneration;
+
         // now add transactions from the mem pool
         int32_t Notarisations = 0; uint64_t txvalue;
         for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
@@ -334,98 +371,106 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
                 continue;
             }
 
-            COrphan* porphan = NULL;
             double dPriority = 0;
             CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
             bool fNotarisation = false;
-            std::vector<int8_t> TMP_NotarisationNotaries;
-            if (tx.IsCoinImport())
+            CTemplateCandidate& candidate = mapTemplateCandidates[tx.GetHash()];
+            if (candidate.nGeneration == 0)
             {
-                CAmount nValueIn = GetCoinImportValue(tx); // burn amount
-                nTotalIn += nValueIn;
-                dPriority += (double)nValueIn * 1000;  // flat multiplier... max = 1e16.
-            } else {
-                TMP_NotarisationNotaries.clear();
-                bool fToCryptoAddress = false;
-                if ( numSN != 0 && notarypubkeys[0][0] != 0 && komodo_is_notarytx(tx) == 1 )
-                    fToCryptoAddress = true;
-
-                BOOST_FOREACH(const CTxIn& txin, tx.vin)
+                if (tx.IsCoinImport())
                 {
-                    if (tx.IsPegsImport() && txin.prevout.n==10e8)
-                    {
-                        CAmount nValueIn = GetCoinImportValue(tx); // burn amount
-                        nTotalIn += nValueIn;
-                        dPriority += (double)nValueIn * 1000;  // flat multiplier... max = 1e16.
-                        continue;
-                    }
-                    // Read prev transaction
-                    if (!view.HaveCoins(txin.prevout.hash))
+                    CAmount nValueIn = GetCoinImportValue(tx); // burn amount
+                    candidate.nTotalIn += nValueIn;
+                    candidate.dPriority += (double)nValueIn * 1000;  // flat multiplier... max = 1e16.
+                } else {
+                    bool fToCryptoAddress = false;
+                    if ( numSN != 0 && notarypubkeys[0][0] != 0 && komodo_is_notarytx(tx) == 1 )
+                        fToCryptoAddress = true;
+
+                    BOOST_FOREACH(const CTxIn& txin, tx.vin)
                     {
-                        // This should never happen; all transactions in the memory
-                        // pool should connect to either transactions in the chain
-                        // or other transactions in the memory pool.
-                        if (!mempool.mapTx.count(txin.prevout.hash))
+                        if (tx.IsPegsImport() && txin.prevout.n==10e8)
                         {
-                            LogPrintf("ERROR: mempool transaction missing input\n");
-                            // if (fDebug) assert("mempool transaction missing input" == 0);
-                            fMissingInputs = true;
-                            if (porphan)
-                                vOrphan.pop_back();
-                            break;
+                            CAmount nValueIn = GetCoinImportValue(tx); // burn amount
+                            candidate.nTotalIn += nValueIn;
+                            candidate.dPriority += (double)nValueIn * 1000;  // flat multiplier... max = 1e16.
+                            continue;
                         }
-
-                        // Has to wait for dependencies
-                        if (!porphan)
+                        // Read prev transaction
+                        if (!view.HaveCoins(txin.prevout.hash))
                         {
-                            // Use list for automatic deletion
-                            vOrphan.push_back(COrphan(&tx));
-                            porphan = &vOrphan.back();
+                            // This should never happen; all transactions in the memory
+                            // pool should connect to either transactions in the chain
+                            // or other transactions in the memory pool.
+                            if (!mempool.mapTx.count(txin.prevout.hash))
+                            {
+                                LogPrintf("ERROR: mempool transaction missing input\n");
+                                // if (fDebug) assert("mempool transaction missing input" == 0);
+                                candidate.fMissingInputs = true;
+                                break;
+                            }
+
+                            // Has to wait for dependencies
+                            candidate.setDependsOn.insert(txin.prevout.hash);
+                            candidate.nTotalIn += mempool.mapTx.find(txin.prevout.hash)->GetTx().vout[txin.prevout.n].nValue;
+                            continue;
                         }
-                        mapDependers[txin.prevout.hash].push_back(porphan);
-                        porphan->setDependsOn.insert(txin.prevout.hash);
-                        nTotalIn += mempool.mapTx.find(txin.prevout.hash)->GetTx().vout[txin.prevout.n].nValue;
-                        continue;
-                    }
-                    const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                    assert(coins);
+                        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
+                        assert(coins);
 
-                    CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-                    nTotalIn += nValueIn;
+                        CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
+                        candidate.nTotalIn += nValueIn;
 
-                    int nConf = nHeight - coins->nHeight;
-                    
-                    uint8_t *script; int32_t scriptlen; uint256 hash; CTransaction tx1;
-                    // loop over notaries array and extract index of signers.
-                    if ( fToCryptoAddress && myGetTransaction(txin.prevout.hash,tx1,hash) )
-                    {
-                        for (int8_t i = 0; i < numSN; i++) 
+                        int nConf = nHeight - coins->nHeight;
+
+                        uint8_t *script; int32_t scriptlen; uint256 hash; CTransaction tx1;
+                        // loop over notaries array and extract index of signers.
+                        if ( fToCryptoAddress && myGetTransaction(txin.prevout.hash,tx1,hash) )
                         {
-                            script = (uint8_t *)&tx1.vout[txin.prevout.n].scriptPubKey[0];
-                            scriptlen = (int32_t)tx1.vout[txin.prevout.n].scriptPubKey.size();
-                            if ( scriptlen == 35 && script[0] == 33 && script[34] == OP_CHECKSIG && memcmp(script+1,notarypubkeys[i],33) == 0 )
+                            for (int8_t i = 0; i < numSN; i++)
                             {
-                                // We can add the index of each notary to vector, and clear it if this notarisation is not valid later on.
-                                TMP_NotarisationNotaries.push_back(i);                          
+                                script = (uint8_t *)&tx1.vout[txin.prevout.n].scriptPubKey[0];
+                                scriptlen = (int32_t)tx1.vout[txin.prevout.n].scriptPubKey.size();
+                                if ( scriptlen == 35 && script[0] == 33 && script[34] == OP_CHECKSIG && memcmp(script+1,notarypubkeys[i],33) == 0 )
+                                {
+                                    // We can add the index of each notary to vector, and clear it if this notarisation is not valid later on.
+                                    candidate.vNotaries.push_back(i);
+                                }
                             }
                         }
+                        candidate.dPriority += (double)nValueIn * nConf;
                     }
-                    dPriority += (double)nValueIn * nConf;
+                    candidate.nTotalIn += tx.GetShieldedValueIn();
                 }
-                if ( numSN != 0 && notarypubkeys[0][0] != 0 && TMP_NotarisationNotaries.size() >= numSN / 5 )
+            }
+            candidate.nGeneration = nGeneration;
+            if (candidate.fMissingInputs) continue;
+
+            dPriority = candidate.dPriority;
+            nTotalIn = candidate.nTotalIn;
+            const std::vector<int8_t>& TMP_NotarisationNotaries = candidate.vNotaries;
+            if ( !tx.IsCoinImport() && numSN != 0 && notarypubkeys[0][0] != 0 && TMP_NotarisationNotaries.size() >= numSN / 5 )
+            {
+                // check a notary didnt sign twice (this would be an invalid notarisation later on and cause problems)
+                std::set<int> checkdupes( TMP_NotarisationNotaries.begin(), TMP_NotarisationNotaries.end() );
+                if ( checkdupes.size() != TMP_NotarisationNotaries.size() )
                 {
-                    // check a notary didnt sign twice (this would be an invalid notarisation later on and cause problems)
-                    std::set<int> checkdupes( TMP_NotarisationNotaries.begin(), TMP_NotarisationNotaries.end() );
-                    if ( checkdupes.size() != TMP_NotarisationNotaries.size() ) 
-                    {
-                        fprintf(stderr, "possible notarisation is signed multiple times by same notary, passed as normal transaction.\n");
-                    } else fNotarisation = true;
-                }
-                nTotalIn += tx.GetShieldedValueIn();
+                    fprintf(stderr, "possible notarisation is signed multiple times by same notary, passed as normal transaction.\n");
+                } else fNotarisation = true;
             }
 
-            if (fMissingInputs) continue;
+            COrphan* porphan = NULL;
+            if (!candidate.setDependsOn.empty())
+            {
+                // Use list for automatic deletion
+                vOrphan.push_back(COrphan(&tx));
+                porphan = &vOrphan.back();
+                BOOST_FOREACH(const uint256& parent, candidate.setDependsOn)
+                {
+                    mapDependers[parent].push_back(porphan);
+                    porphan->setDependsOn.insert(parent);
+                }
+            }
 
             // Priority is sum(valuein * age) / modified_txsize
             unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
@@ -479,9 +524,19 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
                 vecPriority.push_back(TxPriority(dPriority, feeRate, &(mi->GetTx())));
         }
 
+        // Forget transactions that left the mempool
+        for (std::map<uint256, CTemplateCandidate>::iterator it = mapTemplateCandidates.begin(); it != mapTemplateCandidates.end(); )
+        {
+            if (it->second.nGeneration != nGeneration)
+                mapTemplateCandidates.erase(it++);
+            else
+                ++it;
+        }
+
         // Collect transactions into block
         uint64_t nBlockSize = 1000;
         uint64_t nBlockTx = 0;
+        uint64_t nChecked = 0, nReused = 0;
         int64_t interest;
         int nBlockSigOps = 100;
         bool fSortedByFee = (nBlockPrioritySize <= 0);
@@ -584,12 +639,24 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
             // Note that flags: we don't want to set mempool/IsStandard()
             // policy here, but we still have to ensure that the block we
             // create only contains transactions that are valid in new blocks.
-            CValidationState state;
-            PrecomputedTransactionData txdata(tx);
-            if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+            // Transactions whose inputs already passed these checks (at
+            // mempool acceptance or for an earlier template) and that the
+            // new tip cannot have affected are not checked again.
+            if (mempool.InputsCheckedFor(hash, pindexPrev->GetBlockHash(), consensusBranchId))
             {
-                //fprintf(stderr,"context failure\n");
-                continue;
+                nReused++;
+            }
+            else
+            {
+                CValidationState state;
+                PrecomputedTransactionData txdata(tx);
+                if (!ContextualCheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, Params().GetConsensus(), consensusBranchId))
+                {
+                    //fprintf(stderr,"context failure\n");
+                    continue;
+                }
+                mempool.SetInputsChecked(hash, CMempoolInputsCheck(pindexPrev->GetBlockHash(), consensusBranchId, InputsCheckDependsOnTip(tx, view)));
+                nChecked++;
             }
             UpdateCoins(tx, view, nHeight);
 
@@ -631,6 +698,10 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
 
         nLastBlockTx = nBlockTx;
         nLastBlockSize = nBlockSize;
+        nLastTemplateChecked = nChecked;
+        nLastTemplateReused = nReused;
+        nLastTemplateBuildTime = GetTimeMicros() - nTemplateStart;
+        LogPrint("miner", "CreateNewBlock: %u txs, inputs checked %u reused %u, %.2fms\n", nBlockTx, nChecked, nReused, nLastTemplateBuildTime * 0.001);
         if ( ASSETCHAINS_ADAPTIVEPOW <= 0 )
             blocktime = 1 + std::max(pindexPrev->GetMedianTimePast()+1, GetTime());
         else blocktime = 1 + std::max((int64_t)(pindexPrev->nTime+1), GetTime());
@@ -910,6 +981,8 @@ CBlockTemplate* CreateNewBlock(CPubKey _pk,const CScript& _scriptPubKeyIn, int32
             //fprintf(stderr,"check validity\n");
             if ( !TestBlockValidity(state, *pblock, pindexPrev, false, false)) // invokes CC checks
             {
+                // don't trust any of the reused input checks for the next template
+                mempool.ClearInputsChecked();
                 if ( ASSETCHAINS_SYMBOL[0] == 0 || (ASSETCHAINS_SYMBOL[0] != 0 && !isStake) )
                 {
                     LEAVE_CRITICAL_SECTION(cs_main);
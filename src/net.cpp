@@ -121,6 +121,78 @@ static boost::condition_variable messageHandlerCondition;
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
 
+#ifdef USE_EPOLL
+// epoll instance used by ThreadSocketHandler, -1 when running on select()
+static int hEpoll = -1;
+// nodes with unconsumed edge-triggered readiness, owned by the socket handler thread
+static set<CNode*> setNodesReady;
+static const int MAX_EPOLL_EVENTS = 256;
+#endif
+
+bool SocketEventsEpoll()
+{
+#ifdef USE_EPOLL
+    return hEpoll != -1;
+#else
+    return false;
+#endif
+}
+
+static void SocketEventsInit()
+{
+#ifdef USE_EPOLL
+    std::string strMode = GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (strMode != "epoll")
+        return;
+    hEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (hEpoll == -1)
+    {
+        LogPrintf("epoll_create1 failed: %s, falling back to select()\n", NetworkErrorString(WSAGetLastError()));
+        return;
+    }
+    // listening sockets stay level-triggered, AcceptConnection takes one connection per wakeup
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0)
+            LogPrintf("epoll_ctl failed for listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+    }
+    LogPrintf("Using epoll for peer sockets\n");
+#endif
+}
+
+static void SocketEventsShutdown()
+{
+#ifdef USE_EPOLL
+    if (hEpoll != -1)
+    {
+        close(hEpoll);
+        hEpoll = -1;
+    }
+#endif
+}
+
+// Must be called before pnode is added to vNodes. Closing the socket drops it
+// from the epoll set again, so there is no matching remove.
+static bool SocketEventsAddNode(CNode *pnode)
+{
+#ifdef USE_EPOLL
+    if (hEpoll == -1)
+        return true;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0)
+    {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+        return false;
+    }
+#endif
+    return true;
+}
+
 void AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -400,7 +472,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!SocketEventsEpoll() && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -411,6 +483,8 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
         // Add node
         CNode* pnode = new CNode(hSocket, addrConnect, pszDest ? pszDest : "", false);
         pnode->AddRef();
+        if (!SocketEventsAddNode(pnode))
+            pnode->fDisconnect = true;
 
         {
             LOCK(cs_vNodes);
@@ -964,7 +1038,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!SocketEventsEpoll() && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1011,79 +1085,358 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint("net", "connection from %s accepted\n", addr.ToString());
 
+    if (!SocketEventsAddNode(pnode))
+        pnode->fDisconnect = true;
+
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
-void ThreadSocketHandler()
+static void DisconnectNodes(unsigned int& nPrevNodeCount)
 {
-    unsigned int nPrevNodeCount = 0;
-    while (true)
     {
-        //
-        // Disconnect nodes
-        //
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        vector<CNode*> vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            vector<CNode*> vNodesCopy = vNodes;
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            if (pnode->fDisconnect ||
+                (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty()))
             {
-                if (pnode->fDisconnect ||
-                    (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty()))
-                {
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
 
-                    // release outbound grant (if any)
-                    pnode->grantOutbound.Release();
+                // release outbound grant (if any)
+                pnode->grantOutbound.Release();
 
-                    // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+                // close socket and cleanup
+                pnode->CloseSocketDisconnect();
 
-                    // hold in disconnected pool until all refs are released
-                    if (pnode->fNetworkNode || pnode->fInbound)
-                        pnode->Release();
-                    vNodesDisconnected.push_back(pnode);
-                }
+                // hold in disconnected pool until all refs are released
+                if (pnode->fNetworkNode || pnode->fInbound)
+                    pnode->Release();
+                vNodesDisconnected.push_back(pnode);
             }
         }
+    }
+    {
+        // Delete disconnected nodes
+        list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
         {
-            // Delete disconnected nodes
-            list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
+            // wait until threads are done using it
+            if (pnode->GetRefCount() <= 0)
             {
-                // wait until threads are done using it
-                if (pnode->GetRefCount() <= 0)
+                bool fDelete = false;
                 {
-                    bool fDelete = false;
+                    TRY_LOCK(pnode->cs_vSend, lockSend);
+                    if (lockSend)
                     {
-                        TRY_LOCK(pnode->cs_vSend, lockSend);
-                        if (lockSend)
+                        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                        if (lockRecv)
                         {
-                            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                            if (lockRecv)
-                            {
-                                TRY_LOCK(pnode->cs_inventory, lockInv);
-                                if (lockInv)
-                                    fDelete = true;
-                            }
+                            TRY_LOCK(pnode->cs_inventory, lockInv);
+                            if (lockInv)
+                                fDelete = true;
                         }
                     }
-                    if (fDelete)
-                    {
-                        vNodesDisconnected.remove(pnode);
-                        delete pnode;
-                    }
+                }
+                if (fDelete)
+                {
+                    vNodesDisconnected.remove(pnode);
+#ifdef USE_EPOLL
+                    setNodesReady.erase(pnode);
+#endif
+                    delete pnode;
+                }
+            }
+        }
+    }
+    if(vNodes.size() != nPrevNodeCount) {
+        nPrevNodeCount = vNodes.size();
+        uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
+    }
+}
+
+// Implement the following logic:
+// * If there is data to send, select() for sending data. As this only
+//   happens when optimistic write failed, we choose to first drain the
+//   write buffer in this case before receiving more. This avoids
+//   needlessly queueing received data, if the remote peer is not themselves
+//   receiving data. This means properly utilizing TCP flow control signaling.
+// * Otherwise, if there is no (complete) message in the receive buffer,
+//   or there is space left in the buffer, select() for receiving data.
+// * (if neither of the above applies, there is certainly one message
+//   in the receiver buffer ready to be processed).
+// Together, that means that at least one of the following is always possible,
+// so we don't deadlock:
+// * We send some data.
+// * We wait for data to be received (and disconnect after timeout).
+// * We process a message in the buffer (message handler thread).
+static void SocketWants(CNode *pnode, bool& fWantSend, bool& fWantRecv)
+{
+    fWantSend = fWantRecv = false;
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend && !pnode->vSendMsg.empty()) {
+            fWantSend = true;
+            return;
+        }
+    }
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (lockRecv && (
+            pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+            pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+            fWantRecv = true;
+    }
+}
+
+// Reads once from pnode's socket. Returns false once the kernel buffer is
+// known to be drained (short read, would-block, or the socket was closed).
+static bool SocketRecvData(CNode *pnode)
+{
+    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+    if (!lockRecv)
+        return true;
+
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+        return nBytes == sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+        else if (nErr != WSAEWOULDBLOCK)
+            return true;
+    }
+    return false;
+}
+
+static void InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+#ifdef USE_EPOLL
+// Edge-triggered variant of the socket loop. Each node is registered once with
+// EPOLLIN|EPOLLOUT|EPOLLET; a wakeup only touches the nodes the kernel reported
+// plus those still holding readiness we could not consume yet (send queue
+// empty, receive flood limit hit, lock contended). Inactivity checks, which
+// need every node, run once a second instead of on every wakeup.
+static void ThreadSocketHandlerEpoll()
+{
+    unsigned int nPrevNodeCount = 0;
+    int64_t nLastInactivityCheck = 0;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    while (true)
+    {
+        DisconnectNodes(nPrevNodeCount);
+
+        //
+        // Only block if no node can make progress without new events
+        //
+        int nTimeout = 50; // frequency to poll pnode->vSend
+        BOOST_FOREACH(CNode* pnode, setNodesReady)
+        {
+            bool fWantSend, fWantRecv;
+            SocketWants(pnode, fWantSend, fWantRecv);
+            if ((fWantSend && pnode->fSocketSendReady) || (fWantRecv && pnode->fSocketRecvReady))
+            {
+                nTimeout = 0;
+                break;
+            }
+            if (pnode->fSocketSendReady)
+            {
+                // contended send lock, retry soon instead of waiting for an event
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (!lockSend)
+                    nTimeout = 1;
+            }
+        }
+
+        int nEvents = epoll_wait(hEpoll, events, MAX_EPOLL_EVENTS, nTimeout);
+        boost::this_thread::interruption_point();
+
+        if (nEvents < 0)
+        {
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR)
+            {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                MilliSleep(nTimeout);
+            }
+            nEvents = 0;
+        }
+
+        bool fListenReady = false;
+        for (int i = 0; i < nEvents; i++)
+        {
+            CNode* pnode = (CNode*)events[i].data.ptr;
+            if (pnode == NULL)
+            {
+                fListenReady = true;
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                pnode->fSocketRecvReady = true;
+            if (events[i].events & EPOLLOUT)
+                pnode->fSocketSendReady = true;
+            setNodesReady.insert(pnode);
+        }
+
+        //
+        // Accept new connections
+        //
+        if (fListenReady)
+        {
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            {
+                struct pollfd pfd;
+                pfd.fd = hListenSocket.socket;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                if (hListenSocket.socket != INVALID_SOCKET && poll(&pfd, 1, 0) > 0)
+                    AcceptConnection(hListenSocket);
+            }
+        }
+
+        //
+        // Service each ready socket. Nodes in setNodesReady are only deleted
+        // by DisconnectNodes on this thread, so no extra reference is needed.
+        //
+        vector<CNode*> vNodesReady(setNodesReady.begin(), setNodesReady.end());
+        BOOST_FOREACH(CNode* pnode, vNodesReady)
+        {
+            boost::this_thread::interruption_point();
+
+            if (pnode->hSocket == INVALID_SOCKET)
+            {
+                setNodesReady.erase(pnode);
+                continue;
+            }
+
+            bool fWantSend, fWantRecv;
+            SocketWants(pnode, fWantSend, fWantRecv);
+            if (fWantRecv && pnode->fSocketRecvReady)
+                pnode->fSocketRecvReady = SocketRecvData(pnode);
+
+            if (pnode->hSocket == INVALID_SOCKET)
+            {
+                setNodesReady.erase(pnode);
+                continue;
+            }
+
+            // Unread data keeps a node here until it is drained; the flood
+            // limit may hold it back for a while. A writable socket only
+            // leaves once its send queue is seen empty: a send that fails to
+            // complete leaves the kernel buffer full, so EPOLLOUT fires again,
+            // but a socket that stays writable is never reported again.
+            bool fKeep = pnode->fSocketRecvReady;
+            if (pnode->fSocketSendReady)
+            {
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (!lockSend)
+                    fKeep = true; // a message thread may be queueing behind a partial send
+                else if (!pnode->vSendMsg.empty())
+                {
+                    SocketSendData(pnode);
+                    if (!pnode->vSendMsg.empty())
+                        pnode->fSocketSendReady = false;
                 }
             }
+
+            if (!fKeep)
+                setNodesReady.erase(pnode);
         }
-        if(vNodes.size() != nPrevNodeCount) {
-            nPrevNodeCount = vNodes.size();
-            uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
+
+        //
+        // Inactivity checking
+        //
+        int64_t nNow = GetTime();
+        if (nNow != nLastInactivityCheck)
+        {
+            nLastInactivityCheck = nNow;
+            vector<CNode*> vNodesCopy;
+            {
+                LOCK(cs_vNodes);
+                vNodesCopy = vNodes;
+                BOOST_FOREACH(CNode* pnode, vNodesCopy)
+                    pnode->AddRef();
+            }
+            BOOST_FOREACH(CNode* pnode, vNodesCopy)
+                InactivityCheck(pnode);
+            {
+                LOCK(cs_vNodes);
+                BOOST_FOREACH(CNode* pnode, vNodesCopy)
+                    pnode->Release();
+            }
         }
+    }
+}
+#endif
+
+void ThreadSocketHandler()
+{
+#ifdef USE_EPOLL
+    if (hEpoll != -1)
+    {
+        ThreadSocketHandlerEpoll();
+        return;
+    }
+#endif
+
+    unsigned int nPrevNodeCount = 0;
+    while (true)
+    {
+        DisconnectNodes(nPrevNodeCount);
 
         //
         // Find which sockets have data to receive
@@ -1117,35 +1470,12 @@ void ThreadSocketHandler()
                 hSocketMax = max(hSocketMax, pnode->hSocket);
                 have_fds = true;
 
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signaling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                bool fWantSend, fWantRecv;
+                SocketWants(pnode, fWantSend, fWantRecv);
+                if (fWantSend)
+                    FD_SET(pnode->hSocket, &fdsetSend);
+                else if (fWantRecv)
+                    FD_SET(pnode->hSocket, &fdsetRecv);
             }
         }
 
@@ -1198,43 +1528,7 @@ void ThreadSocketHandler()
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
             if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
-            {
-                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+                SocketRecvData(pnode);
 
             //
             // Send
@@ -1251,30 +1545,7 @@ void ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         {
             LOCK(cs_vNodes);
@@ -1831,6 +2102,7 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
         threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "dnsseed", &ThreadDNSAddressSeed));
 
     // Send and receive from sockets, accept connections
+    SocketEventsInit();
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
     // Initiate outbound connections from -addnode
@@ -1849,6 +2121,8 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 bool StopNode()
 {
     LogPrintf("StopNode()\n");
+    // the socket handler has been joined by now, whether it was interrupted or threw
+    SocketEventsShutdown();
     if (semOutbound)
         for (int i=0; i<MAX_OUTBOUND_CONNECTIONS; i++)
             semOutbound->post();
@@ -1878,6 +2152,8 @@ public:
                 if (!CloseSocket(hListenSocket.socket))
                     LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
 
+        SocketEventsShutdown();
+
         // clean up some globals (to help leak detection)
         BOOST_FOREACH(CNode *pnode, vNodes)
             delete pnode;
@@ -2125,6 +2401,8 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fNetworkNode = false;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fSocketRecvReady = false;
+    fSocketSendReady = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
@@ -75,6 +75,12 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 384;
+/** The default for -socketevents, the readiness API used by the socket handler. */
+#ifdef USE_EPOLL
+static const char DEFAULT_SOCKETEVENTS[] = "epoll";
+#else
+static const char DEFAULT_SOCKETEVENTS[] = "select";
+#endif
 /** The period before a network upgrade activates, where connections to upgrading peers are preferred (in blocks). */
 static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 24 * 24 * 3;
 
@@ -94,6 +100,8 @@ bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhite
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+/** Whether ThreadSocketHandler waits on epoll instead of select() (-socketevents). */
+bool SocketEventsEpoll();
 
 typedef int NodeId;
 
@@ -273,6 +281,9 @@ public:
     uint64_t nSendBytes;
     std::deque<CSerializeData> vSendMsg;
     CCriticalSection cs_vSend;
+    // edge-triggered readiness not yet consumed, only touched by the socket handler thread
+    bool fSocketRecvReady;
+    bool fSocketSendReady;
 
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
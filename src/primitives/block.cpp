@@ -24,6 +24,7 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "komodo_defs.h"
 
 
@@ -172,15 +173,20 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
     bool mutated = false;
     for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if ((nSize & 1) == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // Each level is stored contiguously, so every pair of siblings is one
+        // 64-byte input and the whole level can be hashed in a single batch.
+        int nPairs = nSize / 2;
+        vMerkleTree.resize(j + nSize + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[j+nSize].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize & 1) {
+            unsigned char last[64];
+            memcpy(last, vMerkleTree[j+nSize-1].begin(), 32);
+            memcpy(last + 32, vMerkleTree[j+nSize-1].begin(), 32);
+            SHA256D64(vMerkleTree[j+nSize+nPairs].begin(), last, 1);
         }
         j += nSize;
     }
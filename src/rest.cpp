@@ -20,6 +20,7 @@
 
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "cc/CCstats.h"
 #include "main.h"
 #include "httpserver.h"
 #include "rpc/server.h"
@@ -331,6 +332,26 @@ static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_ccstats(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+
+    // the text form is the Prometheus exposition format, so a scraper can point at /rest/ccstats.txt
+    if (strURIPart == ".txt") {
+        req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+        req->WriteReply(HTTP_OK, ccStats.ToPrometheus());
+        return true;
+    }
+    if (strURIPart == ".json") {
+        string strJSON = ccStats.ToJSON().write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: txt, json)");
+}
+
 static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -615,6 +636,7 @@ static const struct {
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
+      {"/rest/ccstats", rest_ccstats},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
 };
@@ -27,6 +27,8 @@
 #include "consensus/validation.h"
 #include "cc/eval.h"
 #include "main.h"
+#include "notarisationdb.h"
+#include "txdb.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -45,6 +47,8 @@
 
 #include "cc/CCinclude.h"
 #include "cc/CCPrices.h"
+#include "cc/CCindex.h"
+#include "cc/CCstats.h"
 
 using namespace std;
 
@@ -934,6 +938,301 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
     return ret;
 }
 
+static UniValue DBStatsToJSON(const std::string& name, const CDBStats& stats)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("name", name));
+    obj.push_back(Pair("size", (uint64_t)stats.nApproximateSize));
+    obj.push_back(Pair("files", stats.nFiles));
+    obj.push_back(Pair("compaction_seconds", stats.dCompactionSeconds));
+    obj.push_back(Pair("reads", (uint64_t)stats.nReads));
+    obj.push_back(Pair("avg_read_us", stats.nReads ? (double)stats.nReadMicros / stats.nReads : 0.0));
+    obj.push_back(Pair("cache_mib", (uint64_t)(stats.tuning.nCacheSize >> 20)));
+    obj.push_back(Pair("write_buffer_mib", (uint64_t)(stats.tuning.nWriteBufferSize >> 20)));
+    obj.push_back(Pair("compression", stats.tuning.fCompression));
+    return obj;
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns size, compaction and read statistics for each LevelDB database.\n"
+            "The address, spent and timestamp indexes are listed separately once they live in\n"
+            "their own databases (see -migrateindexes).\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"chainstate\",     (string) the database\n"
+            "    \"size\": n,                 (numeric) approximate size of its table files in bytes\n"
+            "    \"files\": n,                (numeric) number of table files\n"
+            "    \"compaction_seconds\": x,   (numeric) time spent compacting since startup\n"
+            "    \"reads\": n,                (numeric) point reads and iterator seeks since startup\n"
+            "    \"avg_read_us\": x,          (numeric) average read latency in microseconds\n"
+            "    \"cache_mib\": n,            (numeric) configured cache size\n"
+            "    \"write_buffer_mib\": n,     (numeric) configured write buffer, 0 if derived from the cache\n"
+            "    \"compression\": true|false  (boolean) whether table blocks are compressed\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    CDBStats stats;
+    LOCK(cs_main);
+    if (pcoinsdbview) {
+        pcoinsdbview->GetDBStats(stats);
+        ret.push_back(DBStatsToJSON("chainstate", stats));
+    }
+    if (pblocktree) {
+        std::vector<std::pair<std::string, CDBStats> > vStats;
+        pblocktree->GetDBStats(vStats);
+        for (size_t i = 0; i < vStats.size(); i++)
+            ret.push_back(DBStatsToJSON(vStats[i].first, vStats[i].second));
+    }
+    if (pnotarisations) {
+        pnotarisations->GetStats(stats);
+        ret.push_back(DBStatsToJSON("notarisations", stats));
+    }
+    if (pccindex) {
+        pccindex->GetStats(stats);
+        ret.push_back(DBStatsToJSON("ccindex", stats));
+    }
+    return ret;
+}
+
+UniValue getccstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getccstats ( reset )\n"
+            "\nReturns counters and latency histograms of CC validation per evalcode and funcid since startup\n"
+            "or the last reset. The same data is served in Prometheus text format at /rest/ccstats.txt with -rest.\n"
+            "\nArguments:\n"
+            "1. reset           (boolean, optional, default=false) Clear the counters after reading them\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"evalcode\": \"0xf2\",       (string) the eval code\n"
+            "    \"name\": \"TOKENS\",         (string) its module\n"
+            "    \"calls\": n,                (numeric) validations run\n"
+            "    \"invalid\": n,              (numeric) validations that failed\n"
+            "    \"total_ms\": x,             (numeric) total time spent validating\n"
+            "    \"avg_us\": x,               (numeric) average time per validation in microseconds\n"
+            "    \"max_us\": n,               (numeric) longest validation in microseconds\n"
+            "    \"histogram\": { ... },      (object) validations per latency bucket\n"
+            "    \"gettransaction\": n,       (numeric) myGetTransaction calls made by the validations\n"
+            "    \"unspents\": n,             (numeric) SetCCunspents calls made by the validations\n"
+            "    \"txids\": n,                (numeric) SetCCtxids calls made by the validations\n"
+            "    \"funcids\": { \"c\": { ... }, ... }  (object) the same counters per funcid\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getccstats", "")
+            + HelpExampleCli("getccstats", "true")
+            + HelpExampleRpc("getccstats", "true")
+        );
+
+    UniValue result = ccStats.ToJSON();
+    if (params.size() > 0 && params[0].get_bool())
+        ccStats.Reset();
+    return result;
+}
+
+extern int32_t KOMODO_CONNECTING;
+
+/** Sets KOMODO_CONNECTING for the lifetime of the guard, restoring it even if validation throws */
+class CConnectingHeightGuard
+{
+    int32_t prevConnecting;
+public:
+    explicit CConnectingHeightGuard(int32_t height) : prevConnecting(KOMODO_CONNECTING) { KOMODO_CONNECTING = height; }
+    ~CConnectingHeightGuard() { KOMODO_CONNECTING = prevConnecting; }
+};
+
+static bool CompareTxTiming(const std::pair<int64_t, UniValue> &a, const std::pair<int64_t, UniValue> &b)
+{
+    return a.first > b.first;
+}
+
+UniValue ccreplay(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() < 2 || params.size() > 4)
+        throw runtime_error(
+            "ccreplay startheight endheight ( evalcode verbose )\n"
+            "\nRe-runs CC validation for every CC input of the blocks in the given range and reports how long each\n"
+            "module took. The blocks are read from disk and nothing is written, so the call can be used to benchmark\n"
+            "module code over real chain data. Every replayed input was accepted when its block was connected, so\n"
+            "any input that fails now is reported as a mismatch. Modules that look up unspents or address indexes see\n"
+            "the current tip rather than the state at the replayed height, which can also cause mismatches.\n"
+            "\nArguments:\n"
+            "1. startheight     (numeric, required) first block to replay\n"
+            "2. endheight       (numeric, required) last block to replay\n"
+            "3. evalcode        (numeric, optional, default=0) only report inputs that invoked this evalcode, 0 for all\n"
+            "4. verbose         (boolean, optional, default=false) list the timing of every replayed tx instead of the slowest ones\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,                (numeric) blocks replayed\n"
+            "  \"txs\": n,                   (numeric) txs with at least one reported CC input\n"
+            "  \"ccinputs\": n,              (numeric) CC inputs reported\n"
+            "  \"total_ms\": x,              (numeric) time spent verifying the reported inputs\n"
+            "  \"missingprevouts\": n,       (numeric) inputs whose prevout tx could not be loaded\n"
+            "  \"modules\": [ ... ],         (array) per evalcode counters, same layout as getccstats\n"
+            "  \"txtimings\": [              (array) slowest txs, or all of them with verbose\n"
+            "    { \"txid\": \"hash\", \"height\": n, \"ccinputs\": n, \"us\": n }, ...\n"
+            "  ],\n"
+            "  \"mismatches\": [             (array) inputs that no longer validate\n"
+            "    { \"txid\": \"hash\", \"height\": n, \"vin\": n, \"error\": \"...\" }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("ccreplay", "100000 101000")
+            + HelpExampleCli("ccreplay", "100000 101000 242 true")
+            + HelpExampleRpc("ccreplay", "100000, 101000, 242")
+        );
+
+    int32_t nStartHeight = params[0].get_int(), nEndHeight = params[1].get_int();
+    uint8_t evalcodeFilter = 0;
+    bool fVerbose = false;
+    if (params.size() > 2)
+    {
+        int32_t evalcode = params[2].get_int();
+        if (evalcode < 0 || evalcode > 0xff)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "evalcode out of range");
+        evalcodeFilter = (uint8_t)evalcode;
+    }
+    if (params.size() > 3)
+        fVerbose = params[3].get_bool();
+    {
+        LOCK(cs_main);
+        if (nStartHeight < 1 || nEndHeight < nStartHeight || nEndHeight > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+    }
+
+    // ConnectBlock flags, the replayed inputs were accepted under these
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    const size_t MAX_TXTIMINGS = 20;
+    std::map<uint16_t, CCValidationStats> mapModules;
+    std::vector<std::pair<int64_t, UniValue> > vTxTimings;
+    UniValue mismatches(UniValue::VARR);
+    int64_t nBlocks = 0, nTxs = 0, nInputs = 0, nMissing = 0, nTotalMicros = 0;
+
+    for (int32_t height = nStartHeight; height <= nEndHeight; height++)
+    {
+        boost::this_thread::interruption_point();
+        CBlock block;
+        // cs_main is taken per block so the node keeps connecting blocks during a long replay,
+        // it also serializes KOMODO_CONNECTING with ConnectBlock and AcceptToMemoryPool
+        LOCK(cs_main);
+        CBlockIndex *pindex = chainActive[height];
+        if (pindex == NULL)
+            break;
+        if (!ReadBlockFromDisk(block, pindex, false))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Can't read block %d from disk", height));
+        uint32_t consensusBranchId = CurrentEpochBranchId(height, Params().GetConsensus());
+        // the validators take the height being connected from here, CC checks are skipped while it is negative
+        CConnectingHeightGuard connecting(height);
+        for (const CTransaction &tx : block.vtx)
+        {
+            if (tx.IsCoinBase())
+                continue;
+            PrecomputedTransactionData txdata(tx);
+            int64_t nTxMicros = 0, nTxInputs = 0;
+            for (unsigned int i = 0; i < tx.vin.size(); i++)
+            {
+                CTransaction prevTx; uint256 hashBlock;
+                if (!GetTransaction(tx.vin[i].prevout.hash, prevTx, hashBlock, true) || tx.vin[i].prevout.n >= prevTx.vout.size())
+                {
+                    nMissing++;
+                    continue;
+                }
+                const CTxOut &prevout = prevTx.vout[tx.vin[i].prevout.n];
+                if (!prevout.scriptPubKey.IsPayToCryptoCondition())
+                    continue;
+
+                CCValidationCapture capture;
+                ServerTransactionSignatureChecker checker(&tx, i, prevout.nValue, false, txdata);
+                ScriptError serror = SCRIPT_ERR_OK;
+                int64_t nStart = GetTimeMicros();
+                bool fValid = VerifyScript(tx.vin[i].scriptSig, prevout.scriptPubKey, flags, checker, consensusBranchId, &serror);
+                int64_t nMicros = GetTimeMicros() - nStart;
+
+                bool fReported = evalcodeFilter == 0;
+                for (const auto &entry : capture.mapStats)
+                    if ((entry.first >> 8) == evalcodeFilter)
+                        fReported = true;
+                if (!fReported)
+                    continue;
+                for (const auto &entry : capture.mapStats)
+                    mapModules[entry.first].Add(entry.second);
+                nTxMicros += nMicros;
+                nTxInputs++;
+                if (!fValid)
+                {
+                    UniValue mismatch(UniValue::VOBJ);
+                    mismatch.push_back(Pair("txid", tx.GetHash().GetHex()));
+                    mismatch.push_back(Pair("height", height));
+                    mismatch.push_back(Pair("vin", (int64_t)i));
+                    mismatch.push_back(Pair("error", ScriptErrorString(serror)));
+                    mismatches.push_back(mismatch);
+                }
+            }
+            if (nTxInputs == 0)
+                continue;
+            nTxs++;
+            nInputs += nTxInputs;
+            nTotalMicros += nTxMicros;
+            UniValue timing(UniValue::VOBJ);
+            timing.push_back(Pair("txid", tx.GetHash().GetHex()));
+            timing.push_back(Pair("height", height));
+            timing.push_back(Pair("ccinputs", nTxInputs));
+            timing.push_back(Pair("us", nTxMicros));
+            vTxTimings.push_back(std::make_pair(nTxMicros, timing));
+            if (!fVerbose && vTxTimings.size() > 2 * MAX_TXTIMINGS)
+            {
+                std::sort(vTxTimings.begin(), vTxTimings.end(), CompareTxTiming);
+                vTxTimings.resize(MAX_TXTIMINGS);
+            }
+        }
+        nBlocks++;
+    }
+
+    UniValue result(UniValue::VOBJ), modules(UniValue::VARR), txtimings(UniValue::VARR);
+    std::map<uint16_t, CCValidationStats>::const_iterator it = mapModules.begin();
+    while (it != mapModules.end())
+    {
+        uint8_t evalcode = it->first >> 8;
+        CCValidationStats total;
+        for (; it != mapModules.end() && (it->first >> 8) == evalcode; ++it)
+            total.Add(it->second);
+        UniValue obj = total.ToJSON();
+        obj.push_back(Pair("evalcode", strprintf("0x%02x", evalcode)));
+        obj.push_back(Pair("name", EvalToStr(evalcode)));
+        modules.push_back(obj);
+    }
+    if (!fVerbose)
+    {
+        std::sort(vTxTimings.begin(), vTxTimings.end(), CompareTxTiming);
+        if (vTxTimings.size() > MAX_TXTIMINGS)
+            vTxTimings.resize(MAX_TXTIMINGS);
+    }
+    for (const auto &timing : vTxTimings)
+        txtimings.push_back(timing.second);
+    result.push_back(Pair("blocks", nBlocks));
+    result.push_back(Pair("txs", nTxs));
+    result.push_back(Pair("ccinputs", nInputs));
+    result.push_back(Pair("total_ms", nTotalMicros / 1000.0));
+    result.push_back(Pair("missingprevouts", nMissing));
+    result.push_back(Pair("modules", modules));
+    result.push_back(Pair("txtimings", txtimings));
+    result.push_back(Pair("mismatches", mismatches));
+    return result;
+}
 
 UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
@@ -1817,6 +2116,9 @@ static const CRPCCommand commands[] =
 { "blockchain",         "getrawmempool",          &getrawmempool,          true },
 { "blockchain",         "gettxout",               &gettxout,               true },
 { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true },
+{ "blockchain",         "getdbstats",             &getdbstats,             true },
+{ "blockchain",         "getccstats",             &getccstats,             true },
+{ "blockchain",         "ccreplay",               &ccreplay,               true },
 { "blockchain",         "verifychain",            &verifychain,            true },
 
 /* Not shown in help */
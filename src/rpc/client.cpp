@@ -46,6 +46,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "generate", 0 },
     { "getnetworkhashps", 0 },
     { "getnetworkhashps", 1 },
+    { "getstakingprofile", 0 },
+    { "getccstats", 0 },
+    { "ccreplay", 0 },
+    { "ccreplay", 1 },
+    { "ccreplay", 2 },
+    { "ccreplay", 3 },
     { "getnetworksolps", 0 },
     { "getnetworksolps", 1 },
     { "sendtoaddress", 1 },
@@ -137,6 +143,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0},
     { "z_listaddresses", 0},
     { "z_listreceivedbyaddress", 1},
@@ -159,7 +166,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "z_shieldcoinbase", 2},
     { "z_shieldcoinbase", 3},
     { "z_getoperationstatus", 0},
+    { "z_rescanwallet", 0},
     { "z_getoperationresult", 0},
+    { "faucetget", 0},
     { "paxprice", 4 },
     { "paxprices", 3 },
     { "paxpending", 0 },
@@ -33,6 +33,7 @@
 #include "net.h"
 #include "pow.h"
 #include "rpc/server.h"
+#include "stakingprofiler.h"
 #include "txmempool.h"
 #include "util.h"
 #include "validationinterface.h"
@@ -461,6 +462,9 @@ UniValue getmininginfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "  \"blocks\": nnn,             (numeric) The current block\n"
             "  \"currentblocksize\": nnn,   (numeric) The last block size\n"
             "  \"currentblocktx\": nnn,     (numeric) The last block transaction\n"
+            "  \"templatebuildtime\": nnn,  (numeric) Milliseconds it took to select the transactions of the last block template\n"
+            "  \"templatetxchecked\": nnn,  (numeric) Transactions of the last block template whose inputs had to be checked\n"
+            "  \"templatetxreused\": nnn,   (numeric) Transactions of the last block template that reused an earlier input check\n"
             "  \"difficulty\": xxx.xxxxx    (numeric) The current difficulty\n"
             "  \"errors\": \"...\"          (string) Current errors\n"
             "  \"generate\": true|false     (boolean) If the generation is on or off (see getgenerate or setgenerate calls)\n"
@@ -483,6 +487,9 @@ UniValue getmininginfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
     obj.push_back(Pair("blocks",           (int)chainActive.Height()));
     obj.push_back(Pair("currentblocksize", (uint64_t)nLastBlockSize));
     obj.push_back(Pair("currentblocktx",   (uint64_t)nLastBlockTx));
+    obj.push_back(Pair("templatebuildtime", nLastTemplateBuildTime * 0.001));
+    obj.push_back(Pair("templatetxchecked", (uint64_t)nLastTemplateChecked));
+    obj.push_back(Pair("templatetxreused", (uint64_t)nLastTemplateReused));
     obj.push_back(Pair("difficulty",       (double)GetNetworkDifficulty()));
     obj.push_back(Pair("errors",           GetWarnings("statusbar")));
     obj.push_back(Pair("genproclimit",     (int)GetArg("-genproclimit", -1)));
@@ -511,6 +518,40 @@ UniValue getmininginfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
 }
 
 
+UniValue getstakingprofile(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getstakingprofile ( reset )\n"
+            "\nReturns cumulative timings of the staking loop phases since startup or the last reset."
+            "\nArguments:\n"
+            "1. reset           (boolean, optional, default=false) Clear the counters after reading them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"rounds\": n,            (numeric) Number of completed staking rounds\n"
+            "  \"phases\": {\n"
+            "    \"name\": {\n"
+            "      \"calls\": n,         (numeric) Number of times the phase ran\n"
+            "      \"total_ms\": n,      (numeric) Total time spent in the phase\n"
+            "      \"avg_us\": n,        (numeric) Average time per call in microseconds\n"
+            "      \"max_us\": n,        (numeric) Longest single call in microseconds\n"
+            "      \"round_share\": x.x  (numeric) Fraction of total round time spent in the phase\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getstakingprofile", "")
+            + HelpExampleCli("getstakingprofile", "true")
+            + HelpExampleRpc("getstakingprofile", "true")
+        );
+
+    UniValue result = stakingProfiler.ToJSON();
+    if (params.size() > 0 && params[0].get_bool())
+        stakingProfiler.Reset();
+    return result;
+}
+
+
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
@@ -1111,6 +1152,7 @@ static const CRPCCommand commands[] =
     { "mining",             "getnetworksolps",        &getnetworksolps,        true  },
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
     { "mining",             "getmininginfo",          &getmininginfo,          true  },
+    { "mining",             "getstakingprofile",      &getstakingprofile,      true  },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  true  },
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
     { "mining",             "submitblock",            &submitblock,            true  },
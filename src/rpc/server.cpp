@@ -30,6 +30,8 @@
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <atomic>
+#include <deque>
 #include <memory>
 
 #include <univalue.h>
@@ -58,6 +60,14 @@ static std::vector<RPCTimerInterface*> timerInterfaces;
  * @note Can be changed to std::unique_ptr when C++11 */
 static std::map<std::string, boost::shared_ptr<RPCTimerBase> > deadlineTimers;
 
+/* Batch request pool: the thread serving a batch and up to nRPCBatchThreads
+ * helpers claim its elements by index, so replies keep request order. */
+static int nRPCBatchThreads = 0;
+static size_t nRPCMaxBatchSize = DEFAULT_RPC_MAX_BATCH_SIZE;
+static boost::thread_group rpcBatchThreads;
+static void StartRPCBatchThreads();
+static void StopRPCBatchThreads();
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -331,6 +341,9 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
+    { "blockchain",         "getccstats",             &getccstats,             true  },
+    { "blockchain",         "ccreplay",               &ccreplay,               true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "getspentinfo",           &getspentinfo,           false },
     //{ "blockchain",         "paxprice",               &paxprice,               true  },
@@ -379,6 +392,7 @@ static const CRPCCommand vRPCCommands[] =
     /* Mining */
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
     { "mining",             "getmininginfo",          &getmininginfo,          true  },
+    { "mining",             "getstakingprofile",      &getstakingprofile,      true  },
     { "mining",             "getlocalsolps",          &getlocalsolps,          true  },
     { "mining",             "getnetworksolps",        &getnetworksolps,        true  },
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
@@ -656,8 +670,10 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "z_sendmany",             &z_sendmany,             false },
     { "wallet",             "z_shieldcoinbase",       &z_shieldcoinbase,       false },
     { "wallet",             "z_getoperationstatus",   &z_getoperationstatus,   true  },
+    { "wallet",             "z_rescanwallet",         &z_rescanwallet,         true  },
     { "wallet",             "z_getoperationresult",   &z_getoperationresult,   true  },
     { "wallet",             "z_listoperationids",     &z_listoperationids,     true  },
+    { "wallet",             "z_canceloperation",      &z_canceloperation,      true  },
     { "wallet",             "z_getnewaddress",        &z_getnewaddress,        true  },
     { "wallet",             "z_listaddresses",        &z_listaddresses,        true  },
     { "wallet",             "z_exportkey",            &z_exportkey,            true  },
@@ -716,6 +732,10 @@ bool StartRPC()
 
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
+
+    nRPCMaxBatchSize = std::max<int64_t>(1, GetArg("-rpcmaxbatchsize", DEFAULT_RPC_MAX_BATCH_SIZE));
+    nRPCBatchThreads = std::max(0, std::min<int>(MAX_RPC_BATCH_THREADS, GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS)));
+    StartRPCBatchThreads();
 /*
     int n = GetArg("-rpcasyncthreads", 1);
     if (n<1) {
@@ -747,6 +767,9 @@ void StopRPC()
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
+
+    LogPrint("rpc", "%s: waiting for rpc batch threads to stop\n", __func__);
+    StopRPCBatchThreads();
 }
 
 bool IsRPCRunning()
@@ -825,16 +848,137 @@ static UniValue JSONRPCExecOne(const UniValue& req)
         rpc_result = JSONRPCReplyObj(NullUniValue,
                                      JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
     }
+    catch (...)
+    {
+        // Batch elements run on the batch pool, where an escaping exception
+        // would leave the element unanswered and the serving thread waiting
+        rpc_result = JSONRPCReplyObj(NullUniValue,
+                                     JSONRPCError(RPC_INTERNAL_ERROR, "Unknown exception"), jreq.id);
+    }
 
     return rpc_result;
 }
 
+/** One batch request shared between the serving thread and the batch pool */
+class CRPCBatchJob
+{
+public:
+    const UniValue &vReq;
+    std::vector<UniValue> vReply;
+
+    CRPCBatchJob(const UniValue &vReqIn) : vReq(vReqIn), vReply(vReqIn.size()), nNext(0), nDone(0) {}
+
+    //! Run unclaimed elements until none are left
+    void Work()
+    {
+        size_t idx, nRun = 0;
+        while ((idx = nNext++) < vReply.size())
+        {
+            vReply[idx] = JSONRPCExecOne(vReq[idx]);
+            nRun++;
+        }
+        if (nRun > 0)
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nDone += nRun;
+            if (nDone == vReply.size())
+                cond.notify_all();
+        }
+    }
+
+    //! Block until every element has a reply, vReq must stay alive until then
+    void Wait()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (nDone < vReply.size())
+            cond.wait(lock);
+    }
+
+private:
+    std::atomic<size_t> nNext;
+    size_t nDone;
+    boost::mutex cs;
+    boost::condition_variable cond;
+};
+
+static boost::mutex csRPCBatchQueue;
+static boost::condition_variable condRPCBatchQueue;
+static std::deque<std::shared_ptr<CRPCBatchJob> > rpcBatchQueue;
+static bool fRPCBatchStop = false;
+
+static void ThreadRPCBatch()
+{
+    while (true)
+    {
+        std::shared_ptr<CRPCBatchJob> job;
+        {
+            boost::unique_lock<boost::mutex> lock(csRPCBatchQueue);
+            while (!fRPCBatchStop && rpcBatchQueue.empty())
+                condRPCBatchQueue.wait(lock);
+            if (fRPCBatchStop)
+                return;
+            job = rpcBatchQueue.front();
+            rpcBatchQueue.pop_front();
+        }
+        // a job whose elements are all claimed already returns at once
+        job->Work();
+    }
+}
+
+static void StartRPCBatchThreads()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(csRPCBatchQueue);
+        fRPCBatchStop = false;
+    }
+    for (int i = 0; i < nRPCBatchThreads; i++)
+        rpcBatchThreads.create_thread(boost::bind(&TraceThread<void (*)()>, "rpcbatch", &ThreadRPCBatch));
+    if (nRPCBatchThreads > 0)
+        LogPrintf("RPC batch requests run on %d extra threads, at most %u elements\n", nRPCBatchThreads, nRPCMaxBatchSize);
+}
+
+static void StopRPCBatchThreads()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(csRPCBatchQueue);
+        fRPCBatchStop = true;
+        rpcBatchQueue.clear();
+    }
+    condRPCBatchQueue.notify_all();
+    rpcBatchThreads.join_all();
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    // Without the pool batches run one element after another as before, so
+    // the cap only limits how much work a single batch can queue on it
+    if (nRPCBatchThreads > 0 && vReq.size() > nRPCMaxBatchSize)
+        throw JSONRPCError(RPC_INVALID_REQUEST, strprintf("Batch of %u requests exceeds -rpcmaxbatchsize=%u", vReq.size(), nRPCMaxBatchSize));
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    if (nRPCBatchThreads == 0 || vReq.size() < 2)
+    {
+        for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+        return ret.write() + "\n";
+    }
+
+    // The serving thread works on the batch too, so it finishes even if the
+    // pool is busy with other batches or is being stopped.
+    std::shared_ptr<CRPCBatchJob> job = std::make_shared<CRPCBatchJob>(vReq);
+    size_t nHelpers = std::min<size_t>(nRPCBatchThreads, vReq.size() - 1);
+    {
+        boost::unique_lock<boost::mutex> lock(csRPCBatchQueue);
+        if (!fRPCBatchStop)
+            for (size_t i = 0; i < nHelpers; i++)
+                rpcBatchQueue.push_back(job);
+    }
+    condRPCBatchQueue.notify_all();
+    job->Work();
+    job->Wait();
 
+    for (size_t reqIdx = 0; reqIdx < job->vReply.size(); reqIdx++)
+        ret.push_back(job->vReply[reqIdx]);
     return ret.write() + "\n";
 }
 
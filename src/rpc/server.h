@@ -39,6 +39,12 @@
 class AsyncRPCQueue;
 class CRPCCommand;
 
+//! Threads that help run the elements of a batch request (0 runs them one after another)
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
+static const int MAX_RPC_BATCH_THREADS = 64;
+//! Largest number of requests accepted in one batch
+static const int DEFAULT_RPC_MAX_BATCH_SIZE = 1000;
+
 namespace RPCServer
 {
     void OnStarted(boost::function<void ()> slot);
@@ -235,6 +241,7 @@ extern UniValue getlocalsolps(const UniValue& params, bool fHelp, const CPubKey&
 extern UniValue getnetworksolps(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getnetworkhashps(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getmininginfo(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue getstakingprofile(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue prioritisetransaction(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getblocktemplate(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue submitblock(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -421,6 +428,9 @@ extern UniValue getblockheader(const UniValue& params, bool fHelp, const CPubKey
 extern UniValue getlastsegidstakes(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue getdbstats(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue getccstats(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue ccreplay(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue gettxout(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue verifychain(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getchaintips(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -488,8 +498,10 @@ extern UniValue z_mergetoaddress(const UniValue& params, bool fHelp, const CPubK
 extern UniValue z_sendmany(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue z_shieldcoinbase(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue z_getoperationstatus(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
+extern UniValue z_rescanwallet(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue z_getoperationresult(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue z_listoperationids(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
+extern UniValue z_canceloperation(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue opreturn_burn(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue z_validateaddress(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcmisc.cpp
 extern UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcdisclosure.cpp
@@ -1150,6 +1150,14 @@ uint256 GetOutputsHash(const CTransaction& txTo) {
     return ss.GetHash();
 }
 
+CBLAKE2bWriter GetOutputsHashPrefix(const CTransaction& txTo, size_t nOutputs) {
+    CBLAKE2bWriter ss(SER_GETHASH, 0, ZCASH_OUTPUTS_HASH_PERSONALIZATION);
+    for (unsigned int n = 0; n < nOutputs && n < txTo.vout.size(); n++) {
+        ss << txTo.vout[n];
+    }
+    return ss;
+}
+
 uint256 GetJoinSplitsHash(const CTransaction& txTo) {
     CBLAKE2bWriter ss(SER_GETHASH, static_cast<int>(txTo.GetHeader()), ZCASH_JOINSPLITS_HASH_PERSONALIZATION);
     for (unsigned int n = 0; n < txTo.vjoinsplit.size(); n++) {
@@ -1392,19 +1400,37 @@ int TransactionSignatureChecker::CheckCryptoCondition(
         fprintf(stderr,"%02x",((uint8_t *)&sighash)[z]);
     fprintf(stderr," sighash nIn.%d nHashType.%d %.8f id.%d\n",(int32_t)nIn,(int32_t)nHashType,(double)amount/COIN,(int32_t)consensusBranchId);
      */
+    if (!VerifyCryptoCondition(cond, sighash, condBin, ffillBin)) {
+        cc_free(cond);
+        return 0;
+    }
+    // Eval callbacks depend on chain state, so they run on every check even
+    // when the signatures above were answered from a cache
     VerifyEval eval = [] (CC *cond, void *checker) {
         //fprintf(stderr,"checker.%p\n",(TransactionSignatureChecker*)checker);
         return ((TransactionSignatureChecker*)checker)->CheckEvalCondition(cond);
     };
-    //fprintf(stderr,"non-checker path\n");
-    int out = cc_verify(cond, (const unsigned char*)&sighash, 32, 0,
-                        condBin.data(), condBin.size(), eval, (void*)this);
-    //fprintf(stderr,"out.%d from cc_verify\n",(int32_t)out);
+    int out = cc_verifyEval(cond, eval, (void*)this);
+    //fprintf(stderr,"out.%d from cc_verifyEval\n",(int32_t)out);
     cc_free(cond);
     return out;
 }
 
 
+bool TransactionSignatureChecker::VerifyCryptoCondition(
+        const CC *cond,
+        const uint256& sighash,
+        const std::vector<unsigned char>& condBin,
+        const std::vector<unsigned char>& ffillBin) const
+{
+    VerifyEval skipEval = [] (CC *cond, void *checker) {
+        return 1;
+    };
+    return cc_verify(cond, (const unsigned char*)&sighash, 32, 0,
+                     condBin.data(), condBin.size(), skipEval, NULL) != 0;
+}
+
+
 int TransactionSignatureChecker::CheckEvalCondition(const CC *cond) const
 {
     //fprintf(stderr, "Cannot check crypto-condition Eval outside of server, returning true in pre-checks\n");
@@ -21,6 +21,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include "hash.h"
 #include "script_error.h"
 #include "primitives/transaction.h"
 #include "script/cc.h"
@@ -113,6 +114,13 @@ struct PrecomputedTransactionData
     PrecomputedTransactionData(const CTransaction& tx);
 };
 
+/**
+ * Returns the ZIP 143 hashOutputs writer after the first nOutputs outputs of txTo.
+ * Callers that only vary the trailing outputs can copy the midstate and finish it
+ * instead of rehashing every output.
+ */
+CBLAKE2bWriter GetOutputsHashPrefix(const CTransaction& txTo, size_t nOutputs);
+
 enum SigVersion
 {
     SIGVERSION_SPROUT = 0,
@@ -167,6 +175,8 @@ protected:
     const PrecomputedTransactionData* txdata;
 
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
+    // Checks the condition binary and every signature in the fulfillment tree; eval nodes are not visited
+    virtual bool VerifyCryptoCondition(const CC *cond, const uint256& sighash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin) const;
 
 public:
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), txdata(NULL) {}
@@ -20,6 +20,8 @@
 
 #include "sigcache.h"
 
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
@@ -28,80 +30,134 @@
 #undef __cpuid
 #endif
 #include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
 
 namespace {
 
 /**
- * Valid signature cache, to avoid doing expensive ECDSA signature checking
- * twice for every transaction (once when accepted into memory pool, and
- * again when accepted into the block chain)
+ * Valid signature cache, to avoid doing expensive ECDSA and crypto-condition
+ * signature checking twice for every transaction (once when accepted into
+ * memory pool, and again when accepted into the block chain)
  */
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
+    //! Entries are SHA256(nonce || tag || sighash || ...) computed by the caller
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
     boost::shared_mutex cs_sigcache;
+    //! False with -maxsigcachesize=0, which turns the cache off
+    bool fEnabled;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CSignatureCache()
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+        GetRandBytes(nonce.begin(), 32);
+        fEnabled = true;
+        size_t nElems;
+        if (mapArgs.count("-maxsigcachesize") && !mapArgs.count("-maxsigcachemb")) {
+            // -maxsigcachesize keeps counting entries, as it did before the cache was sized in MiB
+            int64_t nMaxEntries = (MAX_MAX_SIG_CACHE_SIZE << 20) / sizeof(uint256);
+            int64_t nEntries = std::min(std::max((int64_t)0, GetArg("-maxsigcachesize", 0)), nMaxEntries);
+            if (nEntries == 0) {
+                // the cuckoo cache cannot be empty, so a size of 0 skips it altogether
+                fEnabled = false;
+                LogPrintf("Signature cache disabled (-maxsigcachesize=0)\n");
+                return;
+            }
+            nElems = setValid.setup(nEntries);
+            LogPrintf("Using %zu MiB for signature cache, able to store %zu elements (-maxsigcachesize=%d)\n",
+                      (nElems * sizeof(uint256)) >> 20, nElems, nEntries);
+        } else {
+            size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxsigcachemb", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+            nElems = setValid.setup_bytes(nMaxCacheSize);
+            LogPrintf("Using %zu MiB out of %zu requested for signature cache, able to store %zu elements\n",
+                      (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
+        }
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there can be no more than 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        static const unsigned char tag = 'E';
+        CSHA256().Write(nonce.begin(), 32).Write(&tag, 1).Write(hash.begin(), 32).Write(&pubkey[0], pubkey.size()).Write(&vchSig[0], vchSig.size()).Finalize(entry.begin());
+    }
 
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin)
+    {
+        static const unsigned char tag = 'C';
+        uint32_t nCondSize = condBin.size();
+        CSHA256().Write(nonce.begin(), 32).Write(&tag, 1).Write(hash.begin(), 32)
+                 .Write((const unsigned char*)&nCondSize, sizeof(nCondSize))
+                 .Write(condBin.data(), condBin.size())
+                 .Write(ffillBin.data(), ffillBin.size())
+                 .Finalize(entry.begin());
+    }
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
-        }
+    bool
+    Get(const uint256& entry, const bool erase)
+    {
+        if (!fEnabled)
+            return false;
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, erase);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    void Set(const uint256& entry)
+    {
+        if (!fEnabled)
+            return;
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
     }
 };
 
+CSignatureCache& GetSignatureCache()
+{
+    static CSignatureCache signatureCache;
+    return signatureCache;
+}
+
+}
+
+void InitSignatureCache()
+{
+    GetSignatureCache();
+}
+
+void ComputeSignatureCacheEntry(uint256& entry, const uint256& sighash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+{
+    GetSignatureCache().ComputeEntry(entry, sighash, vchSig, pubkey);
+}
+
+void ComputeCryptoConditionCacheEntry(uint256& entry, const uint256& sighash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin)
+{
+    GetSignatureCache().ComputeEntry(entry, sighash, condBin, ffillBin);
+}
+
+bool SignatureCacheGet(const uint256& entry, bool fErase)
+{
+    return GetSignatureCache().Get(entry, fErase);
+}
+
+void SignatureCacheSet(const uint256& entry)
+{
+    GetSignatureCache().Set(entry);
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
+    uint256 entry;
+    ComputeSignatureCacheEntry(entry, sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    if (SignatureCacheGet(entry, !store))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        SignatureCacheSet(entry);
     return true;
 }
@@ -22,11 +22,52 @@
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
 #include "script/interpreter.h"
+#include "uint256.h"
 
+#include <cstring>
 #include <vector>
 
+// DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
+// systems). Due to how we count cache size, actual memory usage is slightly
+// more (~32.25 MB)
+static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+// Maximum sig cache size allowed
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
 class CPubKey;
 
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ *
+ * This may exhibit platform endian dependent behavior but because these are
+ * nonced hashes (random) and this state is only ever used locally it is safe.
+ * All that matters is local consistency.
+ */
+class SignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "SignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+/**
+ * Entries of the shared signature cache. ECDSA checks and the signature part
+ * of crypto-condition checks are hashed with the same nonce but different
+ * domain tags, so both kinds live in one fixed-size table.
+ */
+void ComputeSignatureCacheEntry(uint256& entry, const uint256& sighash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey);
+void ComputeCryptoConditionCacheEntry(uint256& entry, const uint256& sighash, const std::vector<unsigned char>& condBin, const std::vector<unsigned char>& ffillBin);
+//! Returns true on a hit; with fErase the slot may be reused by later inserts
+bool SignatureCacheGet(const uint256& entry, bool fErase);
+void SignatureCacheSet(const uint256& entry);
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -38,4 +79,6 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+void InitSignatureCache();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
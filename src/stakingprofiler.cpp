@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "stakingprofiler.h"
+
+#include "utiltime.h"
+
+CStakingProfiler stakingProfiler;
+
+static const char *phaseNames[STAKING_NUM_PHASES] = { "round", "segids", "utxoscan", "eligibility", "txtime", "sign" };
+
+// set while this thread runs komodo_staked
+static thread_local bool fInStakingRound = false;
+
+void CStakingProfiler::Add(StakingPhase phase, int64_t nMicros)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    nCalls[phase]++;
+    nTotalMicros[phase] += nMicros;
+    uint64_t nMax = nMaxMicros[phase];
+    while ((uint64_t)nMicros > nMax && !nMaxMicros[phase].compare_exchange_weak(nMax, nMicros))
+        ;
+}
+
+void CStakingProfiler::Reset()
+{
+    for (int i = 0; i < STAKING_NUM_PHASES; i++)
+    {
+        nCalls[i] = 0;
+        nTotalMicros[i] = 0;
+        nMaxMicros[i] = 0;
+    }
+}
+
+UniValue CStakingProfiler::ToJSON() const
+{
+    UniValue result(UniValue::VOBJ), phases(UniValue::VOBJ);
+    uint64_t nRoundMicros = nTotalMicros[STAKING_ROUND];
+    result.push_back(Pair("rounds", (uint64_t)nCalls[STAKING_ROUND]));
+    for (int i = 0; i < STAKING_NUM_PHASES; i++)
+    {
+        UniValue obj(UniValue::VOBJ);
+        uint64_t calls = nCalls[i], total = nTotalMicros[i];
+        obj.push_back(Pair("calls", calls));
+        obj.push_back(Pair("total_ms", total / 1000.0));
+        obj.push_back(Pair("avg_us", calls != 0 ? (double)total / calls : 0.0));
+        obj.push_back(Pair("max_us", (uint64_t)nMaxMicros[i]));
+        obj.push_back(Pair("round_share", nRoundMicros != 0 ? (double)total / nRoundMicros : 0.0));
+        phases.push_back(Pair(phaseNames[i], obj));
+    }
+    result.push_back(Pair("phases", phases));
+    return result;
+}
+
+CStakingPhaseTimer::CStakingPhaseTimer(StakingPhase phaseIn) : phase(phaseIn), nStart(0)
+{
+    fActive = (phase == STAKING_ROUND) ? !fInStakingRound : fInStakingRound;
+    if (!fActive)
+        return;
+    if (phase == STAKING_ROUND)
+        fInStakingRound = true;
+    nStart = GetTimeMicros();
+}
+
+void CStakingPhaseTimer::Stop()
+{
+    if (!fActive)
+        return;
+    fActive = false;
+    stakingProfiler.Add(phase, GetTimeMicros() - nStart);
+    if (phase == STAKING_ROUND)
+        fInStakingRound = false;
+}
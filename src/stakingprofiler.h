@@ -0,0 +1,75 @@
+/******************************************************************************
+ * Copyright © 2014-2020 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef KOMODO_STAKINGPROFILER_H
+#define KOMODO_STAKINGPROFILER_H
+
+#include <univalue.h>
+
+#include <atomic>
+#include <stdint.h>
+
+/** Phases of a staking round, as timed inside komodo_staked. Phases nest: a
+ *  round includes all the others and eligibility includes txtime. */
+enum StakingPhase
+{
+    STAKING_ROUND = 0,      //!< one komodo_staked call
+    STAKING_SEGIDS,         //!< komodo_segids for the current height
+    STAKING_UTXOSCAN,       //!< rebuilding the staking utxo array from the wallet
+    STAKING_ELIGIBILITY,    //!< komodo_stake calls over all staking utxos
+    STAKING_TXTIME,         //!< komodo_txtime2 lookups made by those calls
+    STAKING_SIGN,           //!< building and signing the stake transaction
+    STAKING_NUM_PHASES
+};
+
+/** Call counts and accumulated time per staking phase. */
+class CStakingProfiler
+{
+private:
+    std::atomic<uint64_t> nCalls[STAKING_NUM_PHASES];
+    std::atomic<uint64_t> nTotalMicros[STAKING_NUM_PHASES];
+    std::atomic<uint64_t> nMaxMicros[STAKING_NUM_PHASES];
+
+public:
+    CStakingProfiler() { Reset(); }
+
+    void Add(StakingPhase phase, int64_t nMicros);
+    void Reset();
+    UniValue ToJSON() const;
+};
+
+extern CStakingProfiler stakingProfiler;
+
+/**
+ * Times its scope into stakingProfiler. Only records while the current thread
+ * is inside a staking round, so the komodo_stake calls made by block
+ * validation do not pollute the numbers.
+ */
+class CStakingPhaseTimer
+{
+private:
+    StakingPhase phase;
+    int64_t nStart;
+    bool fActive;
+
+public:
+    explicit CStakingPhaseTimer(StakingPhase phaseIn);
+    ~CStakingPhaseTimer() { Stop(); }
+
+    //! Record the elapsed time now instead of at the end of the scope.
+    void Stop();
+};
+
+#endif // KOMODO_STAKINGPROFILER_H
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "cc/CCindex.h"
+#include "cc/CCMarmara.h"
+#include "key.h"
+#include "main.h"
+#include "random.h"
+
+
+namespace TestCCIndex {
+
+
+class TestCCIndex : public ::testing::Test {
+public:
+    uint8_t prevMarmara;
+    CCIndexDB *prevIndex;
+    CPubKey pk;
+    CBlock block;
+
+    void SetUp() {
+        prevMarmara = ASSETCHAINS_MARMARA;
+        prevIndex = pccindex;
+        ASSETCHAINS_MARMARA = 1;
+        pccindex = new CCIndexDB(1 << 20, true, true);
+        CCIndexInit(true, NULL);
+
+        CKey key;
+        key.MakeNewKey(true);
+        pk = key.GetPubKey();
+
+        // an activated coin, paid to the miner by the coinbase of an even block
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vout.push_back(CTxOut(1000 * COIN, MarmaraCreateDefaultCoinbaseScriptPubKey(2, pk)));
+        block.vtx.push_back(coinbase);
+        block.hashPrevBlock = GetRandHash();
+    }
+
+    void TearDown() {
+        delete pccindex;
+        pccindex = prevIndex;
+        ASSETCHAINS_MARMARA = prevMarmara;
+    }
+
+    CAmount Activated() {
+        CMarmaraIndexBalance balance;
+        EXPECT_TRUE(GetMarmaraIndexBalance(pk, balance));
+        return balance.nActivated;
+    }
+};
+
+
+TEST_F(TestCCIndex, testConnectSameBlockTwice)
+{
+    ConnectCCIndexes(block, 2);
+    EXPECT_EQ(1000 * COIN, Activated());
+
+    // a block the index already went through is not counted again
+    ConnectCCIndexes(block, 2);
+    EXPECT_EQ(1000 * COIN, Activated());
+    EXPECT_TRUE(CCIndexComplete());
+
+    uint256 hash; int32_t height;
+    ASSERT_TRUE(pccindex->ReadBestBlock(hash, height));
+    EXPECT_EQ(block.GetHash(), hash);
+    EXPECT_EQ(2, height);
+
+    DisconnectCCIndexes(block, 2);
+    EXPECT_EQ(0, Activated());
+    DisconnectCCIndexes(block, 2);
+    EXPECT_EQ(0, Activated());
+    EXPECT_TRUE(CCIndexComplete());
+}
+
+
+TEST_F(TestCCIndex, testConnectUnrelatedBlock)
+{
+    ConnectCCIndexes(block, 2);
+
+    // a block that does not follow the indexed one means the index missed blocks
+    CBlock other = block;
+    other.hashPrevBlock = GetRandHash();
+    ConnectCCIndexes(other, 4);
+    EXPECT_FALSE(CCIndexComplete());
+}
+
+
+} /* namespace TestCCIndex */
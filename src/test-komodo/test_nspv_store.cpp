@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+
+#include "chainparams.h"
+#include "dbwrapper.h"
+#include "main.h"
+#include "net.h"
+#include "random.h"
+#include "univalue.h"
+#include "komodo_nSPV_defs.h"
+
+
+extern int32_t KOMODO_NSPV;
+extern CDBWrapper *NSPV_store;
+int32_t NSPV_rwtxproof(int32_t rwflag,uint8_t *serialized,struct NSPV_txproof *ptr);
+void NSPV_txproof_purge(struct NSPV_txproof *ptr);
+bool NSPV_store_gettxproof(uint256 txid,struct NSPV_txproof *ptr);
+void NSPV_store_puttxproof(struct NSPV_txproof *ptr);
+void komodo_nSPVresp(CNode *pfrom,std::vector<uint8_t> response);
+
+
+namespace TestNSPVStore {
+
+
+bool ReadAll(SOCKET s, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = recv(s, buf, len, 0);
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+
+class TestNSPVStore : public ::testing::Test {
+public:
+    int32_t prevNSPV;
+    CDBWrapper *prevStore;
+    SOCKET fds[2];
+    CNode *peer;
+    std::thread responder;
+    std::atomic<int64_t> peerUnspent;
+    std::atomic<int> nRequests;
+
+    CTransaction tx;
+    std::vector<uint8_t> txbytes, proofbytes;
+
+    void SetUp() {
+        prevNSPV = KOMODO_NSPV;
+        prevStore = NSPV_store;
+        KOMODO_NSPV = 1;
+        NSPV_store = new CDBWrapper("", 1 << 20, true, true);
+
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vout.push_back(CTxOut(5000, CScript() << OP_TRUE));
+        tx = mtx;
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << tx;
+        txbytes.assign(ss.begin(), ss.end());
+        proofbytes.assign(64, 0x5a);
+
+        // the fullnode on the other end of a socketpair, answering txproof requests with the
+        // current spentness of the output
+        peerUnspent = 0;
+        nRequests = 0;
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        peer = new CNode(fds[0], CAddress(), "loopback", true);
+        peer->nServices = NODE_NSPV;
+        memset(peer->prevtimes, 0, sizeof(peer->prevtimes));
+        {
+            LOCK(cs_vNodes);
+            vNodes.push_back(peer);
+        }
+        responder = std::thread(&TestNSPVStore::Respond, this);
+    }
+
+    void TearDown() {
+        {
+            LOCK(cs_vNodes);
+            vNodes.erase(std::find(vNodes.begin(), vNodes.end(), peer));
+        }
+        shutdown(fds[0], SHUT_RDWR);
+        responder.join();
+        delete peer;
+        close(fds[1]);
+        delete NSPV_store;
+        NSPV_store = prevStore;
+        KOMODO_NSPV = prevNSPV;
+    }
+
+    struct NSPV_txproof Proof(int64_t unspentvalue) {
+        struct NSPV_txproof P;
+        memset(&P, 0, sizeof(P));
+        P.txid = tx.GetHash();
+        P.unspentvalue = unspentvalue;
+        P.height = 10;
+        P.txlen = txbytes.size();
+        P.tx = &txbytes[0];
+        P.txprooflen = proofbytes.size();
+        P.txproof = &proofbytes[0];
+        P.hashblock = GetRandHash();
+        return P;
+    }
+
+    void Respond() {
+        uint8_t hdr[CMessageHeader::HEADER_SIZE];
+        while (ReadAll(fds[1], hdr, sizeof(hdr))) {
+            CMessageHeader header(Params().MessageStart());
+            CDataStream hs((const char *)hdr, (const char *)hdr + sizeof(hdr), SER_NETWORK, PROTOCOL_VERSION);
+            hs >> header;
+            std::vector<char> payload(header.nMessageSize);
+            if (!payload.empty() && !ReadAll(fds[1], (uint8_t *)&payload[0], payload.size()))
+                break;
+            if (header.GetCommand() != "getnSPV")
+                continue;
+            std::vector<uint8_t> request;
+            CDataStream(payload, SER_NETWORK, PROTOCOL_VERSION) >> request;
+            if (request.empty() || request[0] != NSPV_TXPROOF)
+                continue;
+            nRequests++;
+            struct NSPV_txproof P = Proof(peerUnspent);
+            std::vector<uint8_t> response(1 + sizeof(P) + P.txlen + P.txprooflen);
+            response[0] = NSPV_TXPROOFRESP;
+            response.resize(1 + NSPV_rwtxproof(1, &response[1], &P));
+            komodo_nSPVresp(peer, response);
+        }
+    }
+
+    int32_t GetTransaction() {
+        CTransaction out; uint256 hashblock; int32_t txheight, currentheight; int64_t rewardsum = 0;
+        memset(peer->prevtimes, 0, sizeof(peer->prevtimes));
+        return NSPV_gettransaction(0, 0, tx.GetHash(), 10, out, hashblock, txheight, currentheight, 0, 0, rewardsum);
+    }
+};
+
+
+TEST_F(TestNSPVStore, testUnspentValueNotStored)
+{
+    struct NSPV_txproof P = Proof(5000), Q;
+    NSPV_store_puttxproof(&P);
+    ASSERT_TRUE(NSPV_store_gettxproof(tx.GetHash(), &Q));
+    EXPECT_EQ(0, Q.unspentvalue);
+    EXPECT_EQ(P.height, Q.height);
+    EXPECT_EQ(P.hashblock, Q.hashblock);
+    ASSERT_EQ(P.txprooflen, Q.txprooflen);
+    EXPECT_EQ(0, memcmp(P.txproof, Q.txproof, Q.txprooflen));
+    NSPV_txproof_purge(&Q);
+}
+
+
+TEST_F(TestNSPVStore, testSpentAfterStored)
+{
+    struct NSPV_txproof P = Proof(5000);
+    NSPV_store_puttxproof(&P);
+
+    // the stored proof skips the notarization checks but spentness comes from the peer
+    peerUnspent = 5000;
+    EXPECT_EQ(0, GetTransaction());
+    EXPECT_EQ(1, nRequests);
+
+    // the output gets spent: the cache hit must not hide it
+    peerUnspent = 0;
+    EXPECT_EQ(-2002, GetTransaction());
+    EXPECT_EQ(2, nRequests);
+}
+
+
+} /* namespace TestNSPVStore */
@@ -2,6 +2,7 @@
 #include "crypto/sha256.h"
 #include "uint256.h"
 #include <stdexcept>
+#include <vector>
 #include "random.h"
 #include "utilstrencodings.h"
 
@@ -155,4 +156,31 @@ namespace TestSHA256Crypto {
             "d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592");
     }
 
+
+    TEST(TestSHA256Crypto, sha256d64) // crypto_tests.cpp
+    {
+        const sha256_implementation::UseImplementation impls[] = {
+            sha256_implementation::STANDARD, sha256_implementation::USE_SSE2,
+            sha256_implementation::USE_AVX2, sha256_implementation::USE_SHANI,
+            sha256_implementation::USE_ALL
+        };
+        for (auto impl : impls) {
+            sha256_implementation::Kernels kernels = sha256_implementation::DetectKernels(impl);
+            // block counts around the 4-way and 8-way batch boundaries
+            for (int blocks = 0; blocks <= 20; blocks++) {
+                std::vector<unsigned char> in(64 * blocks + 1), out1(32 * blocks), out2(32 * blocks);
+                for (size_t i = 0; i < in.size(); i++)
+                    in[i] = (unsigned char)insecure_rand();
+                for (int i = 0; i < blocks; i++) {
+                    unsigned char first[CSHA256::OUTPUT_SIZE];
+                    CSHA256().Write(in.data() + 1 + 64 * i, 64).Finalize(first);
+                    CSHA256().Write(first, sizeof(first)).Finalize(out1.data() + 32 * i);
+                }
+                // unaligned input, as the merkle tree hands us vector storage
+                kernels.D64(out2.data(), in.data() + 1, blocks);
+                ASSERT_TRUE(out1 == out2) << kernels.name << ", " << blocks << " blocks";
+            }
+        }
+    }
+
 }
\ No newline at end of file
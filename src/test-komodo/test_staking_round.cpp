@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "init.h"
+#include "main.h"
+#include "stakingprofiler.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validationinterface.h"
+#include "wallet/wallet.h"
+
+#include "testutils.h"
+
+
+extern int64_t nMockTime;
+int32_t komodo_staked(CMutableTransaction &txNew,uint32_t nBits,uint32_t *blocktimep,uint32_t *txtimep,uint256 *utxotxidp,int32_t *utxovoutp,uint64_t *utxovaluep,uint8_t *utxosig, uint256 merkleroot);
+
+
+namespace TestStakingRound {
+
+
+/*
+ * Whole komodo_staked rounds over a regtest chain and a wallet holding one
+ * staking UTXO per block. The size comes from the environment so the same
+ * test can time 100, 1000 or more coins:
+ *   KOMODO_TEST_STAKE_UTXOS   staking UTXOs in the wallet (default 20)
+ *   KOMODO_TEST_STAKE_ROUNDS  rounds timed (default 5)
+ */
+int GetEnvInt(const char *name, int nDefault)
+{
+    const char *value = getenv(name);
+    return value ? atoi(value) : nDefault;
+}
+
+
+class TestStakingRound : public ::testing::Test {
+protected:
+    static int nUtxos;
+
+    static void SetUpTestCase() {
+        setupChain();
+        // fixed block times give the same coinbase txids, and so the same
+        // eligibility, on every run
+        nMockTime = 1600000000;
+
+        pwalletMain = new CWallet();
+        pwalletMain->AddKey(notaryKey);
+        RegisterValidationInterface(pwalletMain);
+
+        // every coinbase pays notaryKey, one more block matures the last one
+        nUtxos = GetEnvInt("KOMODO_TEST_STAKE_UTXOS", 20);
+        for (int i = 0; i <= nUtxos; i++)
+            generateBlock();
+    }
+
+    static void TearDownTestCase() {
+        UnregisterValidationInterface(pwalletMain);
+        delete pwalletMain;
+        pwalletMain = NULL;
+    }
+
+    int32_t StakeRound(CMutableTransaction &txStaked, uint256 &utxotxid) {
+        uint32_t blocktime = chainActive.Tip()->nTime + 60, txtime = 0;
+        int32_t utxovout = 0;
+        uint64_t utxovalue = 0;
+        uint8_t utxosig[512];
+        return komodo_staked(txStaked, chainActive.Tip()->nBits, &blocktime, &txtime, &utxotxid, &utxovout, &utxovalue, utxosig, uint256());
+    }
+};
+
+int TestStakingRound::nUtxos = 0;
+
+
+TEST_F(TestStakingRound, testTimedRounds)
+{
+    {
+        std::vector<COutput> vecOutputs;
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        pwalletMain->AvailableCoins(vecOutputs, false, NULL, true);
+        ASSERT_GE(vecOutputs.size(), (size_t)nUtxos);
+    }
+
+    int nRounds = GetEnvInt("KOMODO_TEST_STAKE_ROUNDS", 5);
+    mapArgs["-gen"] = "1";
+    stakingProfiler.Reset();
+    int64_t nTotalMicros = 0;
+    int32_t firstSiglen = 0;
+    uint256 firstUtxo;
+    for (int i = 0; i < nRounds; i++) {
+        CMutableTransaction txStaked;
+        uint256 utxotxid;
+        int64_t nStart = GetTimeMicros();
+        int32_t siglen = StakeRound(txStaked, utxotxid);
+        nTotalMicros += GetTimeMicros() - nStart;
+
+        // every round sees the same chain and wallet, so they all agree
+        if (i == 0) {
+            firstSiglen = siglen;
+            firstUtxo = utxotxid;
+        }
+        EXPECT_EQ(firstSiglen > 0, siglen > 0);
+        EXPECT_EQ(firstUtxo, utxotxid);
+    }
+    mapArgs.erase("-gen");
+
+    printf("komodo_staked over %d UTXOs: %.3f ms per round\n", nUtxos, nTotalMicros / 1000.0 / nRounds);
+    printf("%s\n", stakingProfiler.ToJSON().write(1).c_str());
+}
+
+
+} /* namespace TestStakingRound */
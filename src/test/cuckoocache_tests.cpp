@@ -0,0 +1,80 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+#include "script/sigcache.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <deque>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoocache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_contains)
+{
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc;
+    cc.setup_bytes(1 << 20);
+
+    std::vector<uint256> inserted;
+    for (int i = 0; i < 1000; i++) {
+        inserted.push_back(GetRandHash());
+        cc.insert(inserted.back());
+    }
+    // Well under capacity, so nothing may have been evicted
+    for (const uint256& h : inserted)
+        BOOST_CHECK(cc.contains(h, false));
+    for (int i = 0; i < 1000; i++)
+        BOOST_CHECK(!cc.contains(GetRandHash(), false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_erase_is_lazy)
+{
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc;
+    cc.setup(1024);
+
+    uint256 h = GetRandHash();
+    cc.insert(h);
+    BOOST_CHECK(cc.contains(h, true));
+    // Erasure only marks the slot; the element is still found until reused
+    BOOST_CHECK(cc.contains(h, false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_hit_rate_when_full)
+{
+    // Insert twice the capacity; most of the newest half must survive
+    const uint32_t nSlots = 1 << 14;
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc;
+    BOOST_CHECK_EQUAL(cc.setup(nSlots), nSlots);
+
+    std::deque<uint256> recent;
+    for (uint32_t i = 0; i < 2 * nSlots; i++) {
+        uint256 h = GetRandHash();
+        cc.insert(h);
+        recent.push_back(h);
+        if (recent.size() > nSlots / 2)
+            recent.pop_front();
+    }
+    size_t nFound = 0;
+    for (const uint256& h : recent)
+        nFound += cc.contains(h, false);
+    BOOST_CHECK(nFound * 10 > recent.size() * 9);
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_domains_are_separate)
+{
+    uint256 sighash = GetRandHash();
+    std::vector<unsigned char> data(33, 0x02);
+    uint256 ecdsaEntry, ccEntry;
+    ComputeSignatureCacheEntry(ecdsaEntry, sighash, data, CPubKey(data.begin(), data.end()));
+    ComputeCryptoConditionCacheEntry(ccEntry, sighash, std::vector<unsigned char>(), data);
+    BOOST_CHECK(ecdsaEntry != ccEntry);
+
+    SignatureCacheSet(ecdsaEntry);
+    BOOST_CHECK(SignatureCacheGet(ecdsaEntry, false));
+    BOOST_CHECK(!SignatureCacheGet(ccEntry, false));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
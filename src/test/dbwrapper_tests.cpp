@@ -229,6 +229,35 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
-
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning_stats)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, CDBTuning(4 << 20, 1 << 20, true, 64), true, false);
+    char key = 'k';
+    uint256 in = GetRandHash();
+    uint256 res;
+    BOOST_CHECK(dbw.Write(key, in));
+    BOOST_CHECK(dbw.Read(key, res));
+    BOOST_CHECK(!dbw.Exists('m'));
+
+    boost::scoped_ptr<CDBIterator> it(dbw.NewIterator());
+    it->Seek(key);
+    BOOST_CHECK(it->Valid());
+
+    CDBStats stats;
+    dbw.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nReads, 3);
+    BOOST_CHECK_EQUAL(stats.tuning.nCacheSize, 4 << 20);
+    BOOST_CHECK_EQUAL(stats.tuning.nWriteBufferSize, 1 << 20);
+    BOOST_CHECK(stats.tuning.fCompression);
+
+    // a cleared batch writes nothing
+    CDBBatch batch(dbw);
+    batch.Erase(key);
+    batch.Clear();
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK(dbw.Read(key, res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -222,4 +222,42 @@ BOOST_AUTO_TEST_CASE(SetSanityCheck) {
     BOOST_CHECK_EQUAL(pool.GetCheckFrequency(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolInputsCheckedTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    CMutableTransaction tx2 = tx1;
+    tx2.vout[0].nValue = 5 * COIN;
+    uint256 tipA = uint256S("0a"), tipB = uint256S("0b");
+
+    // Only transactions in the pool are recorded
+    pool.SetInputsChecked(tx1.GetHash(), CMempoolInputsCheck(tipA, 1, false));
+    BOOST_CHECK(!pool.InputsCheckedFor(tx1.GetHash(), tipA, 1));
+
+    pool.addUnchecked(tx1.GetHash(), entry.FromTx(tx1));
+    pool.addUnchecked(tx2.GetHash(), entry.FromTx(tx2));
+    pool.SetInputsChecked(tx1.GetHash(), CMempoolInputsCheck(tipA, 1, false));
+    pool.SetInputsChecked(tx2.GetHash(), CMempoolInputsCheck(tipA, 1, true));
+
+    // Results that only depend on the spent outputs survive a new tip,
+    // tip-bound ones don't; neither survives a branch change
+    BOOST_CHECK(pool.InputsCheckedFor(tx1.GetHash(), tipA, 1));
+    BOOST_CHECK(pool.InputsCheckedFor(tx1.GetHash(), tipB, 1));
+    BOOST_CHECK(!pool.InputsCheckedFor(tx1.GetHash(), tipA, 2));
+    BOOST_CHECK(pool.InputsCheckedFor(tx2.GetHash(), tipA, 1));
+    BOOST_CHECK(!pool.InputsCheckedFor(tx2.GetHash(), tipB, 1));
+
+    std::list<CTransaction> removed;
+    pool.remove(tx1, removed);
+    BOOST_CHECK(!pool.InputsCheckedFor(tx1.GetHash(), tipA, 1));
+
+    pool.ClearInputsChecked();
+    BOOST_CHECK(!pool.InputsCheckedFor(tx2.GetHash(), tipA, 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -22,11 +22,14 @@
 
 #include "chainparams.h"
 #include "hash.h"
+#include "key_io.h"
 #include "main.h"
 #include "pow.h"
 #include "uint256.h"
 #include "core_io.h"
 
+#include <algorithm>
+#include <set>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -47,6 +50,9 @@ static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_ADDRESSBALANCE = 'w';
+static const char DB_ADDRESSBALANCEDELTA = 'W';
+static const char DB_ADDRESSBALANCEHEIGHT = 'h';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -215,6 +221,137 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+    paddressdb = pspentdb = ptimestampdb = this;
+}
+
+CBlockTreeDB::~CBlockTreeDB() {
+    if (paddressdb != this)
+        delete paddressdb;
+    if (pspentdb != this)
+        delete pspentdb;
+    if (ptimestampdb != this)
+        delete ptimestampdb;
+}
+
+static bool HasEntries(CDBWrapper &db, char chType) {
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(chType);
+    char chKey;
+    return pcursor->Valid() && pcursor->GetKey(chKey) && chKey == chType;
+}
+
+// Copies every chType entry of from into to. Entries are only erased from
+// the block index once all of them are copied and the layout flag is set,
+// so an interrupted migration leaves the old layout intact.
+template <typename K, typename V>
+static bool CopyIndexEntries(CDBWrapper &from, CDBWrapper &to, char chType, const char *name) {
+    boost::scoped_ptr<CDBIterator> pcursor(from.NewIterator());
+    CDBBatch batch(to);
+    size_t nCopied = 0;
+    pcursor->Seek(chType);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != chType)
+            break;
+        V value;
+        if (!pcursor->GetValue(value))
+            return error("%s: cannot read %s entry", __func__, name);
+        batch.Write(key, value);
+        if (++nCopied % 100000 == 0) {
+            to.WriteBatch(batch);
+            batch.Clear();
+            LogPrintf("Migrating %s: %u entries copied\n", name, nCopied);
+        }
+        pcursor->Next();
+    }
+    to.WriteBatch(batch, true);
+    LogPrintf("Migrating %s: done, %u entries\n", name, nCopied);
+    return true;
+}
+
+// Entries the split indexes keep in their own databases, left in the block
+// index database by older versions or by an interrupted migration
+static bool HasLegacyIndexEntries(CDBWrapper &db) {
+    return HasEntries(db, DB_ADDRESSINDEX) || HasEntries(db, DB_ADDRESSUNSPENTINDEX) || HasEntries(db, DB_SPENTINDEX) ||
+           HasEntries(db, DB_TIMESTAMPINDEX) || HasEntries(db, DB_BLOCKHASHINDEX);
+}
+
+template <typename K>
+static void EraseIndexEntries(CDBWrapper &db, char chType) {
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch(db);
+    size_t nErased = 0;
+    pcursor->Seek(chType);
+    while (pcursor->Valid()) {
+        pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != chType)
+            break;
+        batch.Erase(key);
+        if (++nErased % 100000 == 0) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    db.WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::OpenIndexDBs(const CDBTuning &address, const CDBTuning &spent, const CDBTuning &timestamp, bool fWipe, bool fMigrate) {
+    bool fSplit = false;
+    ReadFlag("splitindexes", fSplit);
+    bool fLegacyData = !fSplit && !fWipe && HasLegacyIndexEntries(*this);
+    if (fLegacyData && !fMigrate) {
+        LogPrintf("Address, spent and timestamp indexes are stored in the block index database; restart with -migrateindexes to move them to their own databases\n");
+        return true;
+    }
+
+    // a migration starts from empty databases so entries left by an earlier interrupted run cannot go stale
+    bool fWipeIndexes = fWipe || fLegacyData || !fSplit;
+    paddressdb = new CDBWrapper(GetDataDir() / "blocks" / "addressindex", address, false, fWipeIndexes);
+    pspentdb = new CDBWrapper(GetDataDir() / "blocks" / "spentindex", spent, false, fWipeIndexes);
+    ptimestampdb = new CDBWrapper(GetDataDir() / "blocks" / "timestampindex", timestamp, false, fWipeIndexes);
+
+    if (fLegacyData) {
+        LogPrintf("Migrating address, spent and timestamp indexes out of the block index database, this may take a while\n");
+        if (!CopyIndexEntries<CAddressIndexKey, CAmount>(*this, *paddressdb, DB_ADDRESSINDEX, "address index") ||
+            !CopyIndexEntries<CAddressUnspentKey, CAddressUnspentValue>(*this, *paddressdb, DB_ADDRESSUNSPENTINDEX, "address unspent index") ||
+            !CopyIndexEntries<CSpentIndexKey, CSpentIndexValue>(*this, *pspentdb, DB_SPENTINDEX, "spent index") ||
+            !CopyIndexEntries<CTimestampIndexKey, int>(*this, *ptimestampdb, DB_TIMESTAMPINDEX, "timestamp index") ||
+            !CopyIndexEntries<CTimestampBlockIndexKey, CTimestampBlockIndexValue>(*this, *ptimestampdb, DB_BLOCKHASHINDEX, "block timestamp index"))
+            return false;
+    }
+    if (!fSplit && !WriteFlag("splitindexes", true))
+        return false;
+    if (fLegacyData || (fSplit && HasLegacyIndexEntries(*this))) {
+        // also finishes a cleanup that was interrupted after the flag was written,
+        // whichever prefix it had got to
+        EraseIndexEntries<CAddressIndexKey>(*this, DB_ADDRESSINDEX);
+        EraseIndexEntries<CAddressUnspentKey>(*this, DB_ADDRESSUNSPENTINDEX);
+        EraseIndexEntries<CSpentIndexKey>(*this, DB_SPENTINDEX);
+        EraseIndexEntries<CTimestampIndexKey>(*this, DB_TIMESTAMPINDEX);
+        EraseIndexEntries<CTimestampBlockIndexKey>(*this, DB_BLOCKHASHINDEX);
+        LogPrintf("Index migration complete\n");
+    }
+    return true;
+}
+
+bool CBlockTreeDB::HasSplitIndexDBs() const {
+    return paddressdb != this;
+}
+
+void CBlockTreeDB::GetDBStats(std::vector<std::pair<std::string, CDBStats> > &vStats) const {
+    CDBStats stats;
+    GetStats(stats);
+    vStats.push_back(make_pair("blockindex", stats));
+    if (HasSplitIndexDBs()) {
+        paddressdb->GetStats(stats);
+        vStats.push_back(make_pair("addressindex", stats));
+        pspentdb->GetStats(stats);
+        vStats.push_back(make_pair("spentindex", stats));
+        ptimestampdb->GetStats(stats);
+        vStats.push_back(make_pair("timestampindex", stats));
+    }
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -283,6 +420,19 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     return true;
 }
 
+bool CBlockTreeDB::Sync() {
+    CDBWrapper *vpdb[] = { paddressdb, pspentdb, ptimestampdb };
+    for (CDBWrapper *pdb : vpdb) {
+        if (pdb == this)
+            continue;
+        // an empty synced write flushes everything logged before it
+        CDBBatch batch(*pdb);
+        if (!pdb->WriteBatch(batch, true))
+            return false;
+    }
+    return true;
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -315,11 +465,11 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+    return pspentdb->Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*pspentdb);
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_SPENTINDEX, it->first));
@@ -327,11 +477,11 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
             batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return pspentdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*paddressdb);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -339,13 +489,13 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return paddressdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(paddressdb->NewIterator());
 
     pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
 
@@ -378,24 +528,24 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
 }
 
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*paddressdb);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    return paddressdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*paddressdb);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    return paddressdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(paddressdb->NewIterator());
 
     if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
@@ -435,7 +585,6 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
 uint32_t komodo_segid32(char *coinaddr);
 
 #define DECLARE_IGNORELIST std::map <std::string,int> ignoredMap = { \
@@ -458,77 +607,75 @@ uint32_t komodo_segid32(char *coinaddr);
     {"RD6GgnrMpPaTSMn8vai6yiGA7mN4QGPVMY", 1} \
 };
 
-bool CBlockTreeDB::Snapshot2(std::map <std::string, CAmount> &addressAmounts, UniValue *ret)
+bool CBlockTreeDB::Snapshot2(std::map <CTxDestination, CAmount> &addressAmounts, UniValue *ret)
 {
-    int64_t total = 0; int64_t totalAddresses = 0; std::string address;
+    int64_t total = 0; int64_t totalAddresses = 0;
     int64_t utxos = 0; int64_t ignoredAddresses = 0, cryptoConditionsUTXOs = 0, cryptoConditionsTotals = 0;
+    int32_t height;
     DECLARE_IGNORELIST
-    boost::scoped_ptr<CDBIterator> iter(NewIterator());
-    //std::map <std::string, CAmount> addressAmounts;
-    for (iter->SeekToLast(); iter->Valid(); iter->Prev())
+    std::set <CTxDestination> ignoredDests;
+    for (std::map <std::string, int>::iterator it = ignoredMap.begin(); it != ignoredMap.end(); ++it)
+        ignoredDests.insert(DecodeDestination(it->first));
+    boost::scoped_ptr<CDBIterator> iter;
+    {
+        // the iterator reads a fixed view of the index, taken while no block is being connected
+        LOCK(cs_main);
+        iter.reset(paddressdb->NewIterator());
+        iter->Seek(DB_ADDRESSUNSPENTINDEX);
+        height = chainActive.Height();
+    }
+    for (; iter->Valid(); iter->Next())
     {
         boost::this_thread::interruption_point();
+        pair<char, CAddressIndexIteratorKey> keyObj;
         try
         {
-            std::vector<unsigned char> slKey = std::vector<unsigned char>();
-            pair<char, CAddressIndexIteratorKey> keyObj;
             iter->GetKey(keyObj);
-            char chType = keyObj.first;
-            CAddressIndexIteratorKey indexKey = keyObj.second;
-            //fprintf(stderr, "chType=%d\n", chType);
-            if (chType == DB_ADDRESSUNSPENTINDEX)
-            {
-                try {
-                    CAmount nValue;
-                    iter->GetValue(nValue);
-                    if ( nValue == 0 )
-                        continue;
-                    getAddressFromIndex(indexKey.type, indexKey.hashBytes, address);
-                    if ( indexKey.type == 3 )
-                    {
-                        cryptoConditionsUTXOs++;
-                        cryptoConditionsTotals += nValue;
-                        total += nValue;
-                        continue;
-                    }
-                    std::map <std::string, int>::iterator ignored = ignoredMap.find(address);
-                    if (ignored != ignoredMap.end())
-                    {
-                        fprintf(stderr,"ignoring %s\n", address.c_str());
-                        ignoredAddresses++;
-                        continue;
-                    }
-                    std::map <std::string, CAmount>::iterator pos = addressAmounts.find(address);
-                    if ( pos == addressAmounts.end() )
-                    {
-                        // insert new address + utxo amount
-                        //fprintf(stderr, "inserting new address %s with amount %li\n", address.c_str(), nValue);
-                        addressAmounts[address] = nValue;
-                        totalAddresses++;
-                    }
-                    else
-                    {
-                        // update unspent tally for this address
-                        //fprintf(stderr, "updating address %s with new utxo amount %li\n", address.c_str(), nValue);
-                        addressAmounts[address] += nValue;
-                    }
-                    //fprintf(stderr,"{\"%s\", %.8f},\n",address.c_str(),(double)nValue/COIN);
-                    // total += nValue;
-                    utxos++;
-                    total += nValue;
-                }
-                catch (const std::exception& e)
-                {
-                    fprintf(stderr, "DONE %s: LevelDB addressindex exception! - %s\n", __func__, e.what());
-                    return false; //break; this means failiure of DB? we need to exit here if so for consensus code!
-                }
-            }
         }
         catch (const std::exception& e)
         {
-            fprintf(stderr, "DONE reading index entries\n");
             break;
         }
+        if (keyObj.first != DB_ADDRESSUNSPENTINDEX)
+            break;
+        const CAddressIndexIteratorKey &indexKey = keyObj.second;
+        CAmount nValue;
+        try
+        {
+            iter->GetValue(nValue);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "DONE %s: LevelDB addressindex exception! - %s\n", __func__, e.what());
+            return false; //break; this means failiure of DB? we need to exit here if so for consensus code!
+        }
+        if ( nValue == 0 )
+            continue;
+        CTxDestination dest;
+        if ( indexKey.type == 3 )
+        {
+            cryptoConditionsUTXOs++;
+            cryptoConditionsTotals += nValue;
+            total += nValue;
+            continue;
+        }
+        else if ( indexKey.type == 2 )
+            dest = CScriptID(indexKey.hashBytes);
+        else if ( indexKey.type == 1 )
+            dest = CKeyID(indexKey.hashBytes);
+        else continue;
+        if ( ignoredDests.count(dest) != 0 )
+        {
+            fprintf(stderr,"ignoring %s\n", EncodeDestination(dest).c_str());
+            ignoredAddresses++;
+            continue;
+        }
+        std::pair<std::map <CTxDestination, CAmount>::iterator, bool> pos = addressAmounts.insert(make_pair(dest, nValue));
+        if ( pos.second )
+            totalAddresses++;
+        else pos.first->second += nValue;
+        utxos++;
+        total += nValue;
     }
     //fprintf(stderr, "total=%f, totalAddresses=%li, utxos=%li, ignored=%li\n", (double) total / COIN, totalAddresses, utxos, ignoredAddresses);
     
@@ -552,7 +699,127 @@ bool CBlockTreeDB::Snapshot2(std::map <std::string, CAmount> &addressAmounts, Un
         // total of all the address's, does not count coins in CC vouts.
         ret->push_back(make_pair("total_includeCCvouts", (double) (total+cryptoConditionsTotals)/ COIN ));
         // The snapshot finished at this block height
-        ret->push_back(make_pair("ending_height", chainActive.Height()));
+        ret->push_back(make_pair("ending_height", height));
+    }
+    return true;
+}
+
+// The address balance table keeps the sum of unspent index values per
+// address, kept current by ConnectBlock/DisconnectBlock, and the snapshot
+// undo steps of the most recent blocks. DB_ADDRESSBALANCEHEIGHT names the
+// block the table matches; it is missing while the table is not usable.
+bool CBlockTreeDB::ReadAddressBalanceHeight(int &nHeight) {
+    return paddressdb->Read(DB_ADDRESSBALANCEHEIGHT, nHeight);
+}
+
+bool CBlockTreeDB::ReadAddressBalanceDeltas(int nHeight, std::vector<CAddressBalanceDelta> &vDeltas) {
+    return paddressdb->Read(make_pair(DB_ADDRESSBALANCEDELTA, nHeight), vDeltas);
+}
+
+bool CBlockTreeDB::BuildAddressBalanceIndex(int nHeight) {
+    if (!paddressdb->Erase(DB_ADDRESSBALANCEHEIGHT, true))
+        return false;
+    EraseIndexEntries<CAddressIndexIteratorKey>(*paddressdb, DB_ADDRESSBALANCE);
+    EraseIndexEntries<int>(*paddressdb, DB_ADDRESSBALANCEDELTA);
+
+    // unspent rows are ordered by address, so each balance is complete once the address changes
+    boost::scoped_ptr<CDBIterator> pcursor(paddressdb->NewIterator());
+    CDBBatch batch(*paddressdb);
+    CAddressIndexIteratorKey current; CAmount nBalance = 0; size_t nWritten = 0;
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+    while (true) {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressIndexIteratorKey> key;
+        bool fEnd = !pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX;
+        if (fEnd || key.second.type != current.type || key.second.hashBytes != current.hashBytes) {
+            if (nBalance != 0) {
+                batch.Write(make_pair(DB_ADDRESSBALANCE, current), nBalance);
+                if (++nWritten % 100000 == 0) {
+                    if (!paddressdb->WriteBatch(batch))
+                        return false;
+                    batch.Clear();
+                }
+            }
+            if (fEnd)
+                break;
+            current = key.second;
+            nBalance = 0;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: cannot read address unspent index entry", __func__);
+        nBalance += nValue;
+        pcursor->Next();
+    }
+    batch.Write(DB_ADDRESSBALANCEHEIGHT, nHeight);
+    LogPrintf("%s: %u address balances at height %d\n", __func__, nWritten, nHeight);
+    return paddressdb->WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::UpdateAddressBalanceIndex(int nHeight, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                             const std::vector<CAddressBalanceDelta> &vDeltas, bool fErase, int nKeepDeltas) {
+    int nBest;
+    if (!ReadAddressBalanceHeight(nBest))
+        return true;
+    CDBBatch batch(*paddressdb);
+    if (nBest != (fErase ? nHeight : nHeight - 1)) {
+        // blocks were connected while the table was not kept, it is rebuilt on the next snapshot
+        LogPrintf("%s: address balances are at height %d, not following block %d\n", __func__, nBest, nHeight);
+        batch.Erase(DB_ADDRESSBALANCEHEIGHT);
+        return paddressdb->WriteBatch(batch);
+    }
+
+    std::map<std::pair<unsigned int, uint160>, CAmount> sums;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++)
+        sums[make_pair(it->first.type, it->first.hashBytes)] += fErase ? -it->second : it->second;
+    for (std::map<std::pair<unsigned int, uint160>, CAmount>::const_iterator it=sums.begin(); it!=sums.end(); it++) {
+        if (it->second == 0)
+            continue;
+        std::pair<char, CAddressIndexIteratorKey> key(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(it->first.first, it->first.second));
+        CAmount nBalance = 0;
+        paddressdb->Read(key, nBalance);
+        nBalance += it->second;
+        if (nBalance == 0)
+            batch.Erase(key);
+        else batch.Write(key, nBalance);
+    }
+
+    if (fErase) {
+        batch.Erase(make_pair(DB_ADDRESSBALANCEDELTA, nHeight));
+        batch.Write(DB_ADDRESSBALANCEHEIGHT, nHeight - 1);
+    } else {
+        batch.Write(make_pair(DB_ADDRESSBALANCEDELTA, nHeight), vDeltas);
+        if (nHeight > nKeepDeltas)
+            batch.Erase(make_pair(DB_ADDRESSBALANCEDELTA, nHeight - nKeepDeltas));
+        batch.Write(DB_ADDRESSBALANCEHEIGHT, nHeight);
+    }
+    return paddressdb->WriteBatch(batch);
+}
+
+bool CBlockTreeDB::AddressBalanceSnapshot(std::map <CTxDestination, CAmount> &addressAmounts)
+{
+    DECLARE_IGNORELIST
+    std::set <CTxDestination> ignoredDests;
+    for (std::map <std::string, int>::iterator it = ignoredMap.begin(); it != ignoredMap.end(); ++it)
+        ignoredDests.insert(DecodeDestination(it->first));
+    boost::scoped_ptr<CDBIterator> iter(paddressdb->NewIterator());
+    for (iter->Seek(DB_ADDRESSBALANCE); iter->Valid(); iter->Next())
+    {
+        boost::this_thread::interruption_point();
+        pair<char, CAddressIndexIteratorKey> keyObj; CAmount nBalance;
+        if ( !iter->GetKey(keyObj) || keyObj.first != DB_ADDRESSBALANCE )
+            break;
+        if ( !iter->GetValue(nBalance) )
+            return error("%s: cannot read address balance", __func__);
+        // cryptocondition vouts are left out of snapshots, as in Snapshot2
+        CTxDestination dest;
+        if ( keyObj.second.type == 2 )
+            dest = CScriptID(keyObj.second.hashBytes);
+        else if ( keyObj.second.type == 1 )
+            dest = CKeyID(keyObj.second.hashBytes);
+        else continue;
+        if ( nBalance > 0 && ignoredDests.count(dest) == 0 )
+            addressAmounts[dest] = nBalance;
     }
     return true;
 }
@@ -561,26 +828,47 @@ extern std::vector <std::pair<CAmount, CTxDestination>> vAddressSnapshot;
 
 UniValue CBlockTreeDB::Snapshot(int top)
 {
-    int topN = 0;
     std::vector <std::pair<CAmount, std::string>> vaddr;
-    //std::vector <std::vector <std::pair<CAmount, CScript>>> tokenids;
-    std::map <std::string, CAmount> addressAmounts;
+    std::map <CTxDestination, CAmount> addressAmounts;
+    std::vector <std::pair<CAmount, CTxDestination>> vSnapshot;
     UniValue result(UniValue::VOBJ);
     UniValue addressesSorted(UniValue::VARR);
     result.push_back(Pair("start_time", (int) time(NULL)));
-    if ( (vAddressSnapshot.size() > 0 && top < 0) || (Snapshot2(addressAmounts,&result) && top >= 0) )
+    if ( top < 0 )
+    {
+        // the daily snapshot is replaced from ConnectTip, copy it out rather than hold cs_main while encoding
+        LOCK(cs_main);
+        vSnapshot = vAddressSnapshot;
+    }
+    if ( (vSnapshot.size() > 0 && top < 0) || (top >= 0 && Snapshot2(addressAmounts,&result)) )
     {
         if ( top > -1 )
         {
-            for (std::pair<std::string, CAmount> element : addressAmounts)
-                vaddr.push_back( make_pair(element.second, element.first) );
+            // only the requested top N need encoding, the rest are cut by amount first
+            std::vector <std::pair<CAmount, CTxDestination>> vdest;
+            vdest.reserve(addressAmounts.size());
+            for (std::map <CTxDestination, CAmount>::iterator it = addressAmounts.begin(); it != addressAmounts.end(); ++it)
+                vdest.push_back(make_pair(it->second, it->first));
+            addressAmounts.clear();
+            size_t n = vdest.size();
+            if ( top > 0 && top < (int)n )
+            {
+                // keep every address tied with the last one, the final order breaks ties on the encoded string
+                std::nth_element(vdest.begin(), vdest.begin() + (top - 1), vdest.end(),
+                    [](const std::pair<CAmount, CTxDestination> &a, const std::pair<CAmount, CTxDestination> &b) { return a.first > b.first; });
+                CAmount cutoff = vdest[top - 1].first;
+                n = std::partition(vdest.begin(), vdest.end(), [cutoff](const std::pair<CAmount, CTxDestination> &a) { return a.first >= cutoff; }) - vdest.begin();
+            }
+            vaddr.reserve(n);
+            for (size_t i = 0; i < n; i++)
+                vaddr.push_back(make_pair(vdest[i].first, EncodeDestination(vdest[i].second)));
             std::sort(vaddr.rbegin(), vaddr.rend());
         }
         else 
         {
-            for ( auto address : vAddressSnapshot )
+            for ( auto address : vSnapshot )
                 vaddr.push_back(make_pair(address.first, CBitcoinAddress(address.second).ToString()));
-            top = vAddressSnapshot.size();
+            top = vSnapshot.size();
         }
         int topN = 0;
         for (std::vector<std::pair<CAmount, std::string>>::iterator it = vaddr.begin(); it!=vaddr.end(); ++it)
@@ -604,14 +892,14 @@ UniValue CBlockTreeDB::Snapshot(int top)
 }
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*ptimestampdb);
     batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    return ptimestampdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(ptimestampdb->NewIterator());
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -645,15 +933,15 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
 }
 
 bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
+    CDBBatch batch(*ptimestampdb);
     batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+    return ptimestampdb->WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
 
     CTimestampBlockIndexValue(lts);
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+    if (!ptimestampdb->Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
 	return false;
 
     ltimestamp = lts.ltimestamp;
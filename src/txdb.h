@@ -23,6 +23,7 @@
 
 #include "coins.h"
 #include "dbwrapper.h"
+#include "script/standard.h"
 
 #include <map>
 #include <string>
@@ -38,6 +39,7 @@ struct CAddressUnspentValue;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CAddressBalanceDelta;
 struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
@@ -78,6 +80,7 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    void GetDBStats(CDBStats &stats) const { db.GetStats(stats); }
 };
 
 /** Access to the block database (blocks/index/) */
@@ -85,10 +88,28 @@ class CBlockTreeDB : public CDBWrapper
 {
 public:
     CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000);
+    ~CBlockTreeDB();
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+
+    //! Where the optional indexes live. All three point at this database
+    //! until OpenIndexDBs gives each its own LevelDB under blocks/.
+    CDBWrapper *paddressdb;
+    CDBWrapper *pspentdb;
+    CDBWrapper *ptimestampdb;
 public:
+    /**
+     * Open the address, spent and timestamp index databases. A datadir that
+     * still keeps them inside the block index stays on that layout unless
+     * fMigrate is set, in which case the entries are moved over first.
+     */
+    bool OpenIndexDBs(const CDBTuning &address, const CDBTuning &spent, const CDBTuning &timestamp, bool fWipe, bool fMigrate);
+    bool HasSplitIndexDBs() const;
+    void GetDBStats(std::vector<std::pair<std::string, CDBStats> > &vStats) const;
+
+    //! Sync the split index databases, whose writes are not covered by the block index sync
+    bool Sync();
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
@@ -116,7 +137,13 @@ public:
     bool LoadBlockIndexGuts();
     bool blockOnchainActive(const uint256 &hash);
     UniValue Snapshot(int top);
-    bool Snapshot2(std::map <std::string, CAmount> &addressAmounts, UniValue *ret);
+    bool Snapshot2(std::map <CTxDestination, CAmount> &addressAmounts, UniValue *ret);
+    bool BuildAddressBalanceIndex(int nHeight);
+    bool UpdateAddressBalanceIndex(int nHeight, const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                   const std::vector<CAddressBalanceDelta> &vDeltas, bool fErase, int nKeepDeltas);
+    bool ReadAddressBalanceHeight(int &nHeight);
+    bool ReadAddressBalanceDeltas(int nHeight, std::vector<CAddressBalanceDelta> &vDeltas);
+    bool AddressBalanceSnapshot(std::map <CTxDestination, CAmount> &addressAmounts);
 };
 
 #endif // BITCOIN_TXDB_H
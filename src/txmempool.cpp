@@ -369,6 +369,7 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
                 }
             }
             mapRecentlyAddedTx.erase(hash);
+            mapInputsChecked.erase(hash);
             BOOST_FOREACH(const CTxIn& txin, tx.vin)
                 mapNextTx.erase(txin.prevout);
             BOOST_FOREACH(const JSDescription& joinsplit, tx.vjoinsplit) {
@@ -586,11 +587,34 @@ void CTxMemPool::removeWithoutBranchId(uint32_t nMemPoolBranchId)
     }
 }
 
+void CTxMemPool::SetInputsChecked(const uint256& hash, const CMempoolInputsCheck& check)
+{
+    LOCK(cs);
+    if (mapTx.count(hash))
+        mapInputsChecked[hash] = check;
+}
+
+bool CTxMemPool::InputsCheckedFor(const uint256& hash, const uint256& hashTip, uint32_t nBranchId) const
+{
+    LOCK(cs);
+    std::map<uint256, CMempoolInputsCheck>::const_iterator it = mapInputsChecked.find(hash);
+    if (it == mapInputsChecked.end() || it->second.nBranchId != nBranchId)
+        return false;
+    return !it->second.fTipBound || it->second.hashTip == hashTip;
+}
+
+void CTxMemPool::ClearInputsChecked()
+{
+    LOCK(cs);
+    mapInputsChecked.clear();
+}
+
 void CTxMemPool::clear()
 {
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    mapInputsChecked.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
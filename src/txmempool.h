@@ -128,6 +128,24 @@ public:
     size_t DynamicMemoryUsage() const { return 0; }
 };
 
+/**
+ * Record of the last full input check (CheckTxInputs and scripts, including
+ * CC validation) a mempool transaction passed, so CreateNewBlock can skip
+ * repeating it. If the result depends on more than the spent outputs (CC
+ * evals, coinbase spends, KMD interest) it only holds for the same tip,
+ * otherwise it holds for any tip with the same consensus branch.
+ */
+struct CMempoolInputsCheck
+{
+    uint256 hashTip;
+    uint32_t nBranchId;
+    bool fTipBound;
+
+    CMempoolInputsCheck() : nBranchId(0), fTipBound(true) {}
+    CMempoolInputsCheck(const uint256& hashTipIn, uint32_t nBranchIdIn, bool fTipBoundIn) :
+        hashTip(hashTipIn), nBranchId(nBranchIdIn), fTipBound(fTipBoundIn) {}
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -155,6 +173,8 @@ private:
     std::map<uint256, const CTransaction*> mapSproutNullifiers;
     std::map<uint256, const CTransaction*> mapSaplingNullifiers;
 
+    std::map<uint256, CMempoolInputsCheck> mapInputsChecked;
+
     void checkNullifiers(ShieldedType type) const;
     
 public:
@@ -238,6 +258,13 @@ public:
 
     bool nullifierExists(const uint256& nullifier, ShieldedType type) const;
 
+    /** Remember that tx passed the full input check against the given tip */
+    void SetInputsChecked(const uint256& hash, const CMempoolInputsCheck& check);
+    /** Whether tx's last input check still holds for a block on top of hashTip */
+    bool InputsCheckedFor(const uint256& hash, const uint256& hashTip, uint32_t nBranchId) const;
+    /** Forget all input checks, so the next block template checks every tx again */
+    void ClearInputsChecked();
+
     void NotifyRecentlyAdded();
     bool IsFullyNotified();
     
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+
+#include "asyncrpcoperation_faucetget.h"
+
+#include "main.h"
+#include "util.h"
+#include "wallet.h"
+
+#include <string>
+
+AsyncRPCOperation_faucetget::AsyncRPCOperation_faucetget(CPubKey mypk, uint64_t txfee, int32_t numthreads) :
+        mypk_(mypk), txfee_(txfee), numthreads_(numthreads)
+{
+    if (numthreads_ < 1) {
+        numthreads_ = GetNumCores();
+    }
+}
+
+AsyncRPCOperation_faucetget::~AsyncRPCOperation_faucetget() {
+}
+
+void AsyncRPCOperation_faucetget::main() {
+    if (isCancelled()) {
+        return;
+    }
+
+    set_state(OperationStatus::EXECUTING);
+    start_execution_clock();
+
+    bool success = false;
+
+    try {
+        success = main_impl();
+    } catch (const runtime_error& e) {
+        set_error_code(-1);
+        set_error_message("runtime error: " + string(e.what()));
+    } catch (const exception& e) {
+        set_error_code(-1);
+        set_error_message("general exception: " + string(e.what()));
+    } catch (...) {
+        set_error_code(-2);
+        set_error_message("unknown error");
+    }
+
+    stop_execution_clock();
+
+    if (success) {
+        set_state(OperationStatus::SUCCESS);
+    } else if (progress_.cancelled.load()) {
+        set_state(OperationStatus::CANCELLED);
+    } else {
+        set_state(OperationStatus::FAILED);
+    }
+
+    LogPrintf("%s: faucetget finished (status=%s, tried=%llu)\n", getId(), getStateAsString(), (unsigned long long)progress_.tried.load());
+}
+
+bool AsyncRPCOperation_faucetget::main_impl() {
+    FaucetGrindTemplate grind;
+    UniValue result;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        result = FaucetGetTemplate(mypk_, txfee_, grind);
+    }
+    if (result[JSON_HEXTX].getValStr().size() > 1) {
+        result = FaucetGrind(grind, numthreads_, progress_);
+    }
+    if (result[JSON_HEXTX].getValStr().size() <= 1) {
+        set_error_code(-1);
+        set_error_message(result["error"].isStr() ? result["error"].get_str() : "couldnt create faucet get transaction");
+        return false;
+    }
+    result.push_back(Pair("result", "success"));
+    set_result(result);
+    return true;
+}
+
+void AsyncRPCOperation_faucetget::cancel() {
+    AsyncRPCOperation::cancel();
+    progress_.cancelled.store(true);
+}
+
+UniValue AsyncRPCOperation_faucetget::getStatus() const {
+    UniValue obj = AsyncRPCOperation::getStatus();
+    obj.push_back(Pair("method", "faucetget"));
+    obj.push_back(Pair("threads", numthreads_));
+    obj.push_back(Pair("tried", (uint64_t)progress_.tried.load()));
+    obj.push_back(Pair("maxtries", FAUCET_MAXGRIND));
+    return obj;
+}
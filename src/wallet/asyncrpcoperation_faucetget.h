@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+
+#ifndef ASYNCRPCOPERATION_FAUCETGET_H
+#define ASYNCRPCOPERATION_FAUCETGET_H
+
+#include "asyncrpcoperation.h"
+#include "pubkey.h"
+#include "cc/CCfaucet.h"
+
+#include <univalue.h>
+
+/**
+ * Runs faucetget in the background: the tx is built under cs_main/cs_wallet,
+ * then the txid nonce is ground on all cores without holding any lock.
+ * getStatus() reports how many nonces were tried and cancel() stops the search.
+ */
+class AsyncRPCOperation_faucetget : public AsyncRPCOperation {
+public:
+    AsyncRPCOperation_faucetget(CPubKey mypk, uint64_t txfee, int32_t numthreads);
+    virtual ~AsyncRPCOperation_faucetget();
+
+    // We don't want to be copied or moved around
+    AsyncRPCOperation_faucetget(AsyncRPCOperation_faucetget const&) = delete;             // Copy construct
+    AsyncRPCOperation_faucetget(AsyncRPCOperation_faucetget&&) = delete;                  // Move construct
+    AsyncRPCOperation_faucetget& operator=(AsyncRPCOperation_faucetget const&) = delete;  // Copy assign
+    AsyncRPCOperation_faucetget& operator=(AsyncRPCOperation_faucetget &&) = delete;      // Move assign
+
+    virtual void main();
+
+    virtual void cancel();
+
+    virtual UniValue getStatus() const;
+
+private:
+    CPubKey mypk_;
+    uint64_t txfee_;
+    int32_t numthreads_;
+    FaucetGrindProgress progress_;
+
+    bool main_impl();
+};
+
+#endif /* ASYNCRPCOPERATION_FAUCETGET_H */
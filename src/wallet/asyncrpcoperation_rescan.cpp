@@ -0,0 +1,107 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+
+#include "asyncrpcoperation_rescan.h"
+
+#include "init.h"
+#include "main.h"
+#include "util.h"
+
+#include <string>
+
+AsyncRPCOperation_rescan::AsyncRPCOperation_rescan(int nStartHeight) : nStartHeight_(nStartHeight)
+{
+}
+
+AsyncRPCOperation_rescan::~AsyncRPCOperation_rescan() {
+}
+
+void AsyncRPCOperation_rescan::main() {
+    if (isCancelled()) {
+        return;
+    }
+
+    set_state(OperationStatus::EXECUTING);
+    start_execution_clock();
+
+    bool success = false;
+
+    try {
+        success = main_impl();
+    } catch (const runtime_error& e) {
+        set_error_code(-1);
+        set_error_message("runtime error: " + string(e.what()));
+    } catch (const exception& e) {
+        set_error_code(-1);
+        set_error_message("general exception: " + string(e.what()));
+    } catch (...) {
+        set_error_code(-2);
+        set_error_message("unknown error");
+    }
+
+    stop_execution_clock();
+
+    if (progress_.fCancel.load()) {
+        set_state(OperationStatus::CANCELLED);
+    } else if (success) {
+        set_state(OperationStatus::SUCCESS);
+    } else {
+        set_state(OperationStatus::FAILED);
+    }
+
+    LogPrintf("%s: rescan finished (status=%s, height=%d, found=%d)\n", getId(), getStateAsString(), progress_.nHeight.load(), progress_.nFound.load());
+}
+
+bool AsyncRPCOperation_rescan::main_impl() {
+    CBlockIndex* pindexStart;
+    {
+        LOCK(cs_main);
+        if (nStartHeight_ > chainActive.Height()) {
+            set_error_code(-1);
+            set_error_message("Rescan height is out of range.");
+            return false;
+        }
+        pindexStart = chainActive[nStartHeight_];
+    }
+    int nFound = pwalletMain->ScanForWalletTransactions(pindexStart, true, &progress_);
+    pwalletMain->MarkDirty();
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("startheight", progress_.nStartHeight.load()));
+    result.push_back(Pair("height", progress_.nHeight.load()));
+    result.push_back(Pair("found", nFound));
+    if (progress_.fQueued) {
+        // The rescan that was already running covers this range
+        result.push_back(Pair("queued", true));
+    }
+    set_result(result);
+    return true;
+}
+
+void AsyncRPCOperation_rescan::cancel() {
+    AsyncRPCOperation::cancel();
+    progress_.fCancel.store(true);
+}
+
+UniValue AsyncRPCOperation_rescan::getStatus() const {
+    UniValue obj = AsyncRPCOperation::getStatus();
+    obj.push_back(Pair("method", "z_rescanwallet"));
+    obj.push_back(Pair("startheight", progress_.nStartHeight.load()));
+    obj.push_back(Pair("height", progress_.nHeight.load()));
+    obj.push_back(Pair("tipheight", progress_.nTipHeight.load()));
+    obj.push_back(Pair("found", progress_.nFound.load()));
+    return obj;
+}
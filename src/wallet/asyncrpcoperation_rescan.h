@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright © 2014-2019 The SuperNET Developers.                             *
+ *                                                                            *
+ * See the AUTHORS, DEVELOPER-AGREEMENT and LICENSE files at                  *
+ * the top-level directory of this distribution for the individual copyright  *
+ * holder information and the developer policies on copyright and licensing.  *
+ *                                                                            *
+ * Unless otherwise agreed in a custom licensing agreement, no part of the    *
+ * SuperNET software, including this file may be copied, modified, propagated *
+ * or distributed except according to the terms contained in the LICENSE file *
+ *                                                                            *
+ * Removal or modification of this copyright notice is prohibited.            *
+ *                                                                            *
+ ******************************************************************************/
+
+
+#ifndef ASYNCRPCOPERATION_RESCAN_H
+#define ASYNCRPCOPERATION_RESCAN_H
+
+#include "asyncrpcoperation.h"
+#include "wallet.h"
+
+#include <univalue.h>
+
+/**
+ * Rescans the chain for wallet transactions in the background. The wallet and
+ * chain locks are only held while each batch of blocks is applied, so the node
+ * keeps serving while a key imported without rescan is caught up.
+ * getStatus() reports the scan height and cancel() stops matching; note
+ * witnesses are still brought up to the tip before the operation ends.
+ */
+class AsyncRPCOperation_rescan : public AsyncRPCOperation {
+public:
+    AsyncRPCOperation_rescan(int nStartHeight);
+    virtual ~AsyncRPCOperation_rescan();
+
+    // We don't want to be copied or moved around
+    AsyncRPCOperation_rescan(AsyncRPCOperation_rescan const&) = delete;             // Copy construct
+    AsyncRPCOperation_rescan(AsyncRPCOperation_rescan&&) = delete;                  // Move construct
+    AsyncRPCOperation_rescan& operator=(AsyncRPCOperation_rescan const&) = delete;  // Copy assign
+    AsyncRPCOperation_rescan& operator=(AsyncRPCOperation_rescan &&) = delete;      // Move assign
+
+    virtual void main();
+
+    virtual void cancel();
+
+    virtual UniValue getStatus() const;
+
+private:
+    int nStartHeight_;
+    CWalletRescanProgress progress_;
+
+    bool main_impl();
+};
+
+#endif /* ASYNCRPCOPERATION_RESCAN_H */
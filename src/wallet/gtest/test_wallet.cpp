@@ -71,6 +71,16 @@ public:
     void MarkAffectedTransactionsDirty(const CTransaction& tx) {
         CWallet::MarkAffectedTransactionsDirty(tx);
     }
+    void StartRescan(int nHeight, int nWitnessHeight) {
+        LOCK(cs_wallet);
+        fRescanActive = true;
+        nRescanHeight = nHeight;
+        nRescanWitnessHeight = nWitnessHeight;
+    }
+    void SetRescanHeight(int nHeight) {
+        LOCK(cs_wallet);
+        nRescanHeight = nHeight;
+    }
 };
 
 CWalletTx GetValidReceive(const libzcash::SproutSpendingKey& sk, CAmount value, bool randomInputs, int32_t version = 2) {
@@ -604,6 +614,87 @@ TEST(WalletTests, FindMySproutNotes) {
     EXPECT_EQ(nd, noteMap[jsoutpt]);
 }
 
+TEST(WalletTests, RescanPrefilterMatchesSerialScan) {
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    auto consensusParams = Params().GetConsensus();
+
+    TestWallet wallet;
+
+    // Sapling transaction paying the wallet
+    std::vector<unsigned char, secure_allocator<unsigned char>> rawSeed(32);
+    HDSeed seed(rawSeed);
+    auto sk = libzcash::SaplingExtendedSpendingKey::Master(seed);
+    auto expsk = sk.expsk;
+    auto fvk = expsk.full_viewing_key();
+    auto pk = sk.DefaultAddress();
+    libzcash::SaplingNote note(pk, 50000);
+    SaplingMerkleTree tree;
+    tree.append(note.cm().get());
+    auto builder = TransactionBuilder(consensusParams, 1);
+    ASSERT_TRUE(builder.AddSaplingSpend(expsk, note, tree.root(), tree.witness()));
+    builder.AddSaplingOutput(fvk.ovk, pk, 25000, {});
+    auto maybe_tx = builder.Build();
+    ASSERT_EQ(static_cast<bool>(maybe_tx), true);
+    ASSERT_TRUE(wallet.AddSaplingZKey(sk, pk));
+
+    // Sprout transactions paying the wallet and someone else
+    auto sproutsk = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sproutsk);
+    auto sproutMine = GetValidReceive(sproutsk, 10, true);
+    auto sproutOther = GetValidReceive(libzcash::SproutSpendingKey::random(), 10, true);
+
+    // Transparent transactions paying the wallet and someone else
+    CKey key;
+    key.MakeNewKey(true);
+    ASSERT_TRUE(wallet.AddKey(key));
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    CMutableTransaction mtxMine, mtxOther;
+    mtxMine.vout.push_back(CTxOut(5000, GetScriptForDestination(key.GetPubKey().GetID())));
+    mtxOther.vout.push_back(CTxOut(5000, GetScriptForDestination(otherKey.GetPubKey().GetID())));
+
+    CRescanBlock rb;
+    rb.block.vtx.push_back(maybe_tx.get());
+    rb.block.vtx.push_back(sproutMine);
+    rb.block.vtx.push_back(sproutOther);
+    rb.block.vtx.push_back(mtxMine);
+    rb.block.vtx.push_back(mtxOther);
+
+    std::vector<libzcash::SaplingIncomingViewingKey> ivks;
+    size_t nFullViewingKeys = wallet.GetSaplingTrialDecryptionKeys(ivks);
+    wallet.MatchRescanBlock(rb, ivks, nFullViewingKeys);
+    ASSERT_TRUE(rb.fMatched);
+    ASSERT_EQ(rb.block.vtx.size(), rb.vCandidate.size());
+
+    // The prefilter finds exactly what the serial per-transaction checks find
+    for (size_t i = 0; i < rb.block.vtx.size(); i++) {
+        const CTransaction& tx = rb.block.vtx[i];
+        bool fMine = false;
+        for (uint32_t n = 0; n < tx.vout.size(); n++)
+            fMine = fMine || wallet.IsMine(tx, n) != ISMINE_NO;
+        EXPECT_EQ(fMine, rb.vCandidate[i]);
+        EXPECT_EQ(wallet.FindMySproutNotes(tx), rb.vSproutNotes[i]);
+
+        auto saplingNotes = wallet.FindMySaplingNotes(tx).first;
+        ASSERT_EQ(saplingNotes.size(), rb.vSaplingNotes[i].first.size());
+        for (const auto& entry : saplingNotes) {
+            ASSERT_EQ(1, rb.vSaplingNotes[i].first.count(entry.first));
+            EXPECT_EQ(entry.second.ivk, rb.vSaplingNotes[i].first.at(entry.first).ivk);
+        }
+    }
+    EXPECT_EQ(2, rb.vSaplingNotes[0].first.size());
+    EXPECT_EQ(2, rb.vSproutNotes[1].size());
+    EXPECT_EQ(0, rb.vSproutNotes[2].size());
+    EXPECT_TRUE(rb.vCandidate[3]);
+    EXPECT_FALSE(rb.vCandidate[4]);
+
+    // Revert to default
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+}
+
 TEST(WalletTests, FindMySproutNotesInEncryptedWallet) {
     TestWallet wallet;
     uint256 r {GetRandHash()};
@@ -1458,6 +1549,68 @@ TEST(WalletTests, CachedWitnessesDecrementFirst) {
     }
 }
 
+TEST(WalletTests, CachedWitnessesReorgDuringRescan) {
+    TestWallet wallet;
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+
+    auto sk = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk);
+
+    CBlock block1;
+    CBlockIndex index1(block1);
+    index1.SetHeight(1);
+    auto outpts = CreateValidBlock(wallet, sk, index1, block1, sproutTree, saplingTree);
+    SproutMerkleTree sproutTree1 = sproutTree;
+    SaplingMerkleTree saplingTree1 = saplingTree;
+
+    CBlock block2;
+    CBlockIndex index2(block2);
+    index2.SetHeight(2);
+    CreateValidBlock(wallet, sk, index2, block2, sproutTree, saplingTree);
+
+    std::vector<JSOutPoint> sproutNotes {outpts.first};
+    std::vector<SaplingOutPoint> saplingNotes {outpts.second};
+    std::vector<boost::optional<SproutWitness>> sproutWitnesses;
+    std::vector<boost::optional<SaplingWitness>> saplingWitnesses;
+    auto anchors2 = GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_EQ(sproutTree.root(), anchors2.first);
+
+    // A rescan from height 2 starts with the wallet witnessed up to height 2
+    wallet.StartRescan(1, 2);
+
+    // Block 2 is disconnected before the rescan gets to it: it is in the
+    // witnesses, so it has to be removed from them
+    wallet.ChainTip(&index2, &block2, sproutTree1, saplingTree1, false);
+    EXPECT_EQ(1, wallet.mapWallet[outpts.first.hash].mapSproutNoteData[outpts.first].witnessHeight);
+    auto anchors3 = GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_EQ(sproutTree1.root(), anchors3.first);
+
+    // The replacement block is left to the rescan
+    CBlock block2b;
+    block2b.vtx.push_back(GetValidReceive(sk, 20, true, 4));
+    CBlockIndex index2b(block2b);
+    index2b.SetHeight(2);
+    wallet.ChainTip(&index2b, &block2b, sproutTree1, saplingTree1, true);
+    EXPECT_EQ(1, wallet.mapWallet[outpts.first.hash].mapSproutNoteData[outpts.first].witnessHeight);
+
+    // The rescan applies it
+    wallet.SetRescanHeight(2);
+    wallet.ChainTip(&index2b, &block2b, sproutTree1, saplingTree1, true);
+    EXPECT_EQ(2, wallet.mapWallet[outpts.first.hash].mapSproutNoteData[outpts.first].witnessHeight);
+
+    // Same anchor as if the reorg had happened without a rescan
+    SproutMerkleTree sproutTree2b = sproutTree1;
+    for (const JSDescription& jsdesc : block2b.vtx[0].vjoinsplit) {
+        for (const uint256& commitment : jsdesc.commitments) {
+            sproutTree2b.append(commitment);
+        }
+    }
+    auto anchors4 = GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_EQ(sproutTree2b.root(), anchors4.first);
+    EXPECT_NE(anchors2.first, anchors4.first);
+}
+
 TEST(WalletTests, CachedWitnessesCleanIndex) {
     TestWallet wallet;
     std::vector<CBlock> blocks;
@@ -42,6 +42,8 @@
 #include "utiltime.h"
 #include "asyncrpcoperation.h"
 #include "asyncrpcqueue.h"
+#include "wallet/asyncrpcoperation_faucetget.h"
+#include "wallet/asyncrpcoperation_rescan.h"
 #include "wallet/asyncrpcoperation_mergetoaddress.h"
 #include "wallet/asyncrpcoperation_sendmany.h"
 #include "wallet/asyncrpcoperation_shieldcoinbase.h"
@@ -3388,6 +3390,17 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
         } else if (benchmarktype == "trydecryptnotes") {
             int nAddrs = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
+        } else if (benchmarktype == "trydecryptsaplingnotes") {
+            // Number of viewing keys in the wallet, and threads to spread the trial decryptions over
+            int nKeys = params[2].get_int();
+            int nThreads = GetNumCores();
+            if (params.size() >= 4) {
+                nThreads = params[3].get_int();
+            }
+            if (nKeys <= 0 || nThreads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of keys or threads");
+            }
+            sample_times.push_back(benchmark_try_decrypt_sapling_notes(nKeys, nThreads));
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
@@ -3417,6 +3430,110 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
             sample_times.push_back(benchmark_verify_sapling_output());
+        } else if (benchmarktype == "socketselect" || benchmarktype == "socketepoll") {
+            // Number of connected peers; compare 100, 500 and 1000
+            int nPeers = 100;
+            if (params.size() >= 3) {
+                nPeers = params[2].get_int();
+            }
+            if (nPeers <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of peers");
+            }
+            sample_times.push_back(benchmark_socket_events(nPeers, benchmarktype == "socketepoll"));
+        } else if (benchmarktype == "stakeeligibility") {
+            // Number of staking UTXOs scanned per round
+            int nUtxos = 1000;
+            if (params.size() >= 3) {
+                nUtxos = params[2].get_int();
+            }
+            if (nUtxos <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of UTXOs");
+            }
+            sample_times.push_back(benchmark_stake_eligibility(nUtxos));
+        } else if (benchmarktype == "ccverify" || benchmarktype == "ccverifycached") {
+            // Number of token transfers in the block
+            int nTxs = 500;
+            if (params.size() >= 3) {
+                nTxs = params[2].get_int();
+            }
+            if (nTxs <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of transactions");
+            }
+            sample_times.push_back(benchmark_cc_verify(nTxs, benchmarktype == "ccverifycached"));
+        } else if (benchmarktype == "ccsign" || benchmarktype == "ccsignlocked") {
+            // Number of signing threads, like the faucetget grind
+            int nThreads = GetNumCores();
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            if (nThreads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads");
+            }
+            sample_times.push_back(benchmark_cc_sign(nThreads, benchmarktype == "ccsignlocked"));
+        } else if (benchmarktype == "ccdecode") {
+            // Fulfillment shape (threshold, secp256k1 or eval), and times it is decoded
+            std::string strShape = "threshold";
+            int nDecodes = 100000;
+            if (params.size() >= 3) {
+                strShape = params[2].get_str();
+            }
+            if (params.size() >= 4) {
+                nDecodes = params[3].get_int();
+            }
+            if (nDecodes <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of decodes");
+            }
+            sample_times.push_back(benchmark_cc_decode(strShape, nDecodes));
+        } else if (benchmarktype == "sigcachelookups") {
+            // Number of concurrent lookup threads, like -par script checkers
+            int nThreads = GetNumCores();
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            if (nThreads <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of threads");
+            }
+            sample_times.push_back(benchmark_sigcache_lookups(nThreads));
+        } else if (benchmarktype == "verifysaplingspends" || benchmarktype == "verifysaplingspendsparallel") {
+            // Number of shielded spends in the block; compare 100 and 500.
+            // And how many sit in each transaction, the unit that is verified
+            // in parallel.
+            int nSpends = 100;
+            int nSpendsPerTx = 1;
+            if (params.size() >= 3) {
+                nSpends = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nSpendsPerTx = params[3].get_int();
+            }
+            if (nSpends <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of spends");
+            }
+            if (nSpendsPerTx <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of spends per transaction");
+            }
+            sample_times.push_back(benchmark_verify_sapling_spends(nSpends, nSpendsPerTx, benchmarktype == "verifysaplingspendsparallel"));
+        } else if (benchmarktype == "sha256" || benchmarktype == "sha256d64") {
+            // SHA-256 kernels to allow; compare standard, sse2, avx2 and shani
+            std::string strImpl = "all";
+            if (params.size() >= 3) {
+                strImpl = params[2].get_str();
+            }
+            sample_times.push_back(benchmark_sha256(strImpl, benchmarktype == "sha256d64"));
+        } else if (benchmarktype == "nspvrequests" || benchmarktype == "nspvrequestspolling") {
+            // Number of loopback peers with a request in flight, and requests sent to each
+            int nPeers = 4;
+            int nRequests = 20;
+            if (params.size() >= 3) {
+                nPeers = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nRequests = params[3].get_int();
+            }
+            if (nPeers <= 0 || nRequests <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of peers or requests");
+            }
+            sample_times.push_back(benchmark_nspv_requests(nPeers, nRequests, benchmarktype == "nspvrequestspolling"));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
@@ -4369,6 +4486,43 @@ UniValue z_viewtransaction(const UniValue& params, bool fHelp, const CPubKey& my
 }
 
 
+UniValue z_rescanwallet(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "z_rescanwallet ( startheight )\n"
+            "\nRescan the block chain for wallet transactions and notes as an asynchronous operation.\n"
+            "Use it after importing keys with rescan disabled; the node keeps serving while it runs.\n"
+            "Track it with z_getoperationstatus and stop it with z_canceloperation. If a rescan is already\n"
+            "running, it is extended to cover this one and the operation finishes with \"queued\": true.\n"
+            "\nArguments:\n"
+            "1. startheight    (numeric, optional, default=0) Block height to start rescanning from\n"
+            "\nResult:\n"
+            "\"operationid\"   (string) An operationid to pass to z_getoperationstatus to get the result of the operation.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("z_rescanwallet", "")
+            + HelpExampleCli("z_rescanwallet", "100000")
+            + HelpExampleRpc("z_rescanwallet", "100000")
+        );
+
+    int nStartHeight = 0;
+    if (params.size() > 0)
+        nStartHeight = params[0].get_int();
+    {
+        LOCK(cs_main);
+        if (nStartHeight < 0 || nStartHeight > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Rescan height is out of range.");
+    }
+
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    std::shared_ptr<AsyncRPCOperation> operation(new AsyncRPCOperation_rescan(nStartHeight));
+    q->addOperation(operation);
+    return operation->getId();
+}
+
 UniValue z_getoperationresult(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     if (!EnsureWalletIsAvailable(fHelp))
@@ -5499,6 +5653,40 @@ UniValue z_listoperationids(const UniValue& params, bool fHelp, const CPubKey& m
     return ret;
 }
 
+UniValue z_canceloperation(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "z_canceloperation \"operationid\"\n"
+            "\nCancel a queued operation, or an executing one that supports interruption (e.g. async faucetget).\n"
+            "\nArguments:\n"
+            "1. \"operationid\"         (string, required) The operation id to cancel.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"id\": \"operationid\",  (string) the operation id\n"
+            "  \"status\": \"status\"     (string) the operation state after the request\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("z_canceloperation", "\"operationid\"")
+            + HelpExampleRpc("z_canceloperation", "\"operationid\"")
+        );
+
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    std::shared_ptr<AsyncRPCOperation> operation = q->getOperationForId(params[0].get_str());
+    if (!operation) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "No operation exists for that id.");
+    }
+    operation->cancel();
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("id", operation->getId()));
+    ret.push_back(Pair("status", operation->getStateAsString()));
+    return ret;
+}
+
 
 #include "script/sign.h"
 int32_t decode_hex(uint8_t *bytes,int32_t n,char *hex);
@@ -7026,31 +7214,43 @@ UniValue faucetfund(const UniValue& params, bool fHelp, const CPubKey& mypk)
 
 UniValue faucetget(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
-    UniValue result(UniValue::VOBJ); std::string hex;
-    if ( fHelp || params.size() !=0 )
-        throw runtime_error("faucetget\n");
+    UniValue result(UniValue::VOBJ); std::string hex; bool fAsync = false;
+    if ( fHelp || params.size() > 1 )
+        throw runtime_error("faucetget [async]\n"
+                            "with async=true the txid nonce is ground in the background, check it with z_getoperationstatus and stop it with z_canceloperation\n");
     if ( ensure_CCrequirements(EVAL_FAUCET) < 0 )
         throw runtime_error(CC_REQUIREMENTS_MSG);
+    if ( params.size() == 1 )
+        fAsync = params[0].get_bool();
 
     bool lockWallet = false;
     if (!mypk.IsValid())   // if mypk is not set then it is a local call, use wallet in AddNormalInputs (see check for this there)
         lockWallet = true;
 
-    //const CKeyStore& keystore = *pwalletMain;
-    //LOCK2(cs_main, pwalletMain->cs_wallet);
-
-    if (lockWallet)
+    if (fAsync)
     {
-        // use this instead LOCK2 because we need conditional wallet lock
-        ENTER_CRITICAL_SECTION(cs_main);
-        ENTER_CRITICAL_SECTION(pwalletMain->cs_wallet);
+        if (!lockWallet)
+            throw runtime_error("async faucetget needs a locally signed transaction\n");
+        std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+        std::shared_ptr<AsyncRPCOperation> operation(new AsyncRPCOperation_faucetget(mypk, 0, GetNumCores()));
+        q->addOperation(operation);
+        result.push_back(Pair("result", "success"));
+        result.push_back(Pair("opid", operation->getId()));
+        return(result);
     }
-    result = FaucetGet(mypk, 0);
+
     if (lockWallet)
     {
-        LEAVE_CRITICAL_SECTION(pwalletMain->cs_wallet);
-        LEAVE_CRITICAL_SECTION(cs_main);
+        // the tx is built and signed once under the locks, the nonce grinding doesn't need them
+        FaucetGrindTemplate grind; FaucetGrindProgress progress;
+        {
+            LOCK2(cs_main, pwalletMain->cs_wallet);
+            result = FaucetGetTemplate(mypk, 0, grind);
+        }
+        if (result[JSON_HEXTX].getValStr().size() > 1)
+            result = FaucetGrind(grind, GetNumCores(), progress);
     }
+    else result = FaucetGet(mypk, 0);
 
     if (result[JSON_HEXTX].getValStr().size() > 0 ) {
         result.push_back(Pair("result", "success"));
@@ -7778,6 +7978,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "z_sendmany",               &z_sendmany,               false },
     { "wallet",             "z_shieldcoinbase",         &z_shieldcoinbase,         false },
     { "wallet",             "z_getoperationstatus",     &z_getoperationstatus,     true  },
+    { "wallet",             "z_rescanwallet",           &z_rescanwallet,           true  },
     { "wallet",             "z_getoperationresult",     &z_getoperationresult,     true  },
     { "wallet",             "z_listoperationids",       &z_listoperationids,       true  },
     { "wallet",             "z_getnewaddress",          &z_getnewaddress,          true  },
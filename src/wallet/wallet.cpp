@@ -46,6 +46,9 @@
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
+#include <future>
+#include <thread>
+
 using namespace std;
 using namespace libzcash;
 
@@ -582,10 +585,27 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
                        SaplingMerkleTree saplingTree,
                        bool added)
 {
+    LOCK(cs_wallet);
+    bool fRescanBehind = false;
+    if (fRescanActive) {
+        // Blocks past both the rescan position and the height the wallet had
+        // witnessed before the rescan began are applied by the rescan itself
+        if (pindex->GetHeight() > std::max(nRescanHeight, nRescanWitnessHeight))
+            return;
+        // Otherwise the block being disconnected is in the witnesses, so it
+        // is removed here and the rescan resumes from its parent. Notes the
+        // rescan found are not witnessed up to it yet if it is past the
+        // rescan position.
+        if (!added) {
+            fRescanBehind = pindex->GetHeight() > nRescanHeight;
+            nRescanHeight = std::min(nRescanHeight, pindex->GetHeight() - 1);
+            nRescanWitnessHeight = std::min(nRescanWitnessHeight, pindex->GetHeight() - 1);
+        }
+    }
     if (added) {
         IncrementNoteWitnesses(pindex, pblock, sproutTree, saplingTree);
     } else {
-        DecrementNoteWitnesses(pindex);
+        DecrementNoteWitnesses(pindex, fRescanBehind);
     }
     UpdateSaplingNullifierNoteMapForBlock(pblock);
 }
@@ -1136,12 +1156,21 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
 }
 
 template<typename NoteDataMap>
-bool DecrementNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
+bool DecrementNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, bool fRescanBehind)
 {
     extern int32_t KOMODO_REWIND;
 
     for (auto& item : noteDataMap) {
         auto* nd = &(item.second);
+        // A running rescan has not witnessed the notes it found up to the
+        // block being removed yet, so they keep their witnesses. Only trim
+        // them to what nWitnessCacheSize will be after decrementing.
+        if (fRescanBehind && nd->witnessHeight != -1 && nd->witnessHeight < indexHeight) {
+            while (nd->witnesses.size() > 0 && nd->witnesses.size() > nWitnessCacheSize - 1) {
+                nd->witnesses.pop_back();
+            }
+            continue;
+        }
         // Only decrement witnesses that are not above the current height
         if (nd->witnessHeight <= indexHeight) {
             // Check the validity of the cache
@@ -1184,13 +1213,13 @@ bool DecrementNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t n
 }
 
 
-void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
+void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex, bool fRescanBehind)
 {
     LOCK(cs_wallet);
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        if (!::DecrementNoteWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize))
+        if (!::DecrementNoteWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, fRescanBehind))
             needsRescan = true;
-        if (!::DecrementNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize))
+        if (!::DecrementNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, fRescanBehind))
             needsRescan = true;
     }
     if ( WITNESS_CACHE_SIZE == _COINBASE_MATURITY+10 )
@@ -1760,11 +1789,29 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
             return false;
         bool fExisted = mapWallet.count(tx.GetHash()) != 0;
         if (fExisted && !fUpdate) return false;
-        auto sproutNoteData = FindMySproutNotes(tx);
-        auto saplingNoteDataAndAddressesToAdd = FindMySaplingNotes(tx);
+        return AddToWalletIfInvolvingMe(tx, pblock, fUpdate, FindMySproutNotes(tx), FindMySaplingNotes(tx));
+    }
+}
+
+/**
+ * As above, with the shielded note detection already done by the caller (the
+ * rescan runs it on worker threads).
+ */
+bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate,
+                                       const mapSproutNoteData_t& sproutNoteData,
+                                       const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNoteDataAndAddressesToAdd)
+{
+    {
+        AssertLockHeld(cs_wallet);
+        if ( tx.IsCoinBase() && tx.vout[0].nValue == 0 )
+            return false;
+        bool fExisted = mapWallet.count(tx.GetHash()) != 0;
+        if (fExisted && !fUpdate) return false;
         auto saplingNoteData = saplingNoteDataAndAddressesToAdd.first;
         auto addressesToAdd = saplingNoteDataAndAddressesToAdd.second;
         for (const auto &addressToAdd : addressesToAdd) {
+            if (HaveSaplingIncomingViewingKey(addressToAdd.first))
+                continue;
             if (!AddSaplingIncomingViewingKey(addressToAdd.second, addressToAdd.first)) {
                 return false;
             }
@@ -1816,7 +1863,8 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
             CWalletTx wtx(this,tx);
 
             if (sproutNoteData.size() > 0) {
-                wtx.SetSproutNoteData(sproutNoteData);
+                mapSproutNoteData_t noteData = sproutNoteData;
+                wtx.SetSproutNoteData(noteData);
             }
 
             if (saplingNoteData.size() > 0) {
@@ -1984,55 +2032,72 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
  */
 std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> CWallet::FindMySaplingNotes(const CTransaction &tx) const
 {
-    LOCK(cs_SpendingKeyStore);
     uint256 hash = tx.GetHash();
 
     mapSaplingNoteData_t noteData;
     SaplingIncomingViewingKeyMap viewingKeysToAdd;
 
+    if (tx.vShieldedOutput.empty()) {
+        return std::make_pair(noteData, viewingKeysToAdd);
+    }
+
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
+    // The trial decryptions run without cs_SpendingKeyStore, on a copy of the keys
+    std::vector<SaplingIncomingViewingKey> ivks;
+    size_t nFullViewingKeys = GetSaplingTrialDecryptionKeys(ivks);
+    SaplingNoteDecryptionBatch batch;
+    for (const OutputDescription& output : tx.vShieldedOutput) {
+        batch.add(output.encCiphertext, output.ephemeralKey, output.cm);
+    }
+    auto matches = batch.decrypt(ivks, GetNumCores());
+
+    LOCK(cs_SpendingKeyStore);
     for (uint32_t i = 0; i < tx.vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.vShieldedOutput[i];
-        bool found = false;
-        for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
-            SaplingIncomingViewingKey ivk = it->first;
-            auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-            if (result) {
-                auto address = ivk.address(result.get().d);
-                if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                    viewingKeysToAdd[address.get()] = ivk;
-                }
-                // We don't cache the nullifier here as computing it requires knowledge of the note position
-                // in the commitment tree, which can only be determined when the transaction has been mined.
-                SaplingOutPoint op {hash, i};
-                SaplingNoteData nd;
-                nd.ivk = ivk;
-                noteData.insert(std::make_pair(op, nd));
-                found = true;
-                break;
-            }
+        if (!matches[i]) {
+            continue;
         }
-        if (!found) {
-            for (auto it = mapSaplingIncomingViewingKeys.begin(); it != mapSaplingIncomingViewingKeys.end(); ++it) {
-                SaplingIncomingViewingKey ivk = it-> second;
-                auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-                if (!result) {
-                    continue;
-                }
-                // We don't cache the nullifier here as computing it requires knowledge of the note position
-                // in the commitment tree, which can only be determined when the transaction has been mined.
-                SaplingOutPoint op {hash, i};
-                SaplingNoteData nd;
-                nd.ivk = ivk;
-                noteData.insert(std::make_pair(op, nd));
-                break;
+        const SaplingIncomingViewingKey& ivk = ivks[matches[i]->ivk];
+        if (matches[i]->ivk < nFullViewingKeys) {
+            auto address = ivk.address(matches[i]->plaintext.d);
+            if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
+                viewingKeysToAdd[address.get()] = ivk;
             }
         }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {hash, i};
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        noteData.insert(std::make_pair(op, nd));
     }
 
     return std::make_pair(noteData, viewingKeysToAdd);
 }
 
+/**
+ * Collects the incoming viewing keys to trial-decrypt Sapling outputs with:
+ * those of the full viewing keys first, then the remaining standalone ones.
+ * Returns how many of them come from full viewing keys.
+ */
+size_t CWallet::GetSaplingTrialDecryptionKeys(std::vector<libzcash::SaplingIncomingViewingKey>& ivks) const
+{
+    LOCK(cs_SpendingKeyStore);
+    ivks.clear();
+    ivks.reserve(mapSaplingFullViewingKeys.size() + mapSaplingIncomingViewingKeys.size());
+    std::set<libzcash::SaplingIncomingViewingKey> seen;
+    for (const auto& entry : mapSaplingFullViewingKeys) {
+        ivks.push_back(entry.first);
+        seen.insert(entry.first);
+    }
+    size_t nFullViewingKeys = ivks.size();
+    for (const auto& entry : mapSaplingIncomingViewingKeys) {
+        if (seen.insert(entry.second).second) {
+            ivks.push_back(entry.second);
+        }
+    }
+    return nFullViewingKeys;
+}
+
 bool CWallet::IsSproutNullifierFromMe(const uint256& nullifier) const
 {
     {
@@ -2867,19 +2932,97 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+/**
+ * Pre-matches a block read by the rescan against the wallet, without cs_main
+ * or cs_wallet: flags the transactions with an output that may be ours and
+ * trial-decrypts their Sprout and Sapling outputs against the given keys.
+ * The results are only hints for AddToWalletIfInvolvingMe(), which does the
+ * remaining checks in block order.
+ */
+void CWallet::MatchRescanBlock(CRescanBlock& rb, const std::vector<libzcash::SaplingIncomingViewingKey>& ivks, size_t nFullViewingKeys)
+{
+    size_t nTx = rb.block.vtx.size();
+    rb.vCandidate.assign(nTx, false);
+    rb.vSproutNotes.assign(nTx, mapSproutNoteData_t());
+    rb.vSaplingNotes.assign(nTx, std::make_pair(mapSaplingNoteData_t(), SaplingIncomingViewingKeyMap()));
+    for (size_t i = 0; i < nTx; i++) {
+        const CTransaction& tx = rb.block.vtx[i];
+        bool fCandidate = false;
+        for (uint32_t n = 0; n < tx.vout.size() && !fCandidate; n++) {
+            txnouttype whichType;
+            std::vector<std::vector<unsigned char>> vSolutions;
+            // IsMine() may learn a P2SH script from the transaction itself,
+            // which has to happen in order under cs_wallet
+            if (Solver(tx.vout[n].scriptPubKey, whichType, vSolutions) && whichType == TX_SCRIPTHASH)
+                fCandidate = true;
+            else if (IsMine(tx, n) != ISMINE_NO)
+                fCandidate = true;
+        }
+        rb.vCandidate[i] = fCandidate;
+        if (!tx.vjoinsplit.empty())
+            rb.vSproutNotes[i] = FindMySproutNotes(tx);
+    }
+
+    // Trial-decrypt all Sapling outputs of the block in one batch; blocks
+    // are already spread over the workers, so it runs on this thread
+    SaplingNoteDecryptionBatch batch;
+    for (const CTransaction& tx : rb.block.vtx)
+        for (const OutputDescription& output : tx.vShieldedOutput)
+            batch.add(output.encCiphertext, output.ephemeralKey, output.cm);
+    auto matches = batch.decrypt(ivks, 1);
+    size_t nOutput = 0;
+    for (size_t i = 0; i < nTx; i++) {
+        const CTransaction& tx = rb.block.vtx[i];
+        for (uint32_t n = 0; n < tx.vShieldedOutput.size(); n++, nOutput++) {
+            if (!matches[nOutput])
+                continue;
+            const libzcash::SaplingIncomingViewingKey& ivk = ivks[matches[nOutput]->ivk];
+            // Addresses the wallet already knows are filtered when the
+            // transaction is applied
+            if (matches[nOutput]->ivk < nFullViewingKeys) {
+                auto address = ivk.address(matches[nOutput]->plaintext.d);
+                if (address)
+                    rb.vSaplingNotes[i].second[address.get()] = ivk;
+            }
+            SaplingNoteData nd;
+            nd.ivk = ivk;
+            rb.vSaplingNotes[i].first.insert(std::make_pair(SaplingOutPoint(tx.GetHash(), n), nd));
+        }
+    }
+    rb.fMatched = true;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * The scan runs as a two stage pipeline over batches of blocks. Worker
+ * threads read the next batch from disk and do the expensive per-output
+ * work (key lookups, Sprout and Sapling trial decryption) without any of
+ * the chain or wallet locks, while this thread applies the previous batch
+ * in order under cs_main and cs_wallet. Between batches both locks are
+ * released; blocks connected meanwhile are picked up by the scan, and a
+ * reorg below the scan position makes it resume from the fork.
+ *
+ * Only one rescan runs at a time. A rescan requested while one is running
+ * (typically after a key import) cannot wait for it, as the caller may hold
+ * cs_main; it is recorded instead, and the running rescan rewinds to the
+ * requested height at its next batch and carries on from there.
  */
-int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, CWalletRescanProgress* progress)
 {
     int ret = 0;
     int64_t nNow = GetTime();
     const CChainParams& chainParams = Params();
+    CWalletRescanProgress localProgress;
+    if (progress == NULL)
+        progress = &localProgress;
+    const int nThreads = std::max(1, GetNumCores());
+    const size_t nBatchSize = std::max(16, 4 * nThreads);
 
     CBlockIndex* pindex = pindexStart;
-
+    double dProgressStart = 0, dProgressTip = 0;
     std::vector<uint256> myTxHashes;
 
     {
@@ -2890,44 +3033,196 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
+        if (fRescanning) {
+            if (pindex) {
+                if (nRescanRequestHeight < 0 || pindex->GetHeight() < nRescanRequestHeight)
+                    nRescanRequestHeight = pindex->GetHeight();
+                fRescanRequestUpdate = fRescanRequestUpdate || fUpdate;
+                LogPrintf("%s: a rescan is already running, it will rescan from height %d\n", __func__, nRescanRequestHeight);
+            }
+            progress->fQueued = true;
+            progress->nStartHeight = pindex ? pindex->GetHeight() : chainActive.Height() + 1;
+            progress->nHeight = progress->nStartHeight - 1;
+            progress->nTipHeight = chainActive.Height();
+            return 0;
+        }
+        fRescanning = true;
+
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.LastTip(), false);
-        while (pindex)
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.LastTip(), false);
+
+        fRescanActive = true;
+        nRescanHeight = pindex ? pindex->GetHeight() - 1 : chainActive.Height();
+        nRescanWitnessHeight = chainActive.Height();
+        progress->nStartHeight = nRescanHeight + 1;
+        progress->nHeight = nRescanHeight;
+        progress->nTipHeight = chainActive.Height();
+    }
+
+    // Picks up a rescan requested meanwhile by rewinding to its start
+    // height. The batch in flight was matched before the request (and the
+    // key import behind it), so the caller has to discard it.
+    auto takeRescanRequest = [&]() {
+        AssertLockHeld(cs_wallet);
+        if (nRescanRequestHeight < 0)
+            return false;
+        LogPrintf("%s: rewinding rescan from height %d to %d\n", __func__, nRescanHeight, std::min(nRescanHeight, nRescanRequestHeight - 1));
+        nRescanHeight = std::min(nRescanHeight, nRescanRequestHeight - 1);
+        fUpdate = fUpdate || fRescanRequestUpdate;
+        nRescanRequestHeight = -1;
+        fRescanRequestUpdate = false;
+        progress->nStartHeight = std::min(progress->nStartHeight.load(), nRescanHeight + 1);
+        progress->nHeight = nRescanHeight;
+        return true;
+    };
+
+    auto prepareBatch = [&](std::vector<CBlockIndex*> vIndex, bool fMatch,
+                            std::vector<libzcash::SaplingIncomingViewingKey> vSaplingIvks, size_t nFullViewingKeys) {
+        std::vector<CRescanBlock> vBlocks(vIndex.size());
+        std::atomic<size_t> nNext(0);
+        auto work = [&]() {
+            size_t n;
+            while ((n = nNext++) < vBlocks.size()) {
+                CRescanBlock& rb = vBlocks[n];
+                rb.pindex = vIndex[n];
+                try {
+                    // Blocks on the active chain were fully validated when connected
+                    rb.fRead = ReadBlockFromDisk(rb.block, rb.pindex, 0);
+                    if (rb.fRead && fMatch)
+                        MatchRescanBlock(rb, vSaplingIvks, nFullViewingKeys);
+                } catch (const std::exception& e) {
+                    // Leave it unmatched; the in-order pass reads and checks it in full
+                    LogPrintf("%s: error preparing block %d: %s\n", __func__, rb.pindex->GetHeight(), e.what());
+                    rb.fMatched = false;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < nThreads && t < (int)vBlocks.size(); t++)
+            workers.emplace_back(work);
+        work();
+        for (auto& worker : workers)
+            worker.join();
+        return vBlocks;
+    };
+
+    int nNextFetch = nRescanHeight + 1;
+    auto launchBatch = [&]() {
+        std::vector<CBlockIndex*> vIndex;
+        // Each batch trial-decrypts against a fresh copy of the Sapling keys,
+        // so keys imported during the rescan are used from then on and the
+        // workers do not contend on cs_SpendingKeyStore
+        std::vector<libzcash::SaplingIncomingViewingKey> vSaplingIvks;
+        size_t nFullViewingKeys = GetSaplingTrialDecryptionKeys(vSaplingIvks);
         {
-            if (pindex->GetHeight() % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+            LOCK(cs_main);
+            for (int h = nNextFetch; h <= chainActive.Height() && vIndex.size() < nBatchSize; h++)
+                vIndex.push_back(chainActive[h]);
+        }
+        nNextFetch += vIndex.size();
+        return std::async(std::launch::async, prepareBatch, vIndex, !progress->fCancel.load(), vSaplingIvks, nFullViewingKeys);
+    };
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex,1);
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
-            {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate)) {
-                    myTxHashes.push_back(tx.GetHash());
-                    ret++;
+    try {
+        std::future<std::vector<CRescanBlock>> pending = launchBatch();
+        while (true)
+        {
+            std::vector<CRescanBlock> vBlocks = pending.get();
+            if (vBlocks.empty()) {
+                LOCK2(cs_main, cs_wallet);
+                if (!takeRescanRequest() && nRescanHeight >= chainActive.Height()) {
+                    // Caught up; from here on ChainTip() tracks new blocks again,
+                    // and a new rescan may start
+                    fRescanActive = false;
+                    fRescanning = false;
+                    break;
                 }
+                nNextFetch = nRescanHeight + 1;
+                pending = launchBatch();
+                continue;
             }
+            // Read the next batch while this one is applied
+            pending = launchBatch();
+
+            bool fResync = false;
+            {
+                LOCK2(cs_main, cs_wallet);
+                for (CRescanBlock& rb : vBlocks)
+                {
+                    CBlockIndex* pindexBlock = rb.pindex;
+                    if (pindexBlock->GetHeight() != nRescanHeight + 1 || chainActive[pindexBlock->GetHeight()] != pindexBlock) {
+                        // The chain was reorganized since the batch was fetched
+                        fResync = true;
+                        break;
+                    }
+                    if (!rb.fRead && !ReadBlockFromDisk(rb.block, pindexBlock, 0))
+                        throw std::runtime_error(strprintf("%s: failed to read block %d from disk", __func__, pindexBlock->GetHeight()));
+                    if (pindexBlock->GetHeight() % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                        ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexBlock, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
-            SproutMerkleTree sproutTree;
-            SaplingMerkleTree saplingTree;
-            // This should never fail: we should always be able to get the tree
-            // state on the path to the tip of our chain
-            assert(pcoinsTip->GetSproutAnchorAt(pindex->hashSproutAnchor, sproutTree));
-            if (pindex->pprev) {
-                if (NetworkUpgradeActive(pindex->pprev->GetHeight(), Params().GetConsensus(), Consensus::UPGRADE_SAPLING)) {
-                    assert(pcoinsTip->GetSaplingAnchorAt(pindex->pprev->hashFinalSaplingRoot, saplingTree));
+                    for (size_t i = 0; i < rb.block.vtx.size() && !progress->fCancel; i++)
+                    {
+                        const CTransaction& tx = rb.block.vtx[i];
+                        bool fInvolved;
+                        if (!rb.fMatched) {
+                            fInvolved = AddToWalletIfInvolvingMe(tx, &rb.block, fUpdate);
+                        } else {
+                            if (!rb.vCandidate[i] && rb.vSproutNotes[i].empty() && rb.vSaplingNotes[i].first.empty() &&
+                                mapWallet.count(tx.GetHash()) == 0 && !IsFromMe(tx))
+                                continue;
+                            fInvolved = AddToWalletIfInvolvingMe(tx, &rb.block, fUpdate, rb.vSproutNotes[i], rb.vSaplingNotes[i]);
+                        }
+                        if (fInvolved) {
+                            myTxHashes.push_back(tx.GetHash());
+                            ret++;
+                        }
+                    }
+
+                    SproutMerkleTree sproutTree;
+                    SaplingMerkleTree saplingTree;
+                    // This should never fail: we should always be able to get the tree
+                    // state on the path to the tip of our chain
+                    assert(pcoinsTip->GetSproutAnchorAt(pindexBlock->hashSproutAnchor, sproutTree));
+                    if (pindexBlock->pprev) {
+                        if (NetworkUpgradeActive(pindexBlock->pprev->GetHeight(), Params().GetConsensus(), Consensus::UPGRADE_SAPLING)) {
+                            assert(pcoinsTip->GetSaplingAnchorAt(pindexBlock->pprev->hashFinalSaplingRoot, saplingTree));
+                        }
+                    }
+                    // Increment note witness caches
+                    nRescanHeight = pindexBlock->GetHeight();
+                    ChainTip(pindexBlock, &rb.block, sproutTree, saplingTree, true);
                 }
+                if (takeRescanRequest())
+                    fResync = true;
+                progress->nHeight = nRescanHeight;
+                progress->nTipHeight = chainActive.Height();
+                progress->nFound = ret;
             }
-            // Increment note witness caches
-            ChainTip(pindex, &block, sproutTree, saplingTree, true);
 
-            pindex = chainActive.Next(pindex);
+            if (fResync) {
+                pending.get();
+                nNextFetch = nRescanHeight + 1;
+                pending = launchBatch();
+            }
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->GetHeight(), Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", progress->nHeight.load(), (double)(progress->nHeight - progress->nStartHeight + 1) / std::max(1, progress->nTipHeight - progress->nStartHeight + 1));
             }
         }
+    } catch (...) {
+        LOCK(cs_wallet);
+        if (nRescanRequestHeight >= 0)
+            LogPrintf("%s: rescan failed, dropping the rescan requested from height %d\n", __func__, nRescanRequestHeight);
+        nRescanRequestHeight = -1;
+        fRescanRequestUpdate = false;
+        fRescanActive = false;
+        fRescanning = false;
+        throw;
+    }
 
+    {
+        LOCK(cs_wallet);
         // After rescanning, persist Sapling note data that might have changed, e.g. nullifiers.
         // Do not flush the wallet here for performance reasons.
         CWalletDB walletdb(strWalletFile, "r+", false);
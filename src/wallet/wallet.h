@@ -42,6 +42,7 @@
 #include "base58.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -745,6 +746,39 @@ private:
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
+/**
+ * Shared state of a running wallet rescan. The rescan updates the counters as
+ * it goes; setting fCancel stops matching new transactions, but the note
+ * witnesses are still brought up to the tip before the rescan returns.
+ */
+struct CWalletRescanProgress
+{
+    std::atomic<bool> fCancel;
+    //! Set when another rescan was running and took over this one's range
+    std::atomic<bool> fQueued;
+    std::atomic<int> nStartHeight;
+    std::atomic<int> nHeight;
+    std::atomic<int> nTipHeight;
+    std::atomic<int> nFound;
+
+    CWalletRescanProgress() : fCancel(false), fQueued(false), nStartHeight(0), nHeight(0), nTipHeight(0), nFound(0) {}
+};
+
+/** A block read by the rescan workers, with its transactions pre-matched against the wallet */
+struct CRescanBlock
+{
+    CBlockIndex* pindex;
+    CBlock block;
+    bool fRead;
+    bool fMatched;
+    //! Transactions with an output that may be ours; they get the full check
+    std::vector<bool> vCandidate;
+    std::vector<mapSproutNoteData_t> vSproutNotes;
+    std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>> vSaplingNotes;
+
+    CRescanBlock() : pindex(NULL), fRead(false), fMatched(false) {}
+};
+
 class CWallet : public CCryptoKeyStore, public CValidationInterface
 {
 private:
@@ -779,6 +813,16 @@ private:
     TxNullifiers mapTxSproutNullifiers;
     TxNullifiers mapTxSaplingNullifiers;
 
+    //! Set while a rescan is running, so only one runs at a time. Guarded by cs_wallet.
+    bool fRescanning;
+    /**
+     * Lowest start height requested by rescans that came in while one was
+     * running, or -1. The running rescan rewinds to it at its next batch.
+     * Guarded by cs_wallet.
+     */
+    int nRescanRequestHeight;
+    bool fRescanRequestUpdate;
+
     void AddToTransparentSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSproutSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
@@ -804,9 +848,22 @@ protected:
                                 SproutMerkleTree& sproutTree,
                                 SaplingMerkleTree& saplingTree);
     /**
-     * pindex is the old tip being disconnected.
+     * pindex is the old tip being disconnected. fRescanBehind is set when a
+     * running rescan has not reached it yet, so the notes that rescan found
+     * are left alone.
+     */
+    void DecrementNoteWitnesses(const CBlockIndex* pindex, bool fRescanBehind = false);
+
+    /**
+     * While fRescanActive, the rescan owns the note witnesses above both
+     * nRescanHeight and nRescanWitnessHeight, the height the wallet had
+     * witnessed when the rescan began: ChainTip() ignores blocks connected
+     * past them and the rescan applies them itself when it gets there.
+     * Guarded by cs_wallet.
      */
-    void DecrementNoteWitnesses(const CBlockIndex* pindex);
+    bool fRescanActive;
+    int nRescanHeight;
+    int nRescanWitnessHeight;
 
     template <typename WalletDB>
     void SetBestChainINTERNAL(WalletDB& walletdb, const CBlockLocator& loc) {
@@ -919,6 +976,12 @@ public:
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fRescanning = false;
+        nRescanRequestHeight = -1;
+        fRescanRequestUpdate = false;
+        fRescanActive = false;
+        nRescanHeight = -1;
+        nRescanWitnessHeight = -1;
     }
 
     /**
@@ -1140,11 +1203,21 @@ public:
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     void RescanWallet();
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
+    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate,
+                                  const mapSproutNoteData_t& sproutNoteData,
+                                  const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap>& saplingNoteDataAndAddressesToAdd);
     void WitnessNoteCommitment(
          std::vector<uint256> commitments,
          std::vector<boost::optional<SproutWitness>>& witnesses,
          uint256 &final_anchor);
-    int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    /**
+     * Scan the active chain from pindexStart for wallet transactions. Blocks are
+     * read and matched against the wallet keys on worker threads; wallet updates
+     * are applied in block order, holding cs_main and cs_wallet only per batch.
+     * If another rescan is already running, it is asked to cover this one's
+     * range as well and this call returns 0 with progress->fQueued set.
+     */
+    int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false, CWalletRescanProgress* progress = NULL);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
@@ -1184,6 +1257,8 @@ public:
         uint8_t n) const;
     mapSproutNoteData_t FindMySproutNotes(const CTransaction& tx) const;
     std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> FindMySaplingNotes(const CTransaction& tx) const;
+    size_t GetSaplingTrialDecryptionKeys(std::vector<libzcash::SaplingIncomingViewingKey>& ivks) const;
+    void MatchRescanBlock(CRescanBlock& rb, const std::vector<libzcash::SaplingIncomingViewingKey>& ivks, size_t nFullViewingKeys);
     bool IsSproutNullifierFromMe(const uint256& nullifier) const;
     bool IsSaplingNullifierFromMe(const uint256& nullifier) const;
 
@@ -9,6 +9,12 @@
 #include "zcash/util.h"
 #include "librustzcash.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "sodium.h"
+
 using namespace libzcash;
 
 SproutNote::SproutNote() {
@@ -325,3 +331,111 @@ SaplingOutCiphertext SaplingOutgoingPlaintext::encrypt(
 
     return enc.encrypt_to_ourselves(ovk, cv, cm, pt);
 }
+
+void SaplingNoteDecryptionBatch::add(
+    const SaplingEncCiphertext &ciphertext,
+    const uint256 &epk,
+    const uint256 &cmu
+)
+{
+    Output output;
+    output.ciphertext = &ciphertext;
+    output.epk = epk;
+    output.cmu = cmu;
+    memset(output.kdfBlock, 0, 32);
+    memcpy(output.kdfBlock + 32, epk.begin(), 32);
+    outputs.push_back(output);
+}
+
+std::vector<boost::optional<SaplingNoteDecryptionBatch::Match>> SaplingNoteDecryptionBatch::decrypt(
+    const std::vector<SaplingIncomingViewingKey> &ivks,
+    int nThreads
+) const
+{
+    // (output, key) pairs handed to a thread at a time
+    static const size_t CHUNK_SIZE = 16;
+
+    std::vector<boost::optional<Match>> results(outputs.size());
+    size_t nPairs = outputs.size() * ivks.size();
+    if (nPairs == 0) {
+        return results;
+    }
+
+    // The KDF personalization is the same for every trial, so its BLAKE2b
+    // state is set up once and copied
+    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES] = {};
+    memcpy(personalization, "Zcash_SaplingKDF", 16);
+    crypto_generichash_blake2b_state kdfInit;
+    if (crypto_generichash_blake2b_init_salt_personal(&kdfInit, NULL, 0, 32, NULL, personalization) != 0) {
+        throw std::logic_error("hash function failure");
+    }
+
+    // Index of the lowest key found so far for each output; pairs with a
+    // higher key are skipped
+    std::vector<std::atomic<size_t>> best(outputs.size());
+    for (auto &b : best) {
+        b.store(ivks.size());
+    }
+    std::mutex csResults;
+    std::atomic<size_t> nextPair(0);
+
+    auto work = [&]() {
+        unsigned char block[64];
+        unsigned char K[32];
+        unsigned char cipher_nonce[crypto_aead_chacha20poly1305_IETF_NPUBBYTES] = {};
+        SaplingEncPlaintext plaintext;
+        size_t start;
+        while ((start = nextPair.fetch_add(CHUNK_SIZE)) < nPairs) {
+            size_t end = std::min(start + CHUNK_SIZE, nPairs);
+            for (size_t pair = start; pair < end; pair++) {
+                size_t o = pair / ivks.size();
+                size_t k = pair % ivks.size();
+                if (k >= best[o].load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                const Output &output = outputs[o];
+
+                // Same steps as AttemptSaplingEncDecryption
+                memcpy(block, output.kdfBlock, 64);
+                if (!librustzcash_sapling_ka_agree(output.epk.begin(), ivks[k].begin(), block)) {
+                    continue;
+                }
+                crypto_generichash_blake2b_state kdf = kdfInit;
+                crypto_generichash_blake2b_update(&kdf, block, 64);
+                crypto_generichash_blake2b_final(&kdf, K, 32);
+                if (crypto_aead_chacha20poly1305_ietf_decrypt(
+                    plaintext.begin(), NULL,
+                    NULL,
+                    output.ciphertext->begin(), ZC_SAPLING_ENCCIPHERTEXT_SIZE,
+                    NULL,
+                    0,
+                    cipher_nonce, K) != 0)
+                {
+                    continue;
+                }
+
+                // Rare: check the note contents the usual way
+                auto note = SaplingNotePlaintext::decrypt(*output.ciphertext, ivks[k], output.epk, output.cmu);
+                if (!note) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(csResults);
+                if (k < best[o].load()) {
+                    best[o].store(k);
+                    results[o] = Match{k, note.get()};
+                }
+            }
+        }
+    };
+
+    size_t nWorkers = std::min<size_t>(std::max(nThreads, 1), (nPairs + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < nWorkers; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return results;
+}
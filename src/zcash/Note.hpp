@@ -7,6 +7,7 @@
 #include "NoteEncryption.hpp"
 
 #include <array>
+#include <vector>
 #include <boost/optional.hpp>
 
 namespace libzcash {
@@ -200,6 +201,39 @@ public:
     ) const;
 };
 
+/**
+ * Trial-decrypts a batch of Sapling outputs (a transaction or a whole block)
+ * against a list of incoming viewing keys, spreading the (output, key) pairs
+ * over a pool of threads. As with the serial scan, an output is attributed to
+ * the first key in the list that decrypts it.
+ */
+class SaplingNoteDecryptionBatch {
+public:
+    struct Match {
+        size_t ivk;
+        SaplingNotePlaintext plaintext;
+    };
+
+    // The ciphertext is referenced, not copied, and must outlive the batch
+    void add(const SaplingEncCiphertext &ciphertext, const uint256 &epk, const uint256 &cmu);
+    size_t size() const { return outputs.size(); }
+
+    // One entry per added output, in order
+    std::vector<boost::optional<Match>> decrypt(
+        const std::vector<SaplingIncomingViewingKey> &ivks,
+        int nThreads
+    ) const;
+
+private:
+    struct Output {
+        const SaplingEncCiphertext *ciphertext;
+        uint256 epk;
+        uint256 cmu;
+        // KDF_Sapling input, with the ephemeral key half filled in once
+        unsigned char kdfBlock[64];
+    };
+    std::vector<Output> outputs;
+};
 
 }
 
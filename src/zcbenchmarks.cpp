@@ -1,27 +1,48 @@
+#include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
+#include <fstream>
 #include <future>
+#include <poll.h>
+#include <sys/socket.h>
 #include <map>
+#include <mutex>
+#include <sstream>
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
+#include "arith_uint256.h"
 #include "coins.h"
 #include "util.h"
 #include "init.h"
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
+#include "crypto/sha256.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
+#include "net.h"
+#include "netbase.h"
 #include "pow.h"
 #include "rpc/server.h"
+#include "komodo_nSPV_defs.h"
+#include "script/cc.h"
 #include "script/sign.h"
+#include "script/serverchecker.h"
+#include "script/sigcache.h"
+#include "cc/eval.h"
+#include "cc/CCfaucet.h"
 #include "sodium.h"
 #include "streams.h"
+#include "transaction_builder.h"
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
@@ -297,6 +318,46 @@ double benchmark_try_decrypt_notes(size_t nAddrs)
     return timer_stop(tv_start);
 }
 
+double benchmark_try_decrypt_sapling_notes(size_t nKeys, int nThreads)
+{
+    CWallet wallet;
+    for (size_t i = 0; i < nKeys; i++) {
+        auto sk = libzcash::SaplingSpendingKey::random();
+        wallet.AddSaplingFullViewingKey(sk.full_viewing_key(), sk.default_address());
+    }
+
+    // A block's worth of outputs to someone else, so every key is tried.
+    // FindMySaplingNotes() doesn't look at the proofs, they are left empty.
+    auto recipient = libzcash::SaplingSpendingKey::random().default_address();
+    CMutableTransaction mtx;
+    mtx.fOverwintered = true;
+    mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    mtx.nVersion = SAPLING_TX_VERSION;
+    for (size_t i = 0; i < 10; i++) {
+        SaplingNote note(recipient, 10000 + i);
+        SaplingNotePlaintext pt(note, {});
+        auto res = pt.encrypt(recipient.pk_d);
+        assert(res);
+        OutputDescription od;
+        od.cm = note.cm().get();
+        od.ephemeralKey = res->second.get_epk();
+        od.encCiphertext = res->first;
+        mtx.vShieldedOutput.push_back(od);
+    }
+    CTransaction tx(mtx);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<SaplingIncomingViewingKey> ivks;
+    wallet.GetSaplingTrialDecryptionKeys(ivks);
+    SaplingNoteDecryptionBatch batch;
+    for (const OutputDescription& output : tx.vShieldedOutput) {
+        batch.add(output.encCiphertext, output.ephemeralKey, output.cm);
+    }
+    auto matches = batch.decrypt(ivks, nThreads);
+    return timer_stop(tv_start);
+}
+
 double benchmark_increment_note_witnesses(size_t nTxs)
 {
     CWallet wallet;
@@ -630,3 +691,733 @@ double benchmark_verify_sapling_output()
     }
     return timer_stop(tv_start);
 }
+
+// CPU time the "net" thread has used so far. It is not the calling thread,
+// so this goes through /proc at clock tick resolution.
+static bool socket_handler_cpu_seconds(double& seconds)
+{
+#ifdef __linux__
+    boost::filesystem::directory_iterator end;
+    for (boost::filesystem::directory_iterator it("/proc/self/task"); it != end; ++it) {
+        std::ifstream comm((it->path() / "comm").string());
+        std::string name;
+        if (!std::getline(comm, name) || name != "zcash-net")
+            continue;
+        std::ifstream stat((it->path() / "stat").string());
+        std::string line;
+        if (!std::getline(stat, line) || line.rfind(')') == std::string::npos)
+            return false;
+        // fields after the command name start at 3 (state), utime and stime are 14 and 15
+        std::istringstream fields(line.substr(line.rfind(')') + 1));
+        std::string field;
+        unsigned long long utime = 0, stime = 0;
+        for (int i = 3; i <= 15 && fields >> field; i++) {
+            if (i == 14)
+                utime = strtoull(field.c_str(), NULL, 10);
+            else if (i == 15)
+                stime = strtoull(field.c_str(), NULL, 10);
+        }
+        seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+        return true;
+    }
+#endif
+    return false;
+}
+
+static bool bench_send_message(SOCKET hSocket, const char *pszCommand, const CDataStream& payload)
+{
+    CMessageHeader hdr(Params().MessageStart(), pszCommand, payload.size());
+    uint256 hash = Hash(payload.begin(), payload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hdr;
+    if (!payload.empty())
+        ss.write(&payload[0], payload.size());
+    return send(hSocket, &ss[0], ss.size(), MSG_NOSIGNAL) == (ssize_t)ss.size();
+}
+
+static bool bench_recv(SOCKET hSocket, char *buf, size_t len)
+{
+    while (len > 0) {
+        struct pollfd pfd;
+        pfd.fd = hSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 10000) <= 0)
+            return false;
+        ssize_t n = recv(hSocket, buf, len, 0);
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Skips messages from the node until one with strCommand arrives
+static bool bench_wait_message(SOCKET hSocket, const std::string& strCommand)
+{
+    while (true) {
+        char hdrbuf[CMessageHeader::HEADER_SIZE];
+        if (!bench_recv(hSocket, hdrbuf, sizeof(hdrbuf)))
+            return false;
+        CMessageHeader hdr(Params().MessageStart());
+        CDataStream(hdrbuf, hdrbuf + sizeof(hdrbuf), SER_NETWORK, PROTOCOL_VERSION) >> hdr;
+        if (!hdr.IsValid(Params().MessageStart()))
+            return false;
+        std::vector<char> payload(hdr.nMessageSize);
+        if (!payload.empty() && !bench_recv(hSocket, &payload[0], payload.size()))
+            return false;
+        if (hdr.GetCommand() == strCommand)
+            return true;
+    }
+}
+
+static int bench_count_inbound()
+{
+    int nInbound = 0;
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+        if (pnode->fInbound)
+            nInbound++;
+    return nInbound;
+}
+
+// CPU time the node's socket handler thread spends per message with nPeers
+// loopback peers connected to it. Each message is a ping to a random peer
+// whose pong is awaited before the next one, so every message costs the
+// handler a wakeup, a receive and a send. The node has to run the loop being
+// measured, i.e. be started with -socketevents=select or -socketevents=epoll,
+// and have -maxconnections room for the peers.
+double benchmark_socket_events(size_t nPeers, bool fEpoll)
+{
+#ifndef __linux__
+    throw JSONRPCError(RPC_INVALID_PARAMETER, "The socket handler CPU time is only available on Linux");
+#else
+    if (fEpoll != SocketEventsEpoll()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("The node is not using %s, restart it with -socketevents=%s",
+                                                            fEpoll ? "epoll" : "select()", fEpoll ? "epoll" : "select"));
+    }
+    if (!fListen) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "The node is not accepting connections, restart it with -listen");
+    }
+    int nInbound = bench_count_inbound();
+    if (nInbound + (int)nPeers >= nMaxConnections) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Not enough connection slots, restart the node with a higher -maxconnections");
+    }
+    // both ends of every connection live in this process, on top of the
+    // descriptors init reserves for the node
+    RaiseFileDescriptorLimit(nMaxConnections + nPeers + 150);
+
+    std::vector<SOCKET> vSockets;
+    auto cleanup = [&]() {
+        for (SOCKET& hSocket : vSockets)
+            CloseSocket(hSocket);
+        // wait for the node to drop them, so the next sample finds the slots free
+        for (int i = 0; i < 1000 && bench_count_inbound() > nInbound; i++)
+            MilliSleep(10);
+    };
+
+    CService addrNode("127.0.0.1", GetListenPort());
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrNode.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot build the node's loopback address");
+    }
+    for (size_t i = 0; i < nPeers; i++) {
+        SOCKET hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (hSocket == INVALID_SOCKET) {
+            cleanup();
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "socket() failed, raise the open file limit");
+        }
+        vSockets.push_back(hSocket);
+        if (connect(hSocket, (struct sockaddr*)&sockaddr, len) != 0) {
+            cleanup();
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "connect() to the node failed");
+        }
+    }
+
+    // version handshake, so the node answers pings
+    for (size_t i = 0; i < nPeers; i++) {
+        CDataStream version(SER_NETWORK, INIT_PROTO_VERSION);
+        CAddress addrNone(CService("0.0.0.0", 0));
+        version << PROTOCOL_VERSION << (uint64_t)0 << GetTime() << addrNone << addrNone
+                << GetRand(std::numeric_limits<uint64_t>::max()) << std::string("/zcbenchmark/") << (int)0 << false;
+        if (!bench_send_message(vSockets[i], "version", version) ||
+            !bench_wait_message(vSockets[i], "verack") ||
+            !bench_send_message(vSockets[i], "verack", CDataStream(SER_NETWORK, PROTOCOL_VERSION))) {
+            cleanup();
+            throw JSONRPCError(RPC_INTERNAL_ERROR, fEpoll ?
+                "The node dropped a benchmark peer, raise -maxconnections" :
+                "The node dropped a benchmark peer, raise -maxconnections or use fewer peers, select() cannot watch sockets past FD_SETSIZE");
+        }
+    }
+
+    const int nMessages = 5000;
+    double cpuStart, cpuEnd;
+    if (!socket_handler_cpu_seconds(cpuStart)) {
+        cleanup();
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot find the socket handler thread");
+    }
+    for (int n = 0; n < nMessages; n++) {
+        SOCKET hSocket = vSockets[GetRand(nPeers)];
+        CDataStream ping(SER_NETWORK, PROTOCOL_VERSION);
+        ping << (uint64_t)n;
+        if (!bench_send_message(hSocket, "ping", ping) || !bench_wait_message(hSocket, "pong")) {
+            cleanup();
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "A benchmark peer got no pong");
+        }
+    }
+    if (!socket_handler_cpu_seconds(cpuEnd)) {
+        cleanup();
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot find the socket handler thread");
+    }
+    cleanup();
+    return (cpuEnd - cpuStart) / nMessages;
+#endif
+}
+
+extern uint32_t komodo_stakewinner(int32_t validateflag,arith_uint256 bnTarget,int32_t nHeight,uint256 txid,int32_t vout,uint32_t blocktime,uint32_t prevtime,char *address,uint8_t *hashbuf,uint32_t txtime,uint64_t value,int32_t PoSperc);
+
+// The per-UTXO part of a staking round over nUtxos synthetic coins: the
+// komodo_stakewinner eligibility check komodo_staked runs for every wallet
+// UTXO, then signing the stake transaction. The UTXO scan, segid lookup and
+// chain reads of komodo_staked are not included, since they need a wallet and
+// chain the benchmark cannot fake on a running node; komodo-test times whole
+// rounds over a regtest chain (TestStakingRound) and getstakingprofile on a
+// staking node. All inputs are derived from fixed seeds so runs are
+// comparable across builds.
+double benchmark_stake_eligibility(size_t nUtxos)
+{
+    uint8_t keydata[32];
+    for (int i = 0; i < 32; i++)
+        keydata[i] = i + 1;
+    CKey key;
+    key.Set(keydata, keydata + sizeof(keydata), true);
+    CBasicKeyStore keystore;
+    keystore.AddKey(key);
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    std::string strAddress = CBitcoinAddress(key.GetPubKey().GetID()).ToString();
+
+    uint8_t hashbuf[256];
+    memset(hashbuf, 0, sizeof(hashbuf));
+    for (int i = 0; i < 100; i++)
+        hashbuf[i] = (uint8_t)(i % 64);
+
+    const int32_t nHeight = 100000;
+    const uint32_t prevtime = 1600000000;
+    const uint32_t blocktime = prevtime + 60;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(0x200f0f0f);
+
+    std::vector<uint256> vTxids(nUtxos);
+    uint256 seed = uint256S("5374616b696e67526f756e6442656e63686d61726b");
+    for (size_t i = 0; i < nUtxos; i++) {
+        CSHA256().Write(seed.begin(), 32).Write((const unsigned char *)&i, sizeof(i)).Finalize(vTxids[i].begin());
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+
+    char address[64];
+    size_t nBest = 0;
+    uint32_t nBestTime = 0;
+    for (size_t i = 0; i < nUtxos; i++) {
+        strncpy(address, strAddress.c_str(), sizeof(address) - 1);
+        address[sizeof(address) - 1] = 0;
+        uint32_t txtime = prevtime - 86400 - (uint32_t)(i % 3600);
+        uint64_t value = 100 + (i % 1000);
+        uint32_t eligible = komodo_stakewinner(0, bnTarget, nHeight, vTxids[i], 0, blocktime, prevtime, address, hashbuf, txtime, value, 50);
+        if (eligible != 0 && (nBestTime == 0 || eligible < nBestTime)) {
+            nBestTime = eligible;
+            nBest = i;
+        }
+    }
+
+    CMutableTransaction stakeTx;
+    stakeTx.fOverwintered = true;
+    stakeTx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+    stakeTx.nVersion = SAPLING_TX_VERSION;
+    stakeTx.vin.emplace_back(vTxids[nBest], 0);
+    stakeTx.vout.emplace_back(100 * COIN, scriptPubKey);
+    auto consensusBranchId = NetworkUpgradeInfo[Consensus::UPGRADE_SAPLING].nBranchId;
+    SignSignature(keystore, scriptPubKey, stakeTx, 0, 100 * COIN, SIGHASH_ALL, consensusBranchId);
+
+    return timer_stop(tv_start);
+}
+
+extern CC *MakeCCcond1(uint8_t evalcode,CPubKey pk);
+
+// Checker that accepts every eval node, so the benchmark measures only the
+// signature part of crypto-condition verification without chain state
+class BenchmarkCCChecker : public ServerTransactionSignatureChecker
+{
+public:
+    BenchmarkCCChecker(const CTransaction* txToIn, unsigned int nIn, const CAmount& amount, bool storeIn, const PrecomputedTransactionData& txdataIn) : ServerTransactionSignatureChecker(txToIn, nIn, amount, storeIn, txdataIn) {}
+    int CheckEvalCondition(const CC *cond) const { return 1; }
+};
+
+// Verifies a block's worth of token transfers, each spending nInputs
+// tokens-style 1of1 CC outputs. With fCached the inputs are checked once
+// beforehand, as mempool acceptance would, and the timed pass is the one
+// ConnectBlock performs.
+double benchmark_cc_verify(size_t nTxs, bool fCached)
+{
+    const size_t nInputs = 4;
+    uint32_t nPrevCC = ASSETCHAINS_CC;
+    ASSETCHAINS_CC = 1;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CC *cond = MakeCCcond1(EVAL_TOKENS, key.GetPubKey());
+    CScript scriptPubKey = CCPubKey(cond);
+    cc_free(cond);
+    auto consensusBranchId = NetworkUpgradeInfo[Consensus::UPGRADE_SAPLING].nBranchId;
+
+    std::vector<CTransaction> vtx;
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.fOverwintered = true;
+        mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+        mtx.nVersion = SAPLING_TX_VERSION;
+        for (size_t j = 0; j < nInputs; j++)
+            mtx.vin.emplace_back(GetRandHash(), j);
+        mtx.vout.push_back(CTxOut(COIN, scriptPubKey));
+        CTransaction txToSign(mtx);
+        PrecomputedTransactionData txdata(txToSign);
+        for (size_t j = 0; j < nInputs; j++) {
+            uint256 sighash = SignatureHash(scriptPubKey, txToSign, j, SIGHASH_ALL, COIN, consensusBranchId, &txdata);
+            CC *signCond = MakeCCcond1(EVAL_TOKENS, key.GetPubKey());
+            cc_signTreeSecp256k1Msg32(signCond, key.begin(), sighash.begin());
+            mtx.vin[j].scriptSig = CCSig(signCond);
+            cc_free(signCond);
+        }
+        vtx.push_back(CTransaction(mtx));
+    }
+
+    auto verifyAll = [&](bool fStore) {
+        bool fOk = true;
+        for (const CTransaction& tx : vtx) {
+            PrecomputedTransactionData txdata(tx);
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                ScriptError serror = SCRIPT_ERR_OK;
+                fOk &= VerifyScript(tx.vin[j].scriptSig,
+                                    scriptPubKey,
+                                    STANDARD_SCRIPT_VERIFY_FLAGS,
+                                    BenchmarkCCChecker(&tx, j, COIN, fStore, txdata),
+                                    consensusBranchId,
+                                    &serror);
+            }
+        }
+        return fOk;
+    };
+
+    bool fOk = !fCached || verifyAll(true);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    fOk &= verifyAll(false);
+    double elapsed = timer_stop(tv_start);
+    ASSETCHAINS_CC = nPrevCC;
+    if (!fOk) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "VerifyScript() should return true");
+    }
+    return elapsed;
+}
+
+// Wall time for nThreads faucetget grind workers to each sign 2000 sighashes
+// into a 1of1 CC tree. With fLocked they go through cc_signTreeSecp256k1Msg32
+// and its global context lock, otherwise through FaucetSignCond.
+double benchmark_cc_sign(int nThreads, bool fLocked)
+{
+    const size_t nSigs = 2000;
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pk = key.GetPubKey();
+
+    // workers cannot throw across the join, so failures are counted
+    std::atomic<size_t> nFailed(0);
+    auto worker = [&]() {
+        CC *cond = MakeCCcond1(EVAL_FAUCET, pk);
+        for (size_t i = 0; i < nSigs; i++) {
+            uint256 sighash = ArithToUint256(arith_uint256(i));
+            bool fSigned;
+            if (fLocked)
+                fSigned = cc_signTreeSecp256k1Msg32(cond, key.begin(), sighash.begin()) != 0;
+            else
+                fSigned = FaucetSignCond(cond, key, pk, sighash);
+            if (!fSigned)
+                nFailed++;
+        }
+        cc_free(cond);
+    };
+
+    std::vector<std::thread> threads;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int i = 0; i < nThreads; i++)
+        threads.emplace_back(worker);
+    for (auto& t : threads)
+        t.join();
+    double elapsed = timer_stop(tv_start);
+    if (nFailed > 0) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, fLocked ? "cc_signTreeSecp256k1Msg32() should sign" : "FaucetSignCond() should sign");
+    }
+    return elapsed;
+}
+
+// Decodes one signed fulfillment nDecodes times, as each CC input's
+// scriptSig is decoded before it is verified. "threshold" is the 1of1 shape
+// MakeCCcond1 outputs are spent with, "secp256k1" and "eval" its leaves.
+double benchmark_cc_decode(const std::string& strShape, size_t nDecodes)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CC *cond;
+    if (strShape == "threshold")
+        cond = MakeCCcond1(EVAL_TOKENS, key.GetPubKey());
+    else if (strShape == "secp256k1")
+        cond = CCNewSecp256k1(key.GetPubKey());
+    else if (strShape == "eval")
+        cond = CCNewEval(E_MARSHAL(ss << (uint8_t)EVAL_TOKENS));
+    else
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid fulfillment shape");
+
+    uint256 sighash = GetRandHash();
+    cc_signTreeSecp256k1Msg32(cond, key.begin(), sighash.begin());
+    std::vector<unsigned char> vFulfillment(1000);
+    vFulfillment.resize(cc_fulfillmentBinary(cond, vFulfillment.data(), vFulfillment.size()));
+    cc_free(cond);
+    if (vFulfillment.empty()) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "cc_fulfillmentBinary() should encode the fulfillment");
+    }
+
+    bool fOk = true;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t i = 0; i < nDecodes; i++) {
+        CC *decoded = cc_readFulfillmentBinary(vFulfillment.data(), vFulfillment.size());
+        if (!decoded) {
+            fOk = false;
+            continue;
+        }
+        cc_free(decoded);
+    }
+    double elapsed = timer_stop(tv_start);
+    if (!fOk) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "cc_readFulfillmentBinary() should decode the fulfillment");
+    }
+    return elapsed;
+}
+
+// Wall time for nThreads script-check style threads to each look up 200000
+// entries in the shared signature cache. Half of the lookups hit.
+double benchmark_sigcache_lookups(int nThreads)
+{
+    const size_t nEntries = 100000;
+    const size_t nLookups = 200000;
+
+    std::vector<uint256> vEntries(nEntries * 2);
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        vEntries[i] = GetRandHash();
+        if (i < nEntries)
+            SignatureCacheSet(vEntries[i]);
+    }
+
+    std::atomic<size_t> nHits(0);
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&vEntries, &nHits, t, nLookups]() {
+            size_t hits = 0;
+            for (size_t i = 0; i < nLookups; i++)
+                hits += SignatureCacheGet(vEntries[(i * 7919 + t) % vEntries.size()], false);
+            nHits += hits;
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    double elapsed = timer_stop(tv_start);
+    LogPrint("bench", "%s: %d threads, %u hits\n", __func__, nThreads, nHits.load());
+    return elapsed;
+}
+
+// A Sapling-only transaction with nSpends spends of fresh notes and the
+// change output, valid at the next block height. Creating the proofs takes a
+// while, so transactions are kept for later samples.
+static const CTransaction& bench_sapling_spends_tx(size_t nSpends)
+{
+    static std::mutex cs;
+    static std::map<size_t, CTransaction> mapTx;
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapTx.find(nSpends);
+    if (it != mapTx.end())
+        return it->second;
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto address = sk.default_address();
+    std::vector<SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+    for (size_t i = 0; i < nSpends; i++) {
+        notes.push_back(SaplingNote(address, 20000));
+        uint256 cm = notes.back().cm().get();
+        tree.append(cm);
+        for (SaplingWitness& witness : witnesses)
+            witness.append(cm);
+        witnesses.push_back(tree.witness());
+    }
+
+    TransactionBuilder builder(Params().GetConsensus(), chainActive.Height() + 1);
+    for (size_t i = 0; i < nSpends; i++) {
+        if (!builder.AddSaplingSpend(expsk, notes[i], tree.root(), witnesses[i]))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not add a Sapling spend");
+    }
+    auto maybe_tx = builder.Build();
+    if (!maybe_tx) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not build the Sapling transaction");
+    }
+    return mapTx[nSpends] = maybe_tx.get();
+}
+
+// Verifies nSpends Sapling spends the way ConnectBlock does: one
+// CScriptCheck(CHECK_SAPLING) job per transaction, checking its spends, its
+// change output and the binding signature. The spends sit nSpendsPerTx to a
+// transaction, so 1 gives the most parallelism a block can get and nSpends
+// the single transaction case that verifies serially anyway. Runs on the
+// calling thread, or with fParallel on a check queue served by one worker per
+// core (like -par=0).
+double benchmark_verify_sapling_spends(size_t nSpends, size_t nSpendsPerTx, bool fParallel)
+{
+    if (!NetworkUpgradeActive(chainActive.Height() + 1, Params().GetConsensus(), Consensus::UPGRADE_SAPLING)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Sapling is not active at the next block height");
+    }
+    nSpendsPerTx = std::min(nSpendsPerTx, nSpends);
+    const CTransaction& tx = bench_sapling_spends_tx(nSpendsPerTx);
+    size_t nTxs = (nSpends + nSpendsPerTx - 1) / nSpendsPerTx;
+
+    // Same sighash ContextualCheckTransaction hands to the job
+    uint32_t consensusBranchId = CurrentEpochBranchId(chainActive.Height() + 1, Params().GetConsensus());
+    uint256 dataToBeSigned = SignatureHash(CScript(), tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
+
+    CCheckQueue<CScriptCheck> queue(128);
+    boost::thread_group workers;
+    if (fParallel) {
+        for (int i = 0; i < GetNumCores() - 1; i++)
+            workers.create_thread(boost::bind(&CCheckQueue<CScriptCheck>::Thread, &queue));
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fOk = true;
+    {
+        CCheckQueueControl<CScriptCheck> control(fParallel ? &queue : NULL);
+        std::vector<CScriptCheck> vChecks;
+        for (size_t i = 0; i < nTxs; i++) {
+            CScriptCheck check(tx, dataToBeSigned);
+            if (fParallel)
+                vChecks.push_back(check);
+            else
+                fOk &= check();
+        }
+        control.Add(vChecks);
+        fOk &= control.Wait();
+    }
+    double t = timer_stop(tv_start);
+
+    workers.interrupt_all();
+    workers.join_all();
+    if (!fOk) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "CheckSaplingProofs() should return true");
+    }
+    return t;
+}
+
+// Hashes 1 MiB through the Transform kernel, or with fD64 double-hashes 1 MiB of 64-byte
+// merkle node pairs through SHA256D64, using only the SHA-256 kernels named
+// by strImpl (standard, sse4, sse2, avx2, shani or all). Kernels the CPU or
+// the build lacks are skipped, the one actually used is logged.
+double benchmark_sha256(const std::string& strImpl, bool fD64)
+{
+    static const std::map<std::string, sha256_implementation::UseImplementation> mapImpl = {
+        {"standard", sha256_implementation::STANDARD},
+        {"sse4", sha256_implementation::USE_SSE4},
+        {"sse2", sha256_implementation::USE_SSE2},
+        {"avx2", sha256_implementation::USE_AVX2},
+        {"shani", sha256_implementation::USE_SHANI},
+        {"all", sha256_implementation::USE_ALL},
+    };
+    auto it = mapImpl.find(strImpl);
+    if (it == mapImpl.end()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid SHA-256 implementation");
+    }
+
+    const size_t nBytes = 1 << 20;
+    std::vector<unsigned char> vIn(nBytes), vOut(fD64 ? nBytes / 2 : 32);
+    for (size_t i = 0; i < nBytes; i++)
+        vIn[i] = (unsigned char)i;
+
+    // Run the kernels directly, the node's own stay as they are
+    sha256_implementation::Kernels kernels = sha256_implementation::DetectKernels(it->second);
+    uint32_t state[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+    struct timeval tv_start;
+    timer_start(tv_start);
+    if (fD64)
+        kernels.D64(vOut.data(), vIn.data(), nBytes / 64);
+    else
+        kernels.Transform(state, vIn.data(), nBytes / 64);
+    double elapsed = timer_stop(tv_start);
+    LogPrint("bench", "%s: %s\n", __func__, kernels.name);
+    return elapsed;
+}
+
+extern int32_t KOMODO_NSPV;
+extern CWaitableCriticalSection NSPV_pendingmutex; // in komodo_nSPV_superlite.h
+extern CNode *NSPV_req(CNode *pnode,uint8_t *msg,int32_t len,uint64_t mask,int32_t ind,struct NSPV_pending *req);
+extern void komodo_nSPVresp(CNode *pfrom,std::vector<uint8_t> response);
+extern int32_t NSPV_rwtxproof(int32_t rwflag,uint8_t *serialized,struct NSPV_txproof *ptr);
+extern void NSPV_txproof_purge(struct NSPV_txproof *ptr);
+
+static bool ReadSocket(SOCKET s, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = recv(s, buf, len, 0);
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Round trips of nSPV superlite txproof requests to nPeers loopback peers, one
+// client thread per peer each sending nRequests requests back to back, like
+// concurrent RPCs. Each peer is a CNode on one end of a socketpair: requests go
+// out through NSPV_req and the wire, a responder thread reads them off the
+// other end and answers through komodo_nSPVresp, as the message handler would.
+// fPolling waits for the answer the way the client used to, checking the
+// request every NSPV_POLLMICROS instead of waiting on the condition variable.
+// Needs a superlite node (-nSPV=1).
+double benchmark_nspv_requests(int nPeers, int nRequests, bool fPolling)
+{
+    if (KOMODO_NSPV <= 0) {
+        throw JSONRPCError(RPC_INVALID_REQUEST, "nSPV request benchmarks need a superlite node (-nSPV=1)");
+    }
+    struct LoopbackPeer {
+        SOCKET fds[2];
+        CNode *node;
+    };
+    std::vector<LoopbackPeer> peers(nPeers);
+    std::atomic<int64_t> nTotalMicros(0);
+    std::atomic<int> nFailures(0);
+
+    for (int p = 0; p < nPeers; p++) {
+        LoopbackPeer& peer = peers[p];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, peer.fds) != 0) {
+            for (int q = 0; q < p; q++) {
+                delete peers[q].node;
+                close(peers[q].fds[1]);
+            }
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "nSPV loopback socketpair failed");
+        }
+        peer.node = new CNode(peer.fds[0], CAddress(), "nspvloopback", true);
+        peer.node->nServices = NODE_NSPV;
+        memset(peer.node->prevtimes, 0, sizeof(peer.node->prevtimes));
+    }
+
+    // responses are handled one at a time, like on the message handler thread
+    std::mutex csHandler;
+    std::vector<std::thread> threads;
+    for (auto& peer : peers) {
+        threads.emplace_back([&peer, &csHandler]() {
+            uint8_t hdr[CMessageHeader::HEADER_SIZE], tx[64], txproof[64];
+            memset(tx, 0, sizeof(tx));
+            memset(txproof, 0, sizeof(txproof));
+            while (ReadSocket(peer.fds[1], hdr, sizeof(hdr))) {
+                CMessageHeader header(Params().MessageStart());
+                CDataStream((const char *)hdr, (const char *)hdr + sizeof(hdr), SER_NETWORK, PROTOCOL_VERSION) >> header;
+                std::vector<char> payload(header.nMessageSize);
+                if (!payload.empty() && !ReadSocket(peer.fds[1], (uint8_t *)&payload[0], payload.size()))
+                    return;
+                std::vector<uint8_t> request;
+                CDataStream(payload, SER_NETWORK, PROTOCOL_VERSION) >> request;
+                if (header.GetCommand() != "getnSPV" || request.size() != 1 + 2 * sizeof(int32_t) + sizeof(uint256) || request[0] != NSPV_TXPROOF)
+                    continue;
+                struct NSPV_txproof P;
+                memset(&P, 0, sizeof(P));
+                memcpy(&P.height, &request[1], sizeof(P.height));
+                memcpy(&P.vout, &request[1 + sizeof(P.height)], sizeof(P.vout));
+                memcpy(P.txid.begin(), &request[1 + sizeof(P.height) + sizeof(P.vout)], sizeof(P.txid));
+                P.unspentvalue = COIN;
+                P.tx = tx;
+                P.txlen = sizeof(tx);
+                P.txproof = txproof;
+                P.txprooflen = sizeof(txproof);
+                std::vector<uint8_t> response(1 + sizeof(P) + P.txlen + P.txprooflen);
+                response[0] = NSPV_TXPROOFRESP;
+                response.resize(1 + NSPV_rwtxproof(1, &response[1], &P));
+                std::lock_guard<std::mutex> lock(csHandler);
+                komodo_nSPVresp(peer.node, response);
+            }
+        });
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<std::thread> clients;
+    for (int p = 0; p < nPeers; p++) {
+        clients.emplace_back([&peers, &nTotalMicros, &nFailures, p, nRequests, fPolling]() {
+            for (int i = 0; i < nRequests; i++) {
+                struct NSPV_pending req;
+                uint8_t msg[64];
+                int32_t len = 0, height = i, vout = 0, done = 0;
+                uint256 txid = GetRandHash();
+                msg[len++] = NSPV_TXPROOF;
+                memcpy(&msg[len], &height, sizeof(height)), len += sizeof(height);
+                memcpy(&msg[len], &vout, sizeof(vout)), len += sizeof(vout);
+                memcpy(&msg[len], txid.begin(), sizeof(txid)), len += sizeof(txid);
+                int64_t nStart = GetTimeMicros();
+                if (NSPV_req(peers[p].node, msg, len, NODE_NSPV, msg[0] >> 1, &req) == 0) {
+                    nFailures++;
+                    continue;
+                }
+                if (fPolling) {
+                    for (int iter = 0; iter < NSPV_POLLITERS && done == 0; iter++) {
+                        usleep(NSPV_POLLMICROS);
+                        boost::unique_lock<boost::mutex> lock(NSPV_pendingmutex);
+                        done = req.done;
+                    }
+                }
+                // unlinks the request, right away when polling already saw the answer
+                done = NSPV_pending_wait(&req, fPolling ? 0 : NSPV_REQTIMEOUT);
+                nTotalMicros += GetTimeMicros() - nStart;
+                struct NSPV_txproof P;
+                memset(&P, 0, sizeof(P));
+                if (done != 0)
+                    NSPV_rwtxproof(0, &req.response[1], &P);
+                if (done == 0 || P.txid != txid)
+                    nFailures++;
+                NSPV_txproof_purge(&P);
+            }
+        });
+    }
+    for (auto& client : clients)
+        client.join();
+    double elapsed = timer_stop(tv_start);
+
+    for (auto& peer : peers)
+        shutdown(peer.fds[0], SHUT_RDWR);
+    for (auto& thread : threads)
+        thread.join();
+    for (auto& peer : peers) {
+        delete peer.node;
+        close(peer.fds[1]);
+    }
+    if (nFailures > 0) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "nSPV loopback request failed or timed out");
+    }
+    LogPrint("bench", "%s: %d peers, mean round trip %d us\n", __func__, nPeers, nTotalMicros.load() / ((int64_t)nPeers * nRequests));
+    return elapsed;
+}
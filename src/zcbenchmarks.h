@@ -14,6 +14,7 @@ extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
 extern double benchmark_large_tx(size_t nInputs);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
+extern double benchmark_try_decrypt_sapling_notes(size_t nKeys, int nThreads);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
@@ -23,5 +24,14 @@ extern double benchmark_create_sapling_spend();
 extern double benchmark_create_sapling_output();
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
+extern double benchmark_socket_events(size_t nPeers, bool fEpoll);
+extern double benchmark_stake_eligibility(size_t nUtxos);
+extern double benchmark_cc_verify(size_t nTxs, bool fCached);
+extern double benchmark_cc_sign(int nThreads, bool fLocked);
+extern double benchmark_cc_decode(const std::string& strShape, size_t nDecodes);
+extern double benchmark_sigcache_lookups(int nThreads);
+extern double benchmark_verify_sapling_spends(size_t nSpends, size_t nSpendsPerTx, bool fParallel);
+extern double benchmark_sha256(const std::string& strImpl, bool fD64);
+extern double benchmark_nspv_requests(int nPeers, int nRequests, bool fPolling);
 
 #endif